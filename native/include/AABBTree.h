@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "Instance.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Dynamic AABB tree broadphase over instance bounding boxes
+ *
+ * A binary tree whose leaves hold "fat" boxes: the instance's bbox grown by
+ * a margin and stretched in the direction it last moved. Update only
+ * touches the tree when the new bbox escapes its fat box, so small moves
+ * are a refit of the leaf alone. Insertion picks the sibling with the
+ * lowest perimeter cost and the path back to the root is rebalanced with
+ * AVL-style rotations, keeping queries logarithmic regardless of how
+ * instance sizes or positions are distributed.
+ */
+class AABBTree {
+public:
+    static constexpr double FAT_MARGIN = 4.0;          // Slack around every leaf, in pixels
+    static constexpr double DISPLACEMENT_SCALE = 2.0;  // Extra stretch along the last move
+
+    AABBTree() = default;
+
+    ProxyId Insert(const Rect& box, InstanceHandle owner);
+    void Update(ProxyId proxy, const Rect& box);
+    void Remove(ProxyId proxy);
+    size_t GetProxyCount() const { return proxy_count; }
+    int GetHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+    // Calls fn(owner, box) for every proxy whose box touches area (closed
+    // test). fn returns false to stop early and must not modify or query
+    // the tree itself.
+    template <typename Fn>
+    void Query(const Rect& area, Fn&& fn) {
+        stack.clear();
+        if (root != NULL_NODE) stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (!BoxTouches(node.fat, area)) continue;
+            if (node.IsLeaf()) {
+                if (BoxTouches(node.box, area) && !fn(node.owner, node.box)) return;
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    // Calls fn(a, b) once for every pair of overlapping proxies, by descending
+    // the tree against itself so disjoint subtrees are skipped whole. fn
+    // returns false to stop early.
+    template <typename Fn>
+    void QueryPairs(Fn&& fn) {
+        pair_stack.clear();
+        if (root != NULL_NODE) pair_stack.push_back({ root, root });
+        while (!pair_stack.empty()) {
+            auto [ia, ib] = pair_stack.back();
+            pair_stack.pop_back();
+            const Node& a = nodes[ia];
+            const Node& b = nodes[ib];
+
+            // Pairs within one subtree, then across its two halves
+            if (ia == ib) {
+                if (a.IsLeaf()) continue;
+                pair_stack.push_back({ a.child1, a.child1 });
+                pair_stack.push_back({ a.child2, a.child2 });
+                pair_stack.push_back({ a.child1, a.child2 });
+                continue;
+            }
+
+            if (!BoxTouches(a.fat, b.fat)) continue;
+            if (a.IsLeaf() && b.IsLeaf()) {
+                if (BoxOverlaps(a.box, b.box) && !fn(a.owner, b.owner)) return;
+            } else if (b.IsLeaf() || (!a.IsLeaf() && a.height >= b.height)) {
+                pair_stack.push_back({ a.child1, ib });
+                pair_stack.push_back({ a.child2, ib });
+            } else {
+                pair_stack.push_back({ ia, b.child1 });
+                pair_stack.push_back({ ia, b.child2 });
+            }
+        }
+    }
+
+    // Calls fn(owner, box, t) for each box the segment (x1, y1)-(x2, y2)
+    // hits, t being the entry fraction along the segment. fn returns the
+    // new upper bound on t: return t to look only for nearer hits, 1 to
+    // keep going, or a negative value to stop.
+    template <typename Fn>
+    void RayCast(double x1, double y1, double x2, double y2, Fn&& fn) {
+        const double dx = x2 - x1, dy = y2 - y1;
+        double max_t = 1.0;
+        stack.clear();
+        if (root != NULL_NODE) stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            double t;
+            if (!SegmentEntry(node.fat, x1, y1, dx, dy, max_t, t)) continue;
+            if (node.IsLeaf()) {
+                if (SegmentEntry(node.box, x1, y1, dx, dy, max_t, t)) {
+                    max_t = std::min(max_t, fn(node.owner, node.box, t));
+                    if (max_t < 0) return;
+                }
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+private:
+    static constexpr int32_t NULL_NODE = -1;
+
+    struct Node {
+        Rect fat;  // Leaves: the fattened bbox. Branches: union of the children.
+        Rect box;  // Leaves only: the instance's actual bbox
+        InstanceHandle owner = INVALID_INSTANCE;
+        int32_t parent = NULL_NODE;  // Next free node while on the free list
+        int32_t child1 = NULL_NODE;
+        int32_t child2 = NULL_NODE;
+        int32_t height = -1;  // 0 for leaves, -1 while free
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    int32_t AllocateNode();
+    void FreeNode(int32_t id);
+    void InsertLeaf(int32_t leaf);
+    void RemoveLeaf(int32_t leaf);
+    void Refit(int32_t id);
+    int32_t Balance(int32_t id);
+
+    std::vector<Node> nodes;
+    int32_t root = NULL_NODE;
+    int32_t free_node = NULL_NODE;
+    size_t proxy_count = 0;
+    std::vector<int32_t> stack;  // Traversal scratch, reused across queries
+    std::vector<std::pair<int32_t, int32_t>> pair_stack;
+};
+
+} // namespace GM
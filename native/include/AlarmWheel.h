@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Instance.h"
+#include <cstdint>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Hierarchical timing wheel for instance alarms, keyed by step number
+ *
+ * Level 0 has one slot per step for the next SLOTS steps; each level above
+ * covers SLOTS times the span of the one below, and its slots are poured
+ * into the lower levels as the step counter reaches them. Scheduling is
+ * O(1) and Advance touches only the entries that are due (plus the
+ * occasional cascade), so a room full of idle alarms costs nothing per step.
+ * Entries are never removed: the owner invalidates them by bumping its
+ * token, and stale entries are skipped when they come due.
+ */
+class AlarmWheel {
+public:
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << LEVEL_BITS;
+    static constexpr int LEVELS = 4;  // 2^24 steps; anything later waits in an overflow list
+
+    struct Entry {
+        uint64_t due;      // Step the alarm fires on
+        uint64_t order;    // Instance step order, for firing order within a step
+        InstanceHandle handle;
+        uint32_t token;    // Must still match the instance's, or the entry is stale
+        uint32_t index;    // Alarm number, 0-11
+    };
+
+    // Steps advanced so far
+    uint64_t GetStep() const { return step; }
+
+    // entry.due must be after the current step
+    void Schedule(const Entry& entry);
+
+    // Moves to the next step and appends the entries due on it to out, in
+    // no particular order
+    void Advance(std::vector<Entry>& out);
+
+    size_t GetCount() const { return count; }
+    void Clear();
+
+private:
+    void Place(const Entry& entry);
+    void Cascade(int level);
+
+    std::vector<Entry> slots[LEVELS][SLOTS];
+    std::vector<Entry> overflow;
+    uint64_t step = 0;
+    size_t count = 0;
+};
+
+} // namespace GM
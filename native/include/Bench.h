@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+namespace GM {
+
+// Timing helpers shared by the *_Bench executables
+namespace Bench {
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Seconds elapsed since start
+inline double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Average seconds per call of op; one untimed call first warms the caches,
+// the allocator and the SIMD dispatch table
+inline double TimeOp(int iterations, const std::function<void()>& op) {
+    op();
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        op();
+    }
+    return Seconds(start) / iterations;
+}
+
+} // namespace Bench
+
+} // namespace GM
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "GMLTypes.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace GM {
+
+// Collision broadphase backends. Both index instance bboxes under the same
+// interface (Insert/Update/Remove, Query, QueryPairs, RayCast), so a room
+// can switch between them without the queries noticing.
+enum class BroadphaseType {
+    Grid = 0,  // SpatialGrid: uniform cells, best for evenly sized instances
+    Tree = 1,  // AABBTree: adapts to mixed sizes and sparse or clustered rooms
+};
+
+using ProxyId = uint32_t;
+constexpr ProxyId NULL_PROXY = 0xFFFFFFFFu;
+
+// Boxes are half-open, [x1, x2) x [y1, y2)
+inline bool BoxOverlaps(const Rect& a, const Rect& b) {
+    return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+// Closed test, so a zero-size box (a point) still touches
+inline bool BoxTouches(const Rect& a, const Rect& b) {
+    return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+inline bool BoxContains(const Rect& outer, const Rect& inner) {
+    return outer.x1 <= inner.x1 && outer.y1 <= inner.y1 && inner.x2 <= outer.x2 && inner.y2 <= outer.y2;
+}
+
+// Slab test of the segment (x, y) + t * (dx, dy), t in [0, max_t], against
+// box. On a hit, t is the entry fraction (0 if the segment starts inside).
+inline bool SegmentEntry(const Rect& box, double x, double y, double dx, double dy, double max_t, double& t) {
+    double t0 = 0, t1 = max_t;
+    const double origin[2] = { x, y }, dir[2] = { dx, dy };
+    const double lo[2] = { box.x1, box.y1 }, hi[2] = { box.x2, box.y2 };
+    for (int axis = 0; axis < 2; axis++) {
+        if (dir[axis] == 0) {
+            if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) return false;
+            continue;
+        }
+        double inv = 1.0 / dir[axis];
+        double near_t = (lo[axis] - origin[axis]) * inv;
+        double far_t = (hi[axis] - origin[axis]) * inv;
+        if (near_t > far_t) std::swap(near_t, far_t);
+        t0 = std::max(t0, near_t);
+        t1 = std::min(t1, far_t);
+        if (t0 > t1) return false;
+    }
+    t = t0;
+    return true;
+}
+
+} // namespace GM
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "VM_Value.h"
+#include "HandleTable.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class IFileIO;
+
+namespace GM {
+
+class VirtualMachine;
+
+// GML buffer_* format constants
+enum class BufferType {
+    Fixed = 0,
+    Grow = 1,
+    Wrap = 2,
+    Fast = 3,
+};
+
+// GML buffer_u8 .. buffer_text data type constants
+enum class BufferDataType {
+    U8 = 1,
+    S8 = 2,
+    U16 = 3,
+    S16 = 4,
+    U32 = 5,
+    S32 = 6,
+    F16 = 7,
+    F32 = 8,
+    F64 = 9,
+    Bool = 10,
+    String = 11,
+    U64 = 12,
+    Text = 13,
+};
+
+// GML buffer_seek_* constants
+enum class BufferSeek {
+    Start = 0,
+    Relative = 1,
+    End = 2,
+};
+
+// Status codes returned to GML by buffer_write and friends
+enum class BufferResult : int {
+    Ok = 0,
+    GeneralError = -1,
+    OutOfSpace = -2,
+    OutOfBounds = -3,
+    InvalidType = -4,
+    UnknownBuffer = -5,
+};
+
+// Byte size of a fixed-width type; 0 for strings and unknown types
+size_t BufferSizeOf(BufferDataType type);
+
+/**
+ * Pool of 64-byte aligned memory blocks for buffer storage
+ *
+ * Blocks up to 16 MB are rounded to power-of-two size classes and recycled
+ * through per-class free lists, so replay and save code that creates and
+ * deletes buffers every frame does not hit the system allocator. Larger
+ * blocks are rounded to 64 KB and go straight back to the system. Requests
+ * above MAX_SIZE, or that the system cannot satisfy, fail with null.
+ */
+class BufferArena {
+public:
+    static constexpr size_t BLOCK_ALIGNMENT = 64;
+    static constexpr size_t MAX_SIZE = (size_t)1 << 31;   // 2 GB
+
+    BufferArena() = default;
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+    ~BufferArena();
+
+    // Returns a block of at least size bytes, or null; capacity receives the real size
+    uint8_t* Allocate(size_t size, size_t& capacity);
+    void Release(uint8_t* block, size_t capacity);
+
+    // Frees every pooled block
+    void Trim();
+    size_t GetPooledBytes() const { return pooled_bytes; }
+
+private:
+    static constexpr size_t MIN_CLASS = 6;    // 64 bytes
+    static constexpr size_t MAX_CLASS = 24;   // 16 MB
+    static constexpr size_t MAX_POOLED_BYTES = 64u << 20;
+
+    std::vector<uint8_t*> free_blocks[MAX_CLASS + 1];
+    size_t pooled_bytes = 0;
+};
+
+// Read-only window onto buffer memory; valid until the buffer is resized or deleted
+struct BufferView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * GML buffer
+ *
+ * Fixed-width reads and writes are inline memcpy accesses with a single
+ * bounds check; alignment padding, wrapping and growth are handled out of
+ * line. Values are stored little-endian, which is the native order of every
+ * platform we ship on.
+ *
+ * Storage is an arena block, memory adopted from IFileIO::LoadFile (loaded
+ * files are never copied), or an external view that writes through to
+ * memory owned elsewhere. Resizing always moves the data into an arena block.
+ */
+class Buffer {
+public:
+    Buffer(BufferArena& arena, BufferType type, size_t size, size_t alignment);
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    ~Buffer();
+
+    // Takes ownership of memory returned by io.LoadFile; released with io.FreeFile
+    static std::unique_ptr<Buffer> Adopt(BufferArena& arena, IFileIO& io, void* data, size_t size);
+    // Non-owning fixed buffer over external memory
+    static std::unique_ptr<Buffer> CreateView(BufferArena& arena, void* data, size_t size);
+
+    BufferType GetType() const { return type; }
+    size_t GetSize() const { return size; }
+    size_t GetUsedSize() const { return used_size; }
+    size_t GetAlignment() const { return alignment; }
+    uint8_t* GetData() { return data; }
+    const uint8_t* GetData() const { return data; }
+    BufferView GetView(size_t offset, size_t length) const;
+
+    size_t Tell() const { return index; }
+    size_t Seek(BufferSeek base, int64_t offset);
+    // False, leaving the buffer as it was, if the new size cannot be allocated
+    bool Resize(size_t new_size);
+
+    // Typed sequential access (buffer_write / buffer_read)
+    template <typename T>
+    BufferResult Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "buffer values must be trivially copyable");
+        size_t pos = AlignedIndex();
+        if (pos + sizeof(T) > size) return WriteBytesSlow(&value, sizeof(T));
+        std::memcpy(data + pos, &value, sizeof(T));
+        index = pos + sizeof(T);
+        if (index > used_size) used_size = index;
+        return BufferResult::Ok;
+    }
+
+    template <typename T>
+    bool Read(T& out) {
+        static_assert(std::is_trivially_copyable<T>::value, "buffer values must be trivially copyable");
+        size_t pos = AlignedIndex();
+        if (pos + sizeof(T) > size) return ReadBytesSlow(&out, sizeof(T));
+        std::memcpy(&out, data + pos, sizeof(T));
+        index = pos + sizeof(T);
+        return true;
+    }
+
+    BufferResult WriteBytes(const void* src, size_t length);
+    bool ReadBytes(void* dst, size_t length);
+    BufferResult WriteString(const std::string& str, bool terminate);
+    bool ReadString(std::string& out);
+
+    // GML-typed access with GameMaker's conversion rules
+    BufferResult WriteValue(BufferDataType type, const Value& val);
+    Value ReadValue(BufferDataType type);
+    Value Peek(BufferDataType type, int64_t offset) const;
+    BufferResult Poke(BufferDataType type, int64_t offset, const Value& val);
+    BufferResult Fill(int64_t offset, BufferDataType type, const Value& val, int64_t length);
+
+    // buffer_copy: clamps/wraps both ranges, growing the destination when it is a grow buffer
+    BufferResult CopyTo(Buffer& dest, int64_t src_offset, int64_t length, int64_t dest_offset) const;
+
+private:
+    enum class Storage { Arena, Adopted, View };
+
+    Buffer(BufferArena& arena, BufferType type, size_t alignment);
+
+    size_t AlignedIndex() const {
+        return ((index + align_offset + alignment - 1) & ~(alignment - 1)) - align_offset;
+    }
+    // Aligns index, wraps it and makes room for an access; false if it cannot fit
+    bool PrepareAccess(size_t length, bool writing);
+    BufferResult WriteBytesSlow(const void* src, size_t length);
+    bool ReadBytesSlow(void* dst, size_t length);
+    // Copies across the end of a wrap buffer, advancing index
+    void WrapCopyIn(const void* src, size_t length);
+    void WrapCopyOut(void* dst, size_t length);
+    // Offset for peek/poke style access, or -1 if out of range
+    int64_t ResolveOffset(int64_t offset, size_t length) const;
+    void ReleaseStorage();
+
+    BufferArena& arena;
+    BufferType type;
+    Storage storage = Storage::Arena;
+    IFileIO* owner_io = nullptr;
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t used_size = 0;
+    size_t index = 0;
+    size_t alignment = 1;
+    size_t align_offset = 0;
+};
+
+// Owns every live buffer and the arena that backs them
+class BufferManager {
+public:
+    HandleTable<Buffer>& GetBuffers() { return buffers; }
+    BufferArena& GetArena() { return arena; }
+
+    // File access for buffer_save/buffer_load; buffers stay usable without it
+    IFileIO* GetFileIO() const { return file_io; }
+    void SetFileIO(IFileIO* io) { file_io = io; }
+
+    int64_t Create(BufferType type, size_t size, size_t alignment);
+    int64_t Load(const std::string& path);
+    void Clear() { buffers.Clear(); }
+
+private:
+    BufferArena arena;   // Declared first so it outlives the buffers
+    HandleTable<Buffer> buffers;
+    IFileIO* file_io = nullptr;
+};
+
+// Registers buffer_create, buffer_read/write, buffer_peek/poke, buffer_copy, buffer_save/load, ...
+void RegisterBufferBuiltins(VirtualMachine& vm, BufferManager& buffers);
+
+} // namespace GM
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "GMLTypes.h"
+#include "Instance.h"
+#include <cstdint>
+
+namespace GM {
+
+class Room;
+class RoomManager;
+class VirtualMachine;
+
+/**
+ * Instance collision queries and collision events
+ *
+ * Everything is answered from the room's broadphase (grid or tree), so a
+ * query only looks at instances near its shape. Shapes are tested against the
+ * instances' bboxes, then against the per-pixel mask of any instance whose
+ * collision sprite is precise (instance-to-instance tests always are). The
+ * object argument selects candidates: an object index matches instances of
+ * that object and of its descendants, and OBJECT_ALL matches every
+ * instance. Inactive and destroyed instances and notme are never reported.
+ */
+namespace Collision {
+
+constexpr int32_t OBJECT_ALL = -3;  // GML `all`
+constexpr double NOONE = -4;        // GML `noone`
+
+// The first instance overlapping inst's bbox moved to (x, y)
+InstanceHandle InstancePlace(Room& room, Instance* inst, double x, double y, int32_t object);
+bool PlaceMeeting(Room& room, Instance* inst, double x, double y, int32_t object);
+
+// The first instance touching the point, rectangle or circle. With
+// precise set, instances with precise sprites are tested against their
+// masks; circles always use bboxes.
+InstanceHandle Point(Room& room, double x, double y, int32_t object, bool precise = false,
+                     InstanceHandle notme = INVALID_INSTANCE);
+InstanceHandle Rectangle(Room& room, double x1, double y1, double x2, double y2, int32_t object,
+                         bool precise = false, InstanceHandle notme = INVALID_INSTANCE);
+InstanceHandle Circle(Room& room, double x, double y, double radius, int32_t object,
+                      InstanceHandle notme = INVALID_INSTANCE);
+
+// The instance nearest to (x1, y1) that the segment to (x2, y2) hits
+InstanceHandle Line(Room& room, double x1, double y1, double x2, double y2, int32_t object,
+                    InstanceHandle notme = INVALID_INSTANCE);
+
+// Fires the collision events of every instance whose object has any,
+// once per overlapping instance of the event's target object. Candidates
+// are collected before the events run, so events may move instances and
+// run their own queries.
+void DispatchEvents(Room& room);
+
+} // namespace Collision
+
+// collision_point / rectangle / circle / line against the
+// current room. The VM has no calling instance, so notme is ignored.
+void RegisterCollisionBuiltins(VirtualMachine& vm, RoomManager& rooms);
+
+} // namespace GM
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "GMLTypes.h"
+#include <cstdint>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Precise (per-pixel) collision mask for one sprite frame
+ *
+ * Pixels are bit-packed 64 to a word, least significant bit first, with one
+ * zero word of padding after every row so unaligned 64-bit reads near the
+ * right edge never leave the row. Masks are generated once from texture
+ * alpha when the sprite loads.
+ */
+class CollisionMask {
+public:
+    CollisionMask() = default;
+    CollisionMask(uint32_t width, uint32_t height);
+
+    // Pixels whose alpha is above tolerance are solid
+    static CollisionMask FromRGBA(const uint8_t* pixels, uint32_t width, uint32_t height,
+                                  uint32_t pitch, uint8_t tolerance = 0);
+
+    uint32_t GetWidth() const { return width; }
+    uint32_t GetHeight() const { return height; }
+
+    bool Get(int32_t x, int32_t y) const {
+        if (x < 0 || y < 0 || (uint32_t)x >= width || (uint32_t)y >= height) return false;
+        return (bits[(size_t)y * stride + ((uint32_t)x >> 6)] >> (x & 63)) & 1;
+    }
+    void Set(uint32_t x, uint32_t y, bool solid);
+
+    // The 64 pixels of row y starting at column x (which need not be word
+    // aligned); pixels past the right edge read as empty
+    uint64_t GetBits(uint32_t y, uint32_t x) const {
+        const uint64_t* row = GetRow(y);
+        uint32_t word = x >> 6, shift = x & 63;
+        if (shift == 0) return row[word];
+        return (row[word] >> shift) | (row[word + 1] << (64 - shift));
+    }
+    const uint64_t* GetRow(uint32_t y) const { return bits.data() + (size_t)y * stride; }
+    uint32_t GetStride() const { return stride; }  // Words from one row to the next
+
+    // Tight bounds of the solid pixels, in mask pixels (half-open); call
+    // UpdateBounds after editing with Set
+    const Rect& GetBounds() const { return bounds; }
+    bool IsEmpty() const { return bounds.x2 <= bounds.x1; }
+    void UpdateBounds();
+
+private:
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 1;  // Words per row, including the padding word
+    std::vector<uint64_t> bits;
+    Rect bounds;
+};
+
+/**
+ * A mask as an instance places it in the room: drawn at (x, y) around its
+ * origin, scaled, then rotated counterclockwise by angle degrees
+ */
+struct MaskPlacement {
+    const CollisionMask* mask = nullptr;
+    double x = 0, y = 0;
+    double xorigin = 0, yorigin = 0;
+    double xscale = 1, yscale = 1;
+    double angle = 0;
+
+    // Unscaled and unrotated, so mask rows map straight onto room rows
+    bool IsAxisAligned() const;
+
+    // Room-space box around the solid pixels
+    Rect GetBounds() const;
+};
+
+// Room-space box around box (in mask pixels, half-open) placed as p; p.mask
+// is not used. An unscaled, unrotated box is just offset.
+Rect PlaceBox(const MaskPlacement& p, const Rect& box);
+
+// Whether any solid pixel of a covers a solid pixel of b. Pixels are
+// compared at room pixel centers; unscaled, unrotated pairs are compared a
+// row of words at a time.
+bool MasksOverlap(const MaskPlacement& a, const MaskPlacement& b);
+
+// Whether the room pixel holding (x, y) is solid
+bool MaskContainsPoint(const MaskPlacement& p, double x, double y);
+
+// Whether any solid pixel's center lies inside area (closed)
+bool MaskOverlapsRect(const MaskPlacement& p, const Rect& area);
+
+} // namespace GM
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Deferred writes recorded during a parallel step
+ *
+ * While the engine runs a chunk of self-only events on a pool thread, that
+ * thread's buffer is current, and anything that would touch shared state
+ * (another instance, a room's lists and queues, globals) is recorded here
+ * instead. The engine applies the chunks' buffers in chunk order at the
+ * barrier, so the writes land in instance order whatever the thread count.
+ */
+class CommandBuffer {
+public:
+    using Command = std::function<void()>;
+
+    void Defer(Command command) { commands.push_back(std::move(command)); }
+
+    // Runs the recorded commands in order and clears them. Call with no
+    // buffer current, so the commands take effect immediately.
+    void Apply() {
+        for (Command& command : commands) command();
+        commands.clear();
+    }
+
+    bool IsEmpty() const { return commands.empty(); }
+
+    // The buffer the calling thread records into, or null outside a
+    // parallel run
+    static CommandBuffer* Current() { return current; }
+    static void SetCurrent(CommandBuffer* buffer) { current = buffer; }
+
+private:
+    std::vector<Command> commands;
+    static thread_local CommandBuffer* current;
+};
+
+inline thread_local CommandBuffer* CommandBuffer::current = nullptr;
+
+// Runs fn now, or defers it to the barrier when called from a parallel run
+template <typename Fn>
+void RunOrDefer(Fn&& fn) {
+    if (CommandBuffer* buffer = CommandBuffer::Current()) buffer->Defer(std::forward<Fn>(fn));
+    else fn();
+}
+
+} // namespace GM
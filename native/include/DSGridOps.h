@@ -0,0 +1,41 @@
+#pragma once
+
+#include "DataStructures.h"
+#include "SimdDispatch.h"
+#include <cstddef>
+
+namespace GM {
+
+// Aggregate over a grid region or disk (ds_grid_get_sum/min/max/mean)
+struct GridStats {
+    double sum = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    size_t count = 0;
+
+    double Mean() const { return count > 0 ? sum / (double)count : 0.0; }
+};
+
+/**
+ * Bulk ds_grid operations
+ *
+ * Rectangles and disks are decomposed into contiguous row spans that run
+ * through SSE2/AVX2 kernels chosen by GetSimdLevel(). Grids holding boxed
+ * (non-real) cells take a per-cell scalar path with GameMaker's mixed-type
+ * semantics. Region corners may be given in any order and are clamped to the grid.
+ */
+namespace GridOps {
+
+void SetRegion(DSGrid& grid, int64_t x1, int64_t y1, int64_t x2, int64_t y2, const Value& val);
+void AddRegion(DSGrid& grid, int64_t x1, int64_t y1, int64_t x2, int64_t y2, const Value& val);
+void MultiplyRegion(DSGrid& grid, int64_t x1, int64_t y1, int64_t x2, int64_t y2, const Value& val);
+GridStats GetRegionStats(const DSGrid& grid, int64_t x1, int64_t y1, int64_t x2, int64_t y2);
+
+void SetDisk(DSGrid& grid, double x, double y, double r, const Value& val);
+void AddDisk(DSGrid& grid, double x, double y, double r, const Value& val);
+void MultiplyDisk(DSGrid& grid, double x, double y, double r, const Value& val);
+GridStats GetDiskStats(const DSGrid& grid, double x, double y, double r);
+
+} // namespace GridOps
+
+} // namespace GM
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "GMLTypes.h"
+#include "VM_Value.h"
+#include "HandleTable.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace GM {
+
+class VirtualMachine;
+
+// GML ds_type_* constants
+enum class DSType {
+    Map = 1,
+    List = 2,
+    Stack = 3,
+    Queue = 4,
+    Grid = 5,
+    Priority = 6,
+};
+
+/**
+ * ds_list - contiguous array of values
+ */
+class DSList {
+public:
+    size_t Size() const { return items.size(); }
+    bool Empty() const { return items.empty(); }
+    void Clear() { items.clear(); }
+
+    void Add(const Value& val) { items.push_back(val); }
+    Value Get(size_t index) const;
+    void Set(size_t index, const Value& val);      // Pads with 0 when writing past the end
+    void Insert(size_t index, const Value& val);
+    void Delete(size_t index);
+    int64_t FindIndex(const Value& val) const;
+    void Sort(bool ascending);
+
+    std::vector<Value>& GetItems() { return items; }
+    const std::vector<Value>& GetItems() const { return items; }
+
+private:
+    std::vector<Value> items;
+};
+
+/**
+ * ds_map - open-addressing hash map (linear probing, power-of-two capacity)
+ * Keys compare strictly: the real 1 and the string "1" are different keys.
+ */
+class DSMap {
+public:
+    DSMap();
+
+    size_t Size() const { return count; }
+    bool Empty() const { return count == 0; }
+    void Clear();
+
+    Value* Find(const Value& key);
+    const Value* Find(const Value& key) const;
+    bool Contains(const Value& key) const { return Find(key) != nullptr; }
+
+    // Inserts or overwrites; returns true if the key was new
+    bool Set(const Value& key, const Value& val);
+    // Inserts only if absent; returns false if the key already existed
+    bool Add(const Value& key, const Value& val);
+    bool Remove(const Value& key);
+
+    // Iteration in slot order (ds_map_find_first / ds_map_find_next)
+    const Value* FirstKey() const;
+    const Value* NextKey(const Value& key) const;
+
+private:
+    enum class SlotState : uint8_t { Empty, Full, Deleted };
+
+    struct Entry {
+        Value key;
+        Value value;
+        uint32_t hash = 0;
+        SlotState state = SlotState::Empty;
+    };
+
+    size_t FindSlot(const Value& key, uint32_t hash) const;
+    const Value* KeyFromSlot(size_t start) const;
+    void Rehash(size_t new_capacity);
+
+    std::vector<Entry> entries;
+    size_t count = 0;
+    size_t tombstones = 0;
+};
+
+/**
+ * ds_grid - dense row-major grid
+ * Real values live in a contiguous double array so bulk operations can stream
+ * over it; the rare non-real cells (strings, undefined) are boxed on the side.
+ */
+class DSGrid {
+public:
+    // Largest grid ds_grid_create and ds_grid_resize accept: 2 GB of reals
+    static constexpr uint64_t MAX_CELLS = (uint64_t)1 << 28;
+
+    DSGrid(uint32_t width, uint32_t height);
+
+    uint32_t GetWidth() const { return width; }
+    uint32_t GetHeight() const { return height; }
+    bool InBounds(int64_t x, int64_t y) const {
+        return x >= 0 && y >= 0 && x < (int64_t)width && y < (int64_t)height;
+    }
+
+    Value Get(uint32_t x, uint32_t y) const;
+    void Set(uint32_t x, uint32_t y, const Value& val);
+    void Add(uint32_t x, uint32_t y, const Value& val);
+    void Multiply(uint32_t x, uint32_t y, const Value& val);
+    void Clear(const Value& val);
+    void Resize(uint32_t new_width, uint32_t new_height);
+    void CopyFrom(const DSGrid& other);
+
+    // Raw access for bulk operations; only meaningful for unboxed cells
+    double* GetReals() { return reals.data(); }
+    const double* GetReals() const { return reals.data(); }
+    bool HasBoxedCells() const { return !boxed.empty(); }
+    bool IsBoxed(size_t index) const { return !boxed.empty() && boxed.count(index) != 0; }
+
+private:
+    size_t Index(uint32_t x, uint32_t y) const { return (size_t)y * width + x; }
+
+    uint32_t width;
+    uint32_t height;
+    std::vector<double> reals;
+    std::unordered_map<size_t, Value> boxed;
+};
+
+/**
+ * ds_priority - binary min-heap of (priority, value) pairs
+ * Max queries scan the leaf half of the heap, where the maximum must live.
+ */
+class DSPriority {
+public:
+    size_t Size() const { return heap.size(); }
+    bool Empty() const { return heap.empty(); }
+    void Clear() { heap.clear(); }
+
+    void Add(const Value& val, double priority);
+    bool ChangePriority(const Value& val, double priority);
+    bool FindPriority(const Value& val, double& out_priority) const;
+    bool DeleteValue(const Value& val);
+
+    Value FindMin() const;
+    Value DeleteMin();
+    Value FindMax() const;
+    Value DeleteMax();
+
+private:
+    struct Node {
+        double priority;
+        Value value;
+    };
+
+    int64_t IndexOf(const Value& val) const;
+    size_t MaxIndex() const;
+    void RemoveAt(size_t index);
+    void SiftUp(size_t index);
+    void SiftDown(size_t index);
+
+    std::vector<Node> heap;
+};
+
+// Strict key equality/hash shared by ds_map, ds_list and ds_priority lookups
+bool DSValuesEqual(const Value& a, const Value& b);
+uint32_t DSHashValue(const Value& v);
+
+// Owns every live data structure, each behind its own generational handle table
+class DataStructureManager {
+public:
+    HandleTable<DSList>& GetLists() { return lists; }
+    HandleTable<DSMap>& GetMaps() { return maps; }
+    HandleTable<DSGrid>& GetGrids() { return grids; }
+    HandleTable<DSPriority>& GetPriorities() { return priorities; }
+
+    bool Exists(int64_t handle, DSType type) const;
+    void Clear();
+
+private:
+    HandleTable<DSList> lists;
+    HandleTable<DSMap> maps;
+    HandleTable<DSGrid> grids;
+    HandleTable<DSPriority> priorities;
+};
+
+// Registers ds_list_*, ds_map_*, ds_grid_*, ds_priority_* and ds_exists
+void RegisterDataStructureBuiltins(VirtualMachine& vm, DataStructureManager& ds);
+
+} // namespace GM
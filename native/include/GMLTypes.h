@@ -74,6 +74,8 @@ enum class EventType {
     PostDraw = 14,
 };
 
+constexpr int EVENT_TYPE_COUNT = 15;
+
 enum class StepEventType {
     BeginStep = 0,
     NormalStep = 1,
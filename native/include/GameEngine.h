@@ -3,6 +3,10 @@
 #include "GMLTypes.h"
 #include "Managers.h"
 #include "IPlatform.h"
+#include "CommandBuffer.h"
+#include "ThreadPool.h"
+#include "RoomBuilder.h"
+#include <map>
 #include <memory>
 
 namespace GM {
@@ -22,9 +26,20 @@ public:
     void Update();
     void Draw();
 
-    // Room management
+    // Room management. Leaving a persistent room freezes it and entering
+    // it again thaws it (see Room::Freeze); other rooms run their
+    // instances' destroy events on the way out and create events on the
+    // way in.
     void LoadRoom(std::shared_ptr<Room> room);
-    void SwitchRoom(uint32_t room_id, bool starting = false);
+    void SwitchRoom(uint32_t room_id, bool starting = false);  // starting: no room to end
+
+    // Preloading. A room's instances are built from its placements when it
+    // is first entered; PrefetchRoom does the bulk of that on a background
+    // thread beforehand (see RoomBuilder), so entering the room only
+    // registers its instances and runs their create events. A prefetched
+    // room must be left alone until it is entered.
+    void PrefetchRoom(uint32_t room_id);
+    bool IsRoomPrefetched(uint32_t room_id) const;  // The background part is done
 
     // State
     bool IsRunning() const { return running; }
@@ -46,10 +61,27 @@ public:
     double GetTimeScale() const { return time_scale; }
     void SetTimeScale(double scale) { time_scale = scale; }
 
+    // Threads for the parallel parts of a step: builtin motion and
+    // animation, and long runs of self-only step events (see
+    // Object::SetEventCallback). 0 uses one per hardware thread; 1 runs
+    // everything on the calling thread. Results do not depend on the count.
+    size_t GetStepThreads() const { return step_threads; }
+    void SetStepThreads(size_t threads);
+
+    // Below these sizes a pass stays on the calling thread
+    static constexpr size_t PARALLEL_MIN_RUN = 512;      // Consecutive self-only subscribers
+    static constexpr size_t PARALLEL_MIN_ROWS = 4096;    // Instance store rows
+
 private:
     void DoStep();
+    void RunStepEvent(Room& room, Room::EventList list, StepEventType type);
+    void RunSelfOnly(const std::vector<Room::Subscriber>& subscribers, size_t begin, size_t end,
+                     StepEventType type);
+    void RunBuiltins(InstanceStore& store);
+    ThreadPool& GetStepPool();
     void RoomStart(std::shared_ptr<Room> room, bool starting);
     void RoomEnd(std::shared_ptr<Room> room);
+    void BuildRoom(const std::shared_ptr<Room>& room);
 
     IPlatform* platform;
     GameGlobals globals;
@@ -63,6 +95,15 @@ private:
     double frame_accumulator = 0.0;
     double fps_timer = 0.0;
     int fps_frame_count = 0;
+
+    // Parallel step
+    size_t step_threads = 0;
+    std::unique_ptr<ThreadPool> step_pool;
+    std::vector<CommandBuffer> step_commands;  // One per chunk of a run
+
+    // Prefetches not yet entered, by room id. Declared after globals, so
+    // unentered ones finish while the instance manager is still there.
+    std::map<uint32_t, std::unique_ptr<RoomBuilder>> room_builders;
 };
 
 } // namespace GM
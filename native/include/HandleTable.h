@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Generational handle table
+ *
+ * Handles pack a slot index (low IndexBits, 20 by default) and a generation
+ * (the next GenerationBits, 12 by default).
+ * Destroying an object bumps its slot's generation, so a stale handle to a
+ * recycled slot fails to resolve instead of aliasing the new object.
+ * The first handle issued for a slot equals its index, which keeps ids
+ * identical to GameMaker's small-integer ids in the common case. Handles
+ * are at most 53 bits wide so they survive a round trip through a GML real.
+ * Deleter lets pooled objects go back to their pool instead of the heap.
+ */
+template <typename T, uint32_t IndexBits = 20, uint32_t GenerationBits = 12,
+          typename Deleter = std::default_delete<T>>
+class HandleTable {
+public:
+    static_assert(IndexBits <= 31 && GenerationBits <= 31 && IndexBits + GenerationBits <= 53,
+                  "handles must fit in a double's mantissa");
+
+    static constexpr uint32_t INDEX_BITS = IndexBits;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << GenerationBits) - 1;
+    static constexpr int64_t MAX_HANDLE = ((int64_t)1 << (IndexBits + GenerationBits)) - 1;
+    static constexpr int64_t INVALID_HANDLE = -1;
+
+    using Pointer = std::unique_ptr<T, Deleter>;
+
+    // Takes ownership of obj and returns its handle
+    int64_t Create(Pointer obj) {
+        int64_t handle = Reserve();
+        if (handle != INVALID_HANDLE) Fill(handle, std::move(obj));
+        return handle;
+    }
+
+    // Takes a slot for an object that is still being built elsewhere. The
+    // handle resolves to nullptr until Fill hands the object over;
+    // Unreserve gives the slot back unused.
+    int64_t Reserve() {
+        uint32_t index;
+        if (!free_slots.empty()) {
+            index = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            if (slots.size() > INDEX_MASK) return INVALID_HANDLE;
+            index = (uint32_t)slots.size();
+            slots.emplace_back();
+        }
+        return MakeHandle(index, slots[index].generation);
+    }
+
+    void Fill(int64_t handle, Pointer obj) {
+        slots[(uint32_t)handle & INDEX_MASK].object = std::move(obj);
+        count++;
+    }
+
+    void Unreserve(int64_t handle) {
+        uint32_t index = (uint32_t)handle & INDEX_MASK;
+        Slot& slot = slots[index];
+        slot.generation = (slot.generation + 1) & GENERATION_MASK;
+        free_slots.push_back(index);
+    }
+
+    // O(1) resolution; returns nullptr for destroyed or never-issued handles
+    T* Get(int64_t handle) const {
+        if (handle < 0 || handle > MAX_HANDLE) return nullptr;
+        uint32_t index = (uint32_t)handle & INDEX_MASK;
+        uint32_t generation = (uint32_t)(handle >> INDEX_BITS);
+        if (index >= slots.size()) return nullptr;
+        const Slot& slot = slots[index];
+        if (slot.generation != generation) return nullptr;
+        return slot.object.get();
+    }
+
+    bool Exists(int64_t handle) const { return Get(handle) != nullptr; }
+
+    bool Destroy(int64_t handle) {
+        if (!Get(handle)) return false;
+        uint32_t index = (uint32_t)handle & INDEX_MASK;
+        Slot& slot = slots[index];
+        slot.object.reset();
+        slot.generation = (slot.generation + 1) & GENERATION_MASK;
+        free_slots.push_back(index);
+        count--;
+        return true;
+    }
+
+    void Clear() {
+        for (uint32_t i = 0; i < slots.size(); i++) {
+            if (slots[i].object) Destroy(MakeHandle(i, slots[i].generation));
+        }
+    }
+
+    size_t Count() const { return count; }
+
+private:
+    struct Slot {
+        Pointer object;
+        uint32_t generation = 0;
+    };
+
+    static int64_t MakeHandle(uint32_t index, uint32_t generation) {
+        return ((int64_t)generation << INDEX_BITS) | index;
+    }
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    size_t count = 0;
+};
+
+} // namespace GM
@@ -1,10 +1,13 @@
 #pragma once
 #include <cstddef>
+#include <cstdlib>
 
 class IFileIO {
 public:
     virtual ~IFileIO() {}
     virtual bool LoadFile(const char* path, void*& data, size_t& size) = 0;
     virtual bool SaveFile(const char* path, const void* data, size_t size) = 0;
+    // Releases memory returned by LoadFile; override if it does not come from malloc
+    virtual void FreeFile(void* data) { std::free(data); }
     // Add async, asset-pack, etc.
 };
@@ -1,81 +1,116 @@
 #pragma once
 
 #include "GMLTypes.h"
+#include "Broadphase.h"
+#include "InstanceStore.h"
 #include <memory>
 #include <vector>
 #include <map>
 
 namespace GM {
 
+class Layer;
 class Object;
 class Room;
 class Sprite;
 
+// Generational reference to an instance, issued by InstanceManager.
+// A handle to a destroyed instance resolves to nullptr.
+using InstanceHandle = int64_t;
+constexpr InstanceHandle INVALID_INSTANCE = -1;
+
+/**
+ * A placed object instance
+ *
+ * The builtin fields read every step are kept in an InstanceStore row
+ * (see InstanceStore.h); the accessors below forward to it. Rarely used
+ * state such as alarms, scale and GML variables stays on the object.
+ *
+ * Instances are owned by InstanceManager; everything else refers to them
+ * by InstanceHandle.
+ */
 class Instance {
 public:
-    Instance(double x, double y, uint32_t id, std::shared_ptr<Object> object);
+    Instance(double x, double y, uint32_t id, Object* object);
+    Instance(double x, double y, uint32_t id, Object* object, InstanceStore& dst);  // Starts out in dst
     ~Instance();
 
+    Instance(const Instance&) = delete;
+    Instance& operator=(const Instance&) = delete;
+
+    // Moves this instance's builtin fields into another store (e.g. a room's)
+    void MoveToStore(InstanceStore& dst);
+    InstanceStore* GetStore() const { return store; }
+    uint32_t GetRow() const { return row; }
+
     // Position
-    double GetX() const { return x; }
-    double GetY() const { return y; }
-    void SetX(double val) { xprevious = x; x = val; }
-    void SetY(double val) { yprevious = y; y = val; }
+    double GetX() const { return store->x[row]; }
+    double GetY() const { return store->y[row]; }
+    void SetX(double val) { store->xprevious[row] = store->x[row]; store->x[row] = val; MarkBBoxDirty(); }
+    void SetY(double val) { store->yprevious[row] = store->y[row]; store->y[row] = val; MarkBBoxDirty(); }
     
-    double GetXPrevious() const { return xprevious; }
-    double GetYPrevious() const { return yprevious; }
+    double GetXPrevious() const { return store->xprevious[row]; }
+    double GetYPrevious() const { return store->yprevious[row]; }
     double GetXStart() const { return xstart; }
     double GetYStart() const { return ystart; }
 
     // Motion
-    double GetHSpeed() const { return hspeed; }
-    double GetVSpeed() const { return vspeed; }
-    void SetHSpeed(double val) { hspeed = val; }
-    void SetVSpeed(double val) { vspeed = val; }
+    double GetHSpeed() const { return store->hspeed[row]; }
+    double GetVSpeed() const { return store->vspeed[row]; }
+    void SetHSpeed(double val) { store->hspeed[row] = val; }
+    void SetVSpeed(double val) { store->vspeed[row] = val; }
     
     double GetSpeed() const { return speed; }
     double GetDirection() const { return direction; }
     void SetSpeed(double val) { speed = val; }
     void SetDirection(double val) { direction = val; }
     
-    double GetFriction() const { return friction; }
-    double GetGravity() const { return gravity; }
-    double GetGravityDirection() const { return gravity_direction; }
+    double GetFriction() const { return store->friction[row]; }
+    double GetGravity() const { return store->gravity[row]; }
+    double GetGravityDirection() const { return store->gravity_direction[row]; }
     
-    void SetFriction(double val) { friction = val; }
-    void SetGravity(double val) { gravity = val; }
-    void SetGravityDirection(double val) { gravity_direction = val; }
+    void SetFriction(double val) { store->friction[row] = val; }
+    void SetGravity(double val) { store->gravity[row] = val; }
+    void SetGravityDirection(double val) { store->SetGravityDirection(row, val); }
 
     // Visibility and drawing
-    bool GetVisible() const { return visible; }
-    void SetVisible(bool val) { visible = val; }
+    bool GetVisible() const { return store->HasFlag(row, InstanceStore::FLAG_VISIBLE); }
+    void SetVisible(bool val) { store->SetFlag(row, InstanceStore::FLAG_VISIBLE, val); }
     
-    bool GetActive() const { return active; }
-    void SetActive(bool val) { active = val; }
+    // Deactivating takes the instance out of everything its room runs per
+    // step (see Room::DeactivateRegion). It keeps its alarms but stops
+    // counting them down.
+    bool GetActive() const { return store->HasFlag(row, InstanceStore::FLAG_ACTIVE); }
+    void SetActive(bool val);
     
-    bool GetSolid() const { return solid; }
-    void SetSolid(bool val) { solid = val; }
+    bool GetSolid() const { return store->HasFlag(row, InstanceStore::FLAG_SOLID); }
+    void SetSolid(bool val) { store->SetFlag(row, InstanceStore::FLAG_SOLID, val); }
     
     bool GetPersistent() const { return persistent; }
     void SetPersistent(bool val) { persistent = val; }
     
-    double GetDepth() const { return depth; }
-    void SetDepth(double val) { depth = val; }
+    double GetDepth() const { return store->depth[row]; }
+    void SetDepth(double val);
 
     // Sprite
-    uint32_t GetSpriteIndex() const { return sprite_index; }
+    uint32_t GetSpriteIndex() const { return store->sprite_index[row]; }
     void SetSpriteIndex(uint32_t val);
     
-    double GetImageIndex() const { return image_index; }
-    void SetImageIndex(double val) { image_index = val; }
+    // Sprite whose mask is used for collisions instead (0 = sprite_index)
+    uint32_t GetMaskIndex() const { return mask_index; }
+    void SetMaskIndex(uint32_t val) { mask_index = val; MarkBBoxDirty(); }
+    uint32_t GetCollisionSpriteIndex() const { return mask_index ? mask_index : GetSpriteIndex(); }
+
+    double GetImageIndex() const { return store->image_index[row]; }
+    void SetImageIndex(double val) { store->image_index[row] = val; }
     
     double GetImageXScale() const { return image_xscale; }
     double GetImageYScale() const { return image_yscale; }
-    void SetImageXScale(double val) { image_xscale = val; }
-    void SetImageYScale(double val) { image_yscale = val; }
+    void SetImageXScale(double val) { image_xscale = val; MarkBBoxDirty(); }
+    void SetImageYScale(double val) { image_yscale = val; MarkBBoxDirty(); }
     
     double GetImageAngle() const { return image_angle; }
-    void SetImageAngle(double val) { image_angle = val; }
+    void SetImageAngle(double val) { image_angle = val; MarkBBoxDirty(); }
     
     double GetImageAlpha() const { return image_alpha; }
     void SetImageAlpha(double val) { image_alpha = val; }
@@ -83,25 +118,36 @@ public:
     Color GetImageBlend() const { return image_blend; }
     void SetImageBlend(Color val) { image_blend = val; }
     
-    double GetImageSpeed() const { return image_speed; }
-    void SetImageSpeed(double val) { image_speed = val; }
+    double GetImageSpeed() const { return store->image_speed[row]; }
+    void SetImageSpeed(double val) { store->image_speed[row] = val; }
 
     // Object reference
-    std::shared_ptr<Object> GetObject() const { return object; }
+    Object* GetObject() const { return object; }
     uint32_t GetObjectIndex() const { return object_index; }
 
-    // BBox
-    const Rect& GetBBox() const { return bbox; }
-    void UpdateBBox();
-
-    // Alarms
-    int GetAlarm(int index) const {
-        if (index >= 0 && index < 12) return alarm[index];
-        return -1;
-    }
-    void SetAlarm(int index, int val) {
-        if (index >= 0 && index < 12) alarm[index] = val;
+    // BBox: the collision sprite's bbox placed at the instance's position,
+    // origin, scale and angle (empty without a sprite). Recomputed on read
+    // after a change.
+    const Rect& GetBBox() const {
+        if (bbox_dirty) UpdateBBox();
+        return bbox;
     }
+    void UpdateBBox() const;
+
+    // Flags the bbox for recomputation and queues the room's collision
+    // index to pick up the change before its next query
+    void MarkBBoxDirty();
+
+    // The instance being collided with, during a collision event
+    InstanceHandle GetOther() const { return other; }
+    void SetOther(InstanceHandle handle) { other = handle; }
+
+    // Alarms. A positive value fires after that many steps and then reads
+    // -1; zero and below never fire. While the instance is active in a room
+    // they count down in the room's AlarmWheel.
+    static constexpr int ALARM_COUNT = 12;
+    int GetAlarm(int index) const;
+    void SetAlarm(int index, int val);
 
     // Events
     void TriggerEvent(EventType type, int subType);
@@ -114,59 +160,112 @@ public:
     void Animate();
     void UpdateAnimation();
 
-    // Update
-    void Update();
-
     // Variables (GML variables)
     Variant GetVariable(const std::string& name);
     void SetVariable(const std::string& name, const Variant& value);
 
     uint32_t GetID() const { return id; }
-    bool IsMarked() const { return marked; }
-    void Mark() { marked = true; }
+    InstanceHandle GetHandle() const { return handle; }
+    bool IsMarked() const { return store->HasFlag(row, InstanceStore::FLAG_MARKED); }
+
+    // Flags the instance for destruction and queues it with the manager,
+    // which destroys it at the end of the step (see InstanceManager::ApplyPending)
+    void Mark();
+
+    // instance_change: the instance becomes one of obj when the manager
+    // applies its queue, keeping its place in step order. With
+    // perform_events the old object's destroy event runs first and the new
+    // one's create event after.
+    void ChangeObject(Object* obj, bool perform_events);
+
+    // Containers this instance belongs to (nullptr if none)
+    Room* GetRoom() const { return room; }
+    Layer* GetLayer() const { return layer; }
+
+    // Intrusive membership lists, for walking an object's or layer's instances
+    Instance* GetNextInObject() const { return object_next; }
+    Instance* GetNextInLayer() const { return layer_next; }
 
 private:
+    friend class InstanceStore;
+    friend class InstanceManager;
+    friend class Object;
+    friend class Layer;
+    friend class Room;
+
+    InstanceStore* store;
+    uint32_t row;
+
     uint32_t id;
-    std::shared_ptr<Object> object;
+    InstanceHandle handle = INVALID_INSTANCE;
+    Object* object;
     uint32_t object_index = 0;
+    void SetObject(Object* obj);  // Moves between the objects' instance lists
+
+    // Back-references kept by the containers for O(1) removal
+    Room* room = nullptr;
+    uint32_t room_index = 0;
+    Layer* layer = nullptr;
+    Instance* layer_prev = nullptr;
+    Instance* layer_next = nullptr;
+    Instance* object_prev = nullptr;
+    Instance* object_next = nullptr;
+    uint32_t manager_index = 0;
+
+    // The room's list of its active instances of this object
+    Instance* room_object_prev = nullptr;
+    Instance* room_object_next = nullptr;
+
+    // Event list membership, owned by the room: one bit per Room::EventList,
+    // the position in the room's step order the lists are sorted by, and
+    // whether the instance waits in the room's subscribe queue
+    uint32_t event_lists = 0;
+    uint64_t room_sequence = 0;
+    bool lists_queued = false;
+
+    // Draw order state, owned by the room: whether the instance is in it,
+    // the depth its entry is sorted under (NaN until placed) and whether a
+    // depth change is queued
+    bool draw_listed = false;
+    bool draw_queued = false;
+    double draw_depth = 0;
+
+    // Collision index state, owned by the room
+    ProxyId collision_proxy = NULL_PROXY;
+    bool collision_queued = false;
+    InstanceHandle other = INVALID_INSTANCE;
 
     // Position
-    double x = 0, y = 0;
-    double xprevious = 0, yprevious = 0;
     double xstart = 0, ystart = 0;
 
     // Motion
-    double hspeed = 0, vspeed = 0;
     double speed = 0, direction = 0;
-    double friction = 0, gravity = 0, gravity_direction = 270;
 
-    // Visibility
-    bool visible = true;
-    bool active = true;
-    bool solid = true;
     bool persistent = false;
-    double depth = 0;
 
     // Sprite
-    uint32_t sprite_index = 0;
-    double image_index = 0;
     double image_xscale = 1.0, image_yscale = 1.0;
     double image_angle = 0;
     double image_alpha = 1.0;
     Color image_blend = 0xFFFFFFFF;
-    double image_speed = 1.0;
     uint32_t mask_index = 0;
 
-    // BBox
-    Rect bbox;
-    bool bbox_dirty = true;
+    // BBox, derived from the fields above
+    mutable Rect bbox;
+    mutable bool bbox_dirty = true;
 
-    // Alarms
-    int alarm[12] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+    // Alarms. While counting, alarm_due holds the room alarm step each one
+    // runs out on; otherwise (NOT_COUNTING) alarm holds its value. Bumping
+    // the token orphans any wheel entry for the alarm.
+    static constexpr uint64_t NOT_COUNTING = UINT64_MAX;
+    void StartAlarms();  // On joining a room while active, or activating in one
+    void StopAlarms();   // On leaving the room or deactivating
+    int alarm[ALARM_COUNT] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+    uint64_t alarm_due[ALARM_COUNT] = {NOT_COUNTING, NOT_COUNTING, NOT_COUNTING, NOT_COUNTING,
+                                       NOT_COUNTING, NOT_COUNTING, NOT_COUNTING, NOT_COUNTING,
+                                       NOT_COUNTING, NOT_COUNTING, NOT_COUNTING, NOT_COUNTING};
+    uint32_t alarm_token[ALARM_COUNT] = {};
 
-    // State
-    bool marked = false;
-    
     // Variables
     std::map<std::string, Variant> variables;
 };
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Instance.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Slab allocator for Instance objects
+ *
+ * Instances are carved out of fixed-size slabs. Freed slots go on an
+ * intrusive free list (the link lives in the dead slot itself), and Create
+ * reconstructs an Instance in place in the most recently freed slot, so
+ * steady create/destroy churn never reaches the general-purpose heap.
+ * Slabs are kept until the pool is destroyed.
+ */
+class InstancePool {
+public:
+    static constexpr size_t SLAB_SIZE = 256;  // Instances per slab
+
+    // unique_ptr deleter that hands the slot back to its pool
+    struct Deleter {
+        InstancePool* pool = nullptr;
+        void operator()(Instance* inst) const { pool->Destroy(inst); }
+    };
+
+    InstancePool() = default;
+    InstancePool(const InstancePool&) = delete;
+    InstancePool& operator=(const InstancePool&) = delete;
+
+    template <typename... Args>
+    Instance* Create(Args&&... args) {
+        void* slot = Acquire();
+        try {
+            return new (slot) Instance(std::forward<Args>(args)...);
+        } catch (...) {
+            Release(slot);
+            throw;
+        }
+    }
+
+    void Destroy(Instance* inst) {
+        inst->~Instance();
+        Release(inst);
+    }
+
+    // Takes over other's slabs, and with them every instance other created
+    // and still holds, leaving it empty. Pools are single-threaded, so an
+    // instance built on another thread comes from a pool of its own and is
+    // adopted once that thread is done.
+    void Adopt(InstancePool& other);
+
+    size_t GetLiveCount() const { return live; }
+    size_t GetCapacity() const { return slabs.size() * SLAB_SIZE; }
+
+private:
+    struct alignas(Instance) Slot {
+        unsigned char bytes[sizeof(Instance)];
+    };
+    struct FreeNode {
+        FreeNode* next;
+    };
+    static_assert(sizeof(Slot) >= sizeof(FreeNode), "slot too small for the free-list link");
+
+    void* Acquire() {
+        if (!free_list) AddSlab();
+        FreeNode* node = free_list;
+        free_list = node->next;
+        live++;
+        return node;
+    }
+
+    void Release(void* slot) {
+        FreeNode* node = static_cast<FreeNode*>(slot);
+        node->next = free_list;
+        free_list = node;
+        live--;
+    }
+
+    void AddSlab();
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    FreeNode* free_list = nullptr;
+    size_t live = 0;
+};
+
+} // namespace GM
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GM {
+
+class Instance;
+
+/**
+ * Structure-of-arrays storage for the builtin instance fields
+ *
+ * The fields touched every step (position, motion, animation, depth and the
+ * state flags) live in parallel columns, one row per instance, so the
+ * builtin motion and animation passes stream through contiguous memory
+ * instead of visiting each Instance object. Rows are kept dense: releasing
+ * a row moves the last row into the hole and repoints its owner, so row
+ * numbers are not stable and should only be held by the owning Instance.
+ *
+ * Each Room owns a store for the instances placed in it. Instances that
+ * are not in any room live in the shared Detached() store.
+ *
+ * ApplyMotion integrates every row in SIMD lanes (see GetSimdLevel()).
+ * The unit gravity vector of each row is cached and only recomputed when
+ * its gravity_direction changes, so no trig runs in the step loop.
+ */
+class InstanceStore {
+public:
+    // Bits in the flags column
+    static constexpr uint8_t FLAG_ACTIVE = 1 << 0;
+    static constexpr uint8_t FLAG_VISIBLE = 1 << 1;
+    static constexpr uint8_t FLAG_SOLID = 1 << 2;
+    static constexpr uint8_t FLAG_MARKED = 1 << 3;
+
+    InstanceStore() = default;
+    InstanceStore(const InstanceStore&) = delete;
+    InstanceStore& operator=(const InstanceStore&) = delete;
+
+    // Appends a row with builtin defaults and returns its index
+    uint32_t Allocate(Instance* owner);
+
+    // Frees a row; the last row is moved into its place
+    void Release(uint32_t row);
+
+    // Copies every column of src_row in src into dst_row of this store
+    void CopyRow(uint32_t dst_row, const InstanceStore& src, uint32_t src_row);
+
+    void Reserve(size_t count);
+    void ShrinkToFit();  // Gives back the columns' spare capacity
+    size_t Size() const { return owners.size(); }
+    Instance* GetOwner(uint32_t row) const { return owners[row]; }
+
+    bool HasFlag(uint32_t row, uint8_t flag) const { return (flags[row] & flag) != 0; }
+    void SetFlag(uint32_t row, uint8_t flag, bool val) {
+        if (val) flags[row] |= flag;
+        else flags[row] &= (uint8_t)~flag;
+    }
+
+    // Keeps the cached unit gravity vector in sync with the direction
+    void SetGravityDirection(uint32_t row, double direction);
+
+    // Builtin per-step passes over every active row, or rows [begin, end).
+    // Rows are independent, so disjoint ranges can run on different threads.
+    void ApplyMotion() { ApplyMotion(0, Size()); }
+    void Animate() { Animate(0, Size()); }
+    void ApplyMotion(size_t begin, size_t end);
+    void Animate(size_t begin, size_t end);
+
+    // Adds image_speed to image_index, wrapping it into [0, frames)
+    void AdvanceFrame(size_t row, uint32_t frames);
+
+    // Store for instances that have not been placed in a room
+    static InstanceStore& Detached();
+
+    // Columns
+    std::vector<double> x, y;
+    std::vector<double> xprevious, yprevious;
+    std::vector<double> hspeed, vspeed;
+    std::vector<double> gravity, gravity_direction;
+    std::vector<double> gravity_dx, gravity_dy;
+    std::vector<double> friction;
+    std::vector<double> image_index, image_speed;
+    std::vector<double> depth;
+    std::vector<uint32_t> sprite_index;
+    std::vector<uint8_t> flags;
+
+private:
+    std::vector<Instance*> owners;
+};
+
+} // namespace GM
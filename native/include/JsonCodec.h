@@ -0,0 +1,39 @@
+#pragma once
+
+#include "VM_Value.h"
+#include <cstddef>
+#include <string>
+
+namespace GM {
+
+class VirtualMachine;
+
+/**
+ * GML JSON codec (json_parse / json_stringify)
+ *
+ * Parsing is a single pass: an iterative SAX-style reader feeds a builder
+ * that creates structs and arrays directly, with no intermediate DOM.
+ * Escape-free strings are copied straight from the input. Stringify
+ * appends to a caller-owned string, so repeated autosaves can reuse one
+ * growing buffer.
+ */
+namespace Json {
+
+// Objects become structs, arrays become arrays and null becomes undefined.
+// On failure out is left undefined and error (if given) describes the problem.
+bool Parse(const char* text, size_t length, Value& out, std::string* error = nullptr);
+
+inline bool Parse(const std::string& text, Value& out, std::string* error = nullptr) {
+    return Parse(text.data(), text.size(), out, error);
+}
+
+// Appends val to out; pretty output indents nested containers by two spaces.
+// Returns false if nesting is too deep (e.g. a struct that contains itself).
+bool Stringify(const Value& val, std::string& out, bool pretty = false);
+
+} // namespace Json
+
+// Registers json_parse and json_stringify
+void RegisterJsonBuiltins(VirtualMachine& vm);
+
+} // namespace GM
@@ -1,14 +1,15 @@
 #pragma once
 
 #include "GMLTypes.h"
+#include "Instance.h"
 #include <memory>
 #include <vector>
 #include <string>
 
 namespace GM {
 
-class Instance;
 class Sprite;
+class Tilemap;
 
 // Layer types
 enum class LayerType {
@@ -96,9 +97,18 @@ public:
     void SetAlpha(double a) { alpha = a; }
 
     // Content
-    void AddInstance(std::shared_ptr<Instance> inst);
-    void RemoveInstance(std::shared_ptr<Instance> inst);
-    const std::vector<std::shared_ptr<Instance>>& GetInstances() const { return instances; }
+    // An instance is on at most one layer; adding moves it from its old one
+    void AddInstance(InstanceHandle inst);
+    void RemoveInstance(InstanceHandle inst);
+    Instance* GetFirstInstance() const { return first_instance; }
+    size_t GetInstanceCount() const { return instance_count; }
+
+    // O(1) removal through the instance's back-reference
+    void Unlink(Instance* inst);
+
+    // Tiles layers hold a tilemap, null elsewhere
+    const std::shared_ptr<Tilemap>& GetTilemap() const { return tilemap; }
+    void SetTilemap(std::shared_ptr<Tilemap> map) { tilemap = std::move(map); }
 
     // Parallax
     double GetParallaxX() const { return parallax_x; }
@@ -114,7 +124,10 @@ private:
     uint32_t id;
     std::string name;
     LayerType type;
-    std::vector<std::shared_ptr<Instance>> instances;
+    Instance* first_instance = nullptr;
+    Instance* last_instance = nullptr;
+    size_t instance_count = 0;
+    std::shared_ptr<Tilemap> tilemap;
 
     double depth = 0;
     bool visible = true;
@@ -7,13 +7,21 @@
 #include "Sprite.h"
 #include "Audio.h"
 #include "Layer.h"
+#include "DataStructures.h"
+#include "Buffer.h"
+#include "Random.h"
 #include "IPlatform.h"
+#include "HandleTable.h"
+#include "InstancePool.h"
 #include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 namespace GM {
 
+class VirtualMachine;
+
 // Manages all game objects
 class ObjectManager {
 public:
@@ -25,6 +33,10 @@ public:
     std::shared_ptr<Object> GetObject(uint32_t id);
     const std::vector<std::shared_ptr<Object>>& GetObjects() const { return objects; }
 
+    // Resolves every object's event dispatch table (see Object::GetHandler);
+    // call once all objects, parents and handlers are loaded
+    void BuildDispatchTables();
+
     void Clear();
 
 private:
@@ -32,30 +44,98 @@ private:
     std::map<uint32_t, std::shared_ptr<Object>> object_map;
 };
 
-// Manages all instances in current room
+/**
+ * Owns every instance
+ *
+ * Instances are allocated from an InstancePool, live in a generational
+ * slot table and are referred to by InstanceHandle everywhere else, so
+ * rooms, objects, layers and the VM share them without reference counting. Get() is an O(1) slot lookup
+ * that returns nullptr once an instance has been destroyed, even if its
+ * slot has since been reused.
+ */
 class InstanceManager {
 public:
+    // 24 index bits (16M live instances) and 29 generation bits, so a slot
+    // can be recycled half a billion times before a stale handle aliases
+    using InstanceTable = HandleTable<Instance, 24, 29, InstancePool::Deleter>;
+
     InstanceManager();
     ~InstanceManager();
 
-    void AddInstance(std::shared_ptr<Instance> inst);
-    void RemoveInstance(uint32_t id);
-    std::shared_ptr<Instance> GetInstance(uint32_t id);
-    const std::vector<std::shared_ptr<Instance>>& GetInstances() const { return instances; }
-    std::vector<std::shared_ptr<Instance>>& GetInstances() { return instances; }
+    // Creates an instance outside any room and registers it with its object
+    InstanceHandle Create(double x, double y, uint32_t id, Object* object);
+
+    // Instances built off the main thread (see RoomBuilder). Reserve hands
+    // out a handle that resolves to nullptr until Adopt registers the
+    // instance built for it; Unreserve gives back one that went unused.
+    // Adopt takes over the pool the instances came from, and each must
+    // already carry its reserved handle.
+    InstanceHandle Reserve() { return table.Reserve(); }
+    void Unreserve(InstanceHandle handle) { table.Unreserve(handle); }
+    void Adopt(InstancePool& built_in, const std::vector<Instance*>& built);
+
+    // Frees the instance immediately; prefer Instance::Mark during a step
+    bool Destroy(InstanceHandle handle);
+
+    Instance* Get(InstanceHandle handle) const { return table.Get(handle); }
+    bool Exists(InstanceHandle handle) const { return table.Exists(handle); }
+
+    // Lookup by GML instance id, O(1)
+    InstanceHandle FindByID(uint32_t id) const;
+
+    // Every live instance, in no particular order
+    const std::vector<InstanceHandle>& GetInstances() const { return instances; }
+    size_t Count() const { return table.Count(); }
+    const InstancePool& GetPool() const { return pool; }
+
+    // Structural changes made while events run go through one queue and
+    // are applied together, in the order they were made, at the end of the
+    // step (Room::Update), so no list a loop is walking changes under it and
+    // nothing has to scan for marked instances. Instance::Mark queues a
+    // destroy, Room::QueueInstance a join and Instance::ChangeObject an
+    // object change; entries for instances destroyed meanwhile are dropped.
+    // A marked instance that is inactive in its room waits until it is
+    // activated again.
+    void QueueDestroy(InstanceHandle handle);
+    void QueueJoin(InstanceHandle handle, Room* room);
+    void QueueChangeObject(InstanceHandle handle, Object* object, bool perform_events);
+    void ApplyPending();
+    size_t GetPendingCount() const { return pending.size() - apply_index; }
+
+    // Forgets the joins queued for room, destroying the instances if asked
+    // (Room::Clear) or leaving them outside any room (a room going away)
+    void DropJoins(Room* room, bool destroy);
 
     void Update();
     void Draw();
     void Clear();
 
     void TriggerEvent(EventType type, int subType);
-    void RemoveMarked();
 
 private:
-    std::vector<std::shared_ptr<Instance>> instances;
-    std::map<uint32_t, std::shared_ptr<Instance>> instance_map;
+    void Register(Instance* inst);  // Lists a new instance and indexes its id
+
+    InstancePool pool;  // Declared first so it outlives the table
+    InstanceTable table;
+    std::vector<InstanceHandle> instances;
+    std::unordered_map<uint32_t, InstanceHandle> instance_map;
+    std::vector<std::unordered_map<uint32_t, InstanceHandle>::node_type> spare_id_nodes;  // Recycled map nodes
+
+    struct PendingChange {
+        enum class Kind : uint8_t { Join, Destroy, ChangeObject };
+        Kind kind;
+        bool perform_events;
+        InstanceHandle handle;
+        Room* room;      // Join
+        Object* object;  // ChangeObject
+    };
+    std::vector<PendingChange> pending;
+    size_t apply_index = 0;  // Entries before this one have been applied
 };
 
+// Registers instance_exists, instance_destroy and instance_count
+void RegisterInstanceBuiltins(VirtualMachine& vm, InstanceManager& manager);
+
 // Manages all rooms
 class RoomManager {
 public:
@@ -78,6 +158,10 @@ private:
     std::shared_ptr<Room> current_room;
 };
 
+// Registers instance_number and instance_find, which take an object index
+// (or `all`) and look in the current room, descendants included
+void RegisterObjectBuiltins(VirtualMachine& vm, ObjectManager& objects, RoomManager& rooms);
+
 // Manages sprites
 class SpriteManager {
 public:
@@ -105,6 +189,9 @@ public:
     RoomManager& GetRoomManager() { return room_manager; }
     SpriteManager& GetSpriteManager() { return sprite_manager; }
     AudioManager& GetAudioManager() { return audio_manager; }
+    DataStructureManager& GetDataStructureManager() { return data_structure_manager; }
+    BufferManager& GetBufferManager() { return buffer_manager; }
+    RandomGenerator& GetRandomGenerator() { return random_generator; }
     
     // Renderer access for drawing
     IRenderer* GetRenderer() { return renderer; }
@@ -136,6 +223,9 @@ private:
     RoomManager room_manager;
     SpriteManager sprite_manager;
     AudioManager audio_manager;
+    DataStructureManager data_structure_manager;
+    BufferManager buffer_manager;
+    RandomGenerator random_generator;
     IRenderer* renderer = nullptr;
 
     int score = 0;
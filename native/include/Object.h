@@ -18,8 +18,13 @@ public:
     const std::string& GetName() const { return name; }
 
     // Parent object
-    std::shared_ptr<Object> GetParent() const { return parent; }
-    void SetParent(std::shared_ptr<Object> p) { parent = p; }
+    const std::shared_ptr<Object>& GetParent() const { return parent; }
+    void SetParent(std::shared_ptr<Object> p);
+
+    // This object and every object inheriting from it, parents before
+    // children: the objects `with (obj)` and friends visit. Cached, and
+    // recomputed on first use after any parent change.
+    const std::vector<Object*>& GetDescendants();
 
     // Sprite
     uint32_t GetSpriteIndex() const { return sprite_index; }
@@ -44,27 +49,79 @@ public:
     bool GetPhysicsEnabled() const { return physics_enabled; }
     void SetPhysicsEnabled(bool val) { physics_enabled = val; }
 
-    // Instances
-    void AddInstance(std::shared_ptr<Instance> inst);
-    void RemoveInstance(std::shared_ptr<Instance> inst);
-    const std::vector<std::shared_ptr<Instance>>& GetInstances() const { return instances; }
-
-    // Events
+    // Camera activation (see Room::SetCameraActivation) never deactivates
+    // instances of an object with this set, e.g. controllers
+    bool GetKeepActive() const { return keep_active; }
+    void SetKeepActive(bool val) { keep_active = val; }
+
+    // Instances of exactly this object, linked through the instances
+    // themselves (see Instance::GetNextInObject). Maintained by InstanceManager.
+    void AddInstance(Instance* inst);
+    void RemoveInstance(Instance* inst);
+    Instance* GetFirstInstance() const { return first_instance; }
+    size_t GetInstanceCount() const { return instance_count; }
+
+    // Events. Handlers are inherited along the parent chain, an object's own
+    // handler replacing its parent's. Triggering goes through a dense
+    // [type][subType] table with the inheritance already resolved; tables
+    // are rebuilt on first use after any handler or parent changes.
+    //
+    // A self-only handler reads and writes nothing but its own instance's
+    // fields and variables, anything else going through RunOrDefer (see
+    // CommandBuffer.h); the engine may run such step events in parallel.
     using EventCallback = std::function<void(Instance*)>;
-    void SetEventCallback(EventType type, int subType, EventCallback callback);
-    void TriggerEvent(Instance* inst, EventType type, int subType);
+    void SetEventCallback(EventType type, int subType, EventCallback callback, bool self_only = false);
+    void TriggerEvent(Instance* inst, EventType type, int subType) {
+        if (const EventCallback* handler = GetHandler(type, subType)) (*handler)(inst);
+    }
+
+    // The handler that runs for the event, own or inherited, or null
+    const EventCallback* GetHandler(EventType type, int subType) {
+        const Handler* handler = FindHandler(type, subType);
+        return handler ? &handler->callback : nullptr;
+    }
+
+    // Whether the event's handler was registered as self-only (false when
+    // there is none)
+    bool IsSelfOnly(EventType type, int subType) {
+        const Handler* handler = FindHandler(type, subType);
+        return handler && handler->self_only;
+    }
+
+    // Whether any handler of this type (any subType) would run
+    bool HasEvent(EventType type) {
+        if (dispatch_generation != event_generation) BuildDispatchTable();
+        return (handled_events >> (uint32_t)type) & 1;
+    }
+
+    // Object indices this object has collision events for, own or inherited
+    const std::vector<int>& GetCollisionTargets() {
+        if (dispatch_generation != event_generation) BuildDispatchTable();
+        return collision_targets;
+    }
+
+    // Resolves the dispatch table now rather than at the next event
+    void BuildDispatchTable();
+
+    // Changes whenever any object's handlers or parent change
+    static uint32_t GetEventGeneration() { return event_generation; }
 
     // Variables (default values for new instances)
     Variant GetVariable(const std::string& name) const;
     void SetVariable(const std::string& name, const Variant& value);
 
-    // Create instance
-    std::shared_ptr<Instance> CreateInstance(double x, double y, uint32_t id);
+    // Create instance (owned by the global InstanceManager)
+    InstanceHandle CreateInstance(double x, double y, uint32_t id);
 
 private:
     uint32_t id;
     std::string name;
     std::shared_ptr<Object> parent;
+    std::vector<Object*> children;  // Kept alive by their references to us
+
+    std::vector<Object*> descendants;
+    uint32_t descendants_generation = 0;
+    static uint32_t hierarchy_generation;  // Bumped by every parent change and destruction
 
     uint32_t sprite_index = 0;
     uint32_t mask_index = 0;
@@ -72,11 +129,34 @@ private:
     bool solid = true;
     double depth = 0;
     bool physics_enabled = false;
+    bool keep_active = false;
 
-    std::vector<std::shared_ptr<Instance>> instances;
+    Instance* first_instance = nullptr;
+    Instance* last_instance = nullptr;
+    size_t instance_count = 0;
     
-    // Event callbacks: [EventType][subType] = callback
-    std::map<int, std::map<int, EventCallback>> event_callbacks;
+    // Event callbacks: [EventType][subType] = handler
+    struct Handler {
+        EventCallback callback;
+        bool self_only = false;
+    };
+    std::map<int, std::map<int, Handler>> event_callbacks;
+
+    const Handler* FindHandler(EventType type, int subType) {
+        if (!HasEvent(type)) return nullptr;
+        const auto& row = dispatch[(int)type];
+        return (uint32_t)subType < row.size() ? row[subType] : nullptr;
+    }
+
+    // Resolved handlers (pointing into this or an ancestor's callbacks), one
+    // bit per EventType with any handler, and inherited collision targets
+    std::vector<const Handler*> dispatch[EVENT_TYPE_COUNT];
+    uint32_t handled_events = 0;
+    std::vector<int> collision_targets;
+    uint32_t dispatch_generation = 0;
+
+    // Bumped by every handler or parent change, invalidating all tables
+    static uint32_t event_generation;
     
     // Default variables for instances
     std::map<std::string, Variant> variables;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GM {
+
+class Buffer;
+class VirtualMachine;
+
+// Complete generator state; copying it forks the random sequence bit-exactly
+struct RandomState {
+    uint64_t seed = 0;
+    uint64_t s[4] = {};
+};
+
+/**
+ * Seeded xoshiro256** generator
+ *
+ * Each context that needs reproducible randomness (game code, particles,
+ * replay-invisible effects) owns its own generator, so drawing numbers in
+ * one never perturbs another. The default seed is 0, matching the runner's
+ * InitRandom(0): a game that never calls randomize() is deterministic.
+ * The batch Fill calls keep the state in registers for the whole run and
+ * produce exactly the numbers the same count of single draws would.
+ */
+class RandomGenerator {
+public:
+    explicit RandomGenerator(uint64_t seed = 0) { Seed(seed); }
+
+    // Expands the seed with splitmix64 so nearby seeds give unrelated streams
+    void Seed(uint64_t seed);
+    uint64_t GetSeed() const { return state.seed; }
+
+    uint64_t NextU64() {
+        uint64_t* s = state.s;
+        uint64_t result = RotateLeft(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = RotateLeft(s[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, 1) with 53 bits of precision
+    double NextDouble() { return (double)(NextU64() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Uniform real in [lo, hi)
+    double Range(double lo, double hi) { return lo + (hi - lo) * NextDouble(); }
+
+    // Uniform integer in [lo, hi], bounds in either order, without modulo bias
+    int64_t IRange(int64_t lo, int64_t hi);
+
+    // Batched draws for particle bursts and procedural generation
+    void Fill(double* out, size_t count, double lo, double hi);
+    void Fill(float* out, size_t count, float lo, float hi);
+    void FillInt(int32_t* out, size_t count, int64_t lo, int64_t hi);
+
+    const RandomState& GetState() const { return state; }
+    void SetState(const RandomState& new_state) { state = new_state; }
+
+    // Snapshot support: 40 bytes (seed + state words) at the buffer's cursor.
+    // Load leaves the generator untouched if the buffer runs out.
+    bool Save(Buffer& buffer) const;
+    bool Load(Buffer& buffer);
+
+private:
+    static uint64_t RotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    // Bitmask rejection: uniform in [0, span] for span > 0
+    uint64_t Bounded(uint64_t span, uint64_t mask) {
+        uint64_t x;
+        do {
+            x = NextU64() & mask;
+        } while (x > span);
+        return x;
+    }
+    static uint64_t MaskFor(uint64_t span);
+
+    RandomState state;
+};
+
+// Registers random, random_range, irandom, irandom_range, choose,
+// random_set_seed, random_get_seed and randomize against rng
+void RegisterRandomBuiltins(VirtualMachine& vm, RandomGenerator& rng);
+
+} // namespace GM
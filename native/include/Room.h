@@ -2,11 +2,16 @@
 
 #include "GMLTypes.h"
 #include "Instance.h"
+#include "AlarmWheel.h"
+#include "CommandBuffer.h"
 #include "Layer.h"
+#include "AABBTree.h"
+#include "SpatialGrid.h"
 #include <memory>
 #include <vector>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 namespace GM {
 
@@ -38,29 +43,199 @@ public:
     Color GetBackgroundColor() const { return background_color; }
     void SetBackgroundColor(Color col) { background_color = col; }
 
-    // Instances
-    void AddInstance(std::shared_ptr<Instance> inst);
-    void RemoveInstance(std::shared_ptr<Instance> inst);
-    const std::vector<std::shared_ptr<Instance>>& GetInstances() const { return instances; }
-    std::vector<std::shared_ptr<Instance>>& GetInstances() { return instances; }
+    // Active instances, in the order they were added or last activated
+    // (step order is kept by the event lists). Removal is O(1): it leaves an
+    // INVALID_INSTANCE hole (which resolves to nullptr) that Compact closes
+    // later, so loops must skip unresolved handles.
+    void AddInstance(InstanceHandle inst);
+    void RemoveInstance(InstanceHandle inst);
 
-    // Find instance by ID
-    std::shared_ptr<Instance> FindInstance(uint32_t id);
-    std::vector<std::shared_ptr<Instance>> FindInstancesByObject(std::shared_ptr<Object> obj);
+    // Adds inst when the instance manager next applies its queue (see
+    // InstanceManager::ApplyPending) rather than now
+    void QueueInstance(InstanceHandle inst);
+    const std::vector<InstanceHandle>& GetInstances() const { return instances; }
+    size_t GetInstanceCount() const { return instances.size() - holes; }
+
+    // Drops inst from the step list without moving its store row
+    void Unlink(Instance* inst);
+
+    // Deactivation. An inactive instance stays in the room but leaves the
+    // instance list, the event lists, the draw order and the broadphase, and
+    // its fields move to a cold store, so nothing that runs per step visits
+    // it (nor destroys it: marked inactive instances go once reactivated).
+    // Cold instances keep their bboxes in a grid of their own, so
+    // activating a region is a spatial query just like deactivating one.
+    //
+    // The region functions follow instance_deactivate_region and
+    // instance_activate_region: inside selects the instances whose bbox
+    // touches area, otherwise those lying entirely outside it.
+    void DeactivateRegion(const Rect& area, bool inside, InstanceHandle notme = INVALID_INSTANCE);
+    void ActivateRegion(const Rect& area, bool inside);
+    size_t GetInactiveCount() const { return cold_store.Size(); }
+
+    // Moves inst into or out of the cold store to match its active flag
+    // (Instance::SetActive calls this)
+    void ApplyActive(Instance* inst);
+
+    // Camera activation: before each step, inactive instances within
+    // activate_margin of the active camera's view are activated and active
+    // ones further than deactivate_margin from it deactivated. The band in
+    // between is hysteresis, so instances near the edge don't flip back and
+    // forth as the camera moves. Objects can opt out with SetKeepActive.
+    void SetCameraActivation(bool enabled, double activate_margin = 128, double deactivate_margin = 512);
+    bool GetCameraActivation() const { return camera_activation; }
+    void UpdateCameraActivation();
+
+    // Per-event subscriber lists: the instances whose object (or an
+    // ancestor) handles the event, in step order, so the engine's event
+    // loops never visit the rest. Draw also takes instances with a sprite to
+    // draw by default. Like the step list, removal leaves a hole that
+    // Compact closes. New instances are appended; any other joining
+    // instance (an activated one, say) is queued and merged in by the next
+    // GetSubscribers, so entries never shift under a running loop. The
+    // lists are rebuilt if any object's handlers change.
+    enum class EventList { BeginStep, Step, EndStep, Collision, Draw, Count };
+    struct Subscriber {
+        uint64_t sequence;  // Room step order, for sorted insertion
+        InstanceHandle handle;
+    };
+    const std::vector<Subscriber>& GetSubscribers(EventList list);
+
+    // Re-evaluates which lists inst belongs in
+    void RefreshEventLists(Instance* inst);
+
+    // Alarms of the room's active instances. RunAlarms advances one step
+    // and fires the alarms that run out on it, in step order and then alarm
+    // order, exactly as counting every instance's alarms down would; an
+    // alarm set for an instance the pass has yet to reach still counts down
+    // this step.
+    void RunAlarms();
+    void ScheduleAlarm(Instance* inst, uint32_t index, int steps);
+
+    // The step an alarm's countdown has reached: one behind for alarms the
+    // running pass has yet to reach
+    uint64_t GetAlarmStep(const Instance* inst, uint32_t index) const;
+
+    // Draw order: the Draw list sorted by depth (lower first), ties in
+    // step order. Kept between frames; joining instances and depth changes
+    // are queued and merged in before the next Draw, and leaving ones are
+    // found by binary search. Step order is never touched.
+    void QueueDepthChange(Instance* inst);
+
+    // Builtin fields of the placed instances, in SoA columns
+    InstanceStore& GetInstanceStore() { return store; }
+
+    // Collision index over the instances' bboxes. Moves and sprite changes
+    // queue the instance through Instance::MarkBBoxDirty; SyncCollision
+    // folds the queue into the broadphase and runs before every query.
+    BroadphaseType GetBroadphase() const { return broadphase; }
+    void SetBroadphase(BroadphaseType type);
+    void SyncCollision();
+
+    // Region, pair and ray queries against whichever broadphase is active
+    // (see SpatialGrid for the callback contracts)
+    template <typename Fn>
+    void QueryCollision(const Rect& area, Fn&& fn) {
+        SyncCollision();
+        if (broadphase == BroadphaseType::Tree) tree.Query(area, fn);
+        else grid.Query(area, fn);
+    }
+    template <typename Fn>
+    void QueryCollisionPairs(Fn&& fn) {
+        SyncCollision();
+        if (broadphase == BroadphaseType::Tree) tree.QueryPairs(fn);
+        else grid.QueryPairs(fn);
+    }
+    template <typename Fn>
+    void RayCastCollision(double x1, double y1, double x2, double y2, Fn&& fn) {
+        SyncCollision();
+        if (broadphase == BroadphaseType::Tree) tree.RayCast(x1, y1, x2, y2, fn);
+        else grid.RayCast(x1, y1, x2, y2, fn);
+    }
+
+    void QueueCollisionUpdate(InstanceHandle handle) {
+        RunOrDefer([this, handle] { collision_queue.push_back(handle); });
+    }
+
+    // Queues every instance the builtin motion pass moved
+    void MarkMoved();
+
+    // Find instance by ID (O(1) through InstanceManager's id index)
+    InstanceHandle FindInstance(uint32_t id);
+
+    // Instances by object, as GML's with, instance_number, instance_find and
+    // instance_exists see them: the room's active instances of obj or of any
+    // object inheriting from it, or all of them when obj is null (GML
+    // `all`). The room keeps a list per object and objects cache their
+    // descendants, so these cost O(matches), CountInstances O(descendant
+    // objects), and don't allocate.
+    //
+    // With snapshots the matches before calling fn(inst) on each, so fn may
+    // create, destroy, move or (de)activate instances freely: instances
+    // that leave the active set before their turn are skipped and new ones
+    // are not visited.
+    template <typename Fn>
+    void With(Object* obj, Fn&& fn) {
+        size_t depth = with_depth++;
+        if (with_buffers.size() <= depth) with_buffers.emplace_back();
+        CollectInstances(obj, with_buffers[depth]);
+        for (size_t i = 0; i < with_buffers[depth].size(); i++) {
+            if (Instance* inst = ResolveActive(with_buffers[depth][i])) fn(inst);
+        }
+        with_buffers[depth].clear();
+        with_depth--;
+    }
+    size_t CountInstances(Object* obj);
+    Instance* FindInstanceOf(Object* obj, size_t n);  // The nth match in With order, or null
+    bool HasInstanceOf(Object* obj) { return FindInstanceOf(obj, 0) != nullptr; }
+
+    // Handles of every match, for callers that want to keep them
+    std::vector<InstanceHandle> FindInstancesByObject(Object* obj);
+
+    // Asset data: the instances the room places when it is built. A room
+    // is built once, the first time it is entered, or ahead of that on a
+    // background thread (see GameEngine::PrefetchRoom and RoomBuilder), so
+    // rooms the game has not reached hold no instances.
+    struct Placement {
+        uint32_t id;
+        uint32_t object_id;
+        double x, y;
+    };
+    void AddPlacement(const Placement& placement) { placements.push_back(placement); }
+    const std::vector<Placement>& GetPlacements() const { return placements; }
+    bool IsBuilt() const { return built; }
 
     // Initialization
     void Init();
+
+    // Leaving a persistent room freezes it rather than ending it: its
+    // instances keep their store rows, lists and indexes exactly as they
+    // are and no destroy or create events run, either way. Alarms stop
+    // counting, as the room's alarm clock only moves while it runs. Freezing
+    // settles whatever the room still had queued and gives back spare
+    // capacity, so the frozen room holds no more than its state, and Thaw
+    // is O(1).
+    void Freeze();
+    void Thaw() { frozen = false; }
+    bool IsFrozen() const { return frozen; }
+
+    // Destroys every instance in the room. The room counts as unbuilt
+    // again, so entering it next places its instances anew.
     void Clear();
 
     // Events
     void RoomStartEvent();
     void RoomEndEvent();
-    void Update();
     void Draw();
 
+    // End of step: applies the instance manager's queue, then closes the
+    // holes in the instance and event lists once they make up a good share
+    // of them (every loop skips holes, so waiting costs nothing but memory)
+    void Update();
+
     // Instance management
-    void RemoveMarked();
-    void UpdateBBoxes();
+    void Compact();
+    void UpdateBBoxes();  // Recomputes every bbox and collision proxy
 
     // Views
     bool GetViewsEnabled() const { return views_enabled; }
@@ -84,6 +259,9 @@ public:
     void SetInitialized(bool val) { initialized = val; }
 
 private:
+    friend class InstanceManager;
+    friend class RoomBuilder;
+
     uint32_t id;
     std::string name;
     uint32_t width = 1024;
@@ -100,11 +278,103 @@ private:
     std::map<uint32_t, std::shared_ptr<Camera>> camera_map;
     std::shared_ptr<Camera> active_camera;
 
-    std::vector<std::shared_ptr<Instance>> instances;
-    std::vector<std::shared_ptr<Instance>> instances_to_add;
+    InstanceStore store;
+    std::vector<InstanceHandle> instances;
+    size_t holes = 0;
+    uint64_t next_sequence = 0;
+    size_t queued_joins = 0;  // Entries for this room in the manager's queue
+    static constexpr size_t COMPACT_FRACTION = 4;  // Update compacts at one hole in this many entries
+
+    struct SubscriberList {
+        std::vector<Subscriber> entries;
+        size_t holes = 0;
+    };
+    SubscriberList subscribers[(int)EventList::Count];
+    uint32_t subscribers_generation = 0;
+
+    std::vector<Placement> placements;
+    bool built = false;
+
+    // AddInstance for an instance built in this room's store, under a
+    // handle that may not resolve yet (see RoomBuilder)
+    void Place(Instance* inst, InstanceHandle handle);
+    void PlaceDrawOrder();  // Sorts the queued draw entries of an empty draw order in one go
+
+    bool IsCold(const Instance* inst) const { return inst->store == &cold_store; }
+    void JoinHotSets(Instance* inst);
+    void LeaveHotSets(Instance* inst);
+
+    // Applies a queued object change, keeping the instance's place in step
+    // order (see Instance::ChangeObject)
+    void ChangeObject(Instance* inst, Object* obj);
+
+    // Active instances per object, linked through the instances
+    struct ObjectInstances {
+        Instance* first = nullptr;
+        Instance* last = nullptr;
+        size_t count = 0;
+    };
+    std::unordered_map<const Object*, ObjectInstances> object_instances;
+    std::vector<std::vector<InstanceHandle>> with_buffers;  // One per nesting level of With
+    size_t with_depth = 0;
+
+    void LinkObjectList(Instance* inst);
+    void UnlinkObjectList(Instance* inst);
+    void CollectInstances(Object* obj, std::vector<InstanceHandle>& out);
+    Instance* ResolveActive(InstanceHandle handle);  // Null unless still active here
+
+    // Region selection for the (de)activation functions, into region_hits
+    void SelectActive(const Rect& area, bool inside);
+    void SelectInactive(const Rect& area, bool inside);
+
+    InstanceStore cold_store;
+    SpatialGrid cold_grid;
+    std::vector<InstanceHandle> region_hits;
+    bool camera_activation = false;
+    double activate_margin = 128;
+    double deactivate_margin = 512;
+
+    static bool WantsEventList(Instance* inst, EventList list);
+    void Unsubscribe(Instance* inst, EventList list);
+    void RebuildEventLists();
+    void MergeSubscribeQueue();
+    std::vector<InstanceHandle> subscribe_queue;
+    std::vector<Subscriber> subscribe_new[(int)EventList::Count];  // Scratch for MergeSubscribeQueue
+    std::vector<Subscriber> subscribe_merged;
+
+    struct DrawEntry {
+        double depth;
+        uint64_t sequence;
+        InstanceHandle handle;
+    };
+    std::vector<DrawEntry> draw_order;  // Holes have handle INVALID_INSTANCE
+    size_t draw_holes = 0;
+    std::vector<InstanceHandle> draw_queue;
+    std::vector<DrawEntry> draw_moved;   // Scratch for SortDrawOrder, kept to avoid allocating
+    std::vector<DrawEntry> draw_merged;
+    std::vector<Layer*> draw_tiles;      // Scratch for Draw: visible tile layers by depth
+
+    void AddToDrawOrder(Instance* inst);
+    void RemoveFromDrawOrder(Instance* inst);
+    void SortDrawOrder();
+
+    AlarmWheel alarms;
+    std::vector<AlarmWheel::Entry> due_alarms;  // Min-heap by firing order during RunAlarms
+    bool alarms_running = false;
+    AlarmWheel::Entry alarm_cursor = {};  // The alarm RunAlarms is firing
+
+    ProxyId InsertProxy(Instance* inst);
+    void UpdateProxy(Instance* inst);
+    void RemoveProxy(Instance* inst);
+
+    BroadphaseType broadphase = BroadphaseType::Grid;
+    SpatialGrid grid;
+    AABBTree tree;
+    std::vector<InstanceHandle> collision_queue;
 
     bool views_enabled = true;
     bool initialized = false;
+    bool frozen = false;
 };
 
 } // namespace GM
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "InstancePool.h"
+#include "Room.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Builds a room's instances from its placements
+ *
+ * Run does everything that only concerns the room being built: it creates
+ * the instances straight in the room's store, from a pool of its own, and
+ * fills the room's instance and event lists, per-object lists, broadphase
+ * and draw order. None of that is shared, so Run can go on a background
+ * thread while another room plays. Finish then hands the instances to the
+ * instance manager on the main thread, which fills the handles reserved up
+ * front, indexes the ids and links the instances into their objects'
+ * lists; it runs no events.
+ *
+ * Only instances are prefetched: textures and sounds are already resident
+ * once AssetLoader has run, so there is nothing to warm for them.
+ *
+ * While a build is under way nothing else may touch the room, and no
+ * objects, sprites or event handlers may be added or changed.
+ */
+class RoomBuilder {
+public:
+    // Reserves a handle per placement. room must not have been built.
+    explicit RoomBuilder(std::shared_ptr<Room> room);
+    ~RoomBuilder();  // Finishes a build that was not
+
+    RoomBuilder(const RoomBuilder&) = delete;
+    RoomBuilder& operator=(const RoomBuilder&) = delete;
+
+    // Starts Run on a background thread
+    void Start();
+
+    // Whether Run has finished, so Finish will not wait
+    bool IsReady() const { return ready; }
+
+    // Waits for Run (or runs it here if it was never started) and commits
+    void Finish();
+
+    const std::shared_ptr<Room>& GetRoom() const { return room; }
+
+private:
+    void Run();
+
+    std::shared_ptr<Room> room;
+    std::vector<InstanceHandle> handles;  // Reserved, one per placement
+    InstancePool pool;
+    std::vector<Instance*> built;
+    std::vector<InstanceHandle> unused;   // Handles of placements naming no object
+    std::thread thread;
+    std::atomic<bool> ready{ false };
+    bool finished = false;
+};
+
+} // namespace GM
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// x86 SIMD kernels are compiled per-function for their target ISA and selected
+// at runtime, so the library itself still builds for the baseline architecture.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GM_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define GM_TARGET_SSE2
+#define GM_TARGET_AVX2
+#define GM_TARGET_AVX2_EXACT
+#else
+#define GM_TARGET_SSE2 __attribute__((target("sse2")))
+#define GM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+// No FMA, so a*b+c can't be contracted; for kernels that must match the scalar path bit for bit
+#define GM_TARGET_AVX2_EXACT __attribute__((target("avx2")))
+#endif
+#else
+#define GM_SIMD_X86 0
+#endif
+
+namespace GM {
+
+enum class SimdLevel {
+    Scalar = 0,
+    SSE2 = 1,
+    AVX2 = 2,
+};
+
+// Highest level supported by the CPU and OS (detected once)
+SimdLevel GetDetectedSimdLevel();
+
+// Level kernels should dispatch to; defaults to the detected level
+SimdLevel GetSimdLevel();
+
+// Overrides the dispatch level (clamped to the detected level), e.g. for benchmarks
+void SetSimdLevel(SimdLevel level);
+
+const char* SimdLevelName(SimdLevel level);
+
+} // namespace GM
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "Instance.h"
+#include <cstdint>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Uniform-grid broadphase over instance bounding boxes
+ *
+ * The grid covers the room; boxes outside it are clamped into the border
+ * cells, so nothing is ever lost. Each proxy remembers the cell range it
+ * occupies and Update only relinks it when that range changes, which for
+ * typical per-step movement is rare. Queries visit the cells under an area
+ * and report each overlapping proxy once (tracked with a per-query stamp
+ * instead of a set). Instances much larger than a cell, or rooms where
+ * everything crowds into a few cells, are better served by AABBTree.
+ */
+class SpatialGrid {
+public:
+    static constexpr double MIN_CELL_SIZE = 64.0;
+    static constexpr size_t MAX_CELLS = 1 << 16;
+
+    SpatialGrid(double width = 1024, double height = 768);
+
+    // Re-bins every proxy into a grid covering width x height. The cell size
+    // grows past MIN_CELL_SIZE only when that would exceed MAX_CELLS.
+    void Resize(double width, double height);
+    double GetWidth() const { return width; }
+    double GetHeight() const { return height; }
+    double GetCellSize() const { return cell_size; }
+
+    ProxyId Insert(const Rect& box, InstanceHandle owner);
+    void Update(ProxyId proxy, const Rect& box);
+    void Remove(ProxyId proxy);
+    size_t GetProxyCount() const { return proxy_count; }
+
+    // Calls fn(owner, box) for every proxy whose box touches area (closed
+    // test, so a zero-size area works for points); callers apply the exact
+    // shape test. fn returns false to stop early and must not modify or
+    // query the grid itself.
+    template <typename Fn>
+    void Query(const Rect& area, Fn&& fn) {
+        CellRange range = CellsFor(area);
+        uint32_t stamp = NextStamp();
+        for (uint32_t cy = range.y0; cy <= range.y1; cy++) {
+            for (uint32_t cx = range.x0; cx <= range.x1; cx++) {
+                for (ProxyId id : cells[cy * columns + cx]) {
+                    Proxy& proxy = proxies[id];
+                    if (proxy.stamp == stamp) continue;
+                    proxy.stamp = stamp;
+                    if (BoxTouches(proxy.box, area) && !fn(proxy.owner, proxy.box)) return;
+                }
+            }
+        }
+    }
+
+    // Calls fn(a, b) once for every pair of overlapping proxies. A pair that
+    // shares several cells is only reported from the cell holding the
+    // top-left corner of its intersection. fn returns false to stop early.
+    template <typename Fn>
+    void QueryPairs(Fn&& fn) {
+        for (uint32_t cy = 0; cy < rows; cy++) {
+            for (uint32_t cx = 0; cx < columns; cx++) {
+                const auto& cell = cells[cy * columns + cx];
+                for (size_t i = 0; i < cell.size(); i++) {
+                    const Proxy& a = proxies[cell[i]];
+                    for (size_t j = i + 1; j < cell.size(); j++) {
+                        const Proxy& b = proxies[cell[j]];
+                        if (!BoxOverlaps(a.box, b.box)) continue;
+                        if (CellCoord(std::max(a.box.x1, b.box.x1), columns) != cx ||
+                            CellCoord(std::max(a.box.y1, b.box.y1), rows) != cy) continue;
+                        if (!fn(a.owner, b.owner)) return;
+                    }
+                }
+            }
+        }
+    }
+
+    // Walks the cells the segment (x1, y1)-(x2, y2) crosses, in order, and
+    // calls fn(owner, box, t) for each box it hits, t being the entry
+    // fraction along the segment. fn returns the new upper bound on t:
+    // return t to look only for nearer hits, 1 to keep going, or a negative
+    // value to stop.
+    template <typename Fn>
+    void RayCast(double x1, double y1, double x2, double y2, Fn&& fn) {
+        const double dx = x2 - x1, dy = y2 - y1;
+        double max_t = 1.0;
+        uint32_t stamp = NextStamp();
+        uint32_t cx = CellCoord(x1, columns), cy = CellCoord(y1, rows);
+        for (;;) {
+            for (ProxyId id : cells[cy * columns + cx]) {
+                Proxy& proxy = proxies[id];
+                if (proxy.stamp == stamp) continue;
+                proxy.stamp = stamp;
+                double t;
+                if (SegmentEntry(proxy.box, x1, y1, dx, dy, max_t, t)) {
+                    max_t = std::min(max_t, fn(proxy.owner, proxy.box, t));
+                    if (max_t < 0) return;
+                }
+            }
+
+            // Border cells extend to infinity, so they have no outer boundary
+            double tx = BoundaryFraction(x1, dx, cx, columns);
+            double ty = BoundaryFraction(y1, dy, cy, rows);
+            double t_next = std::min(tx, ty);
+            if (t_next > max_t) return;
+            if (tx <= ty) cx = dx > 0 ? cx + 1 : cx - 1;
+            else cy = dy > 0 ? cy + 1 : cy - 1;
+        }
+    }
+
+private:
+    struct CellRange {
+        uint32_t x0, y0, x1, y1;
+        bool operator==(const CellRange& o) const { return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1; }
+    };
+
+    struct Proxy {
+        Rect box;
+        InstanceHandle owner = INVALID_INSTANCE;
+        CellRange range = {};
+        uint32_t stamp = 0;
+        ProxyId next_free = NULL_PROXY;
+    };
+
+    CellRange CellsFor(const Rect& box) const;
+    uint32_t CellCoord(double v, uint32_t count) const;
+    double BoundaryFraction(double origin, double delta, uint32_t cell, uint32_t count) const;
+    void Link(ProxyId id);
+    void Unlink(ProxyId id);
+    uint32_t NextStamp();
+
+    double width = 0, height = 0;
+    double cell_size = MIN_CELL_SIZE;
+    uint32_t columns = 1, rows = 1;
+    std::vector<std::vector<ProxyId>> cells;
+
+    std::vector<Proxy> proxies;
+    ProxyId free_proxy = NULL_PROXY;
+    size_t proxy_count = 0;
+    uint32_t query_stamp = 0;
+};
+
+} // namespace GM
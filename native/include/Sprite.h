@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GMLTypes.h"
+#include "CollisionMask.h"
 #include <vector>
 #include <memory>
 #include <cstdint>
@@ -79,14 +80,25 @@ public:
     bool GetPreload() const { return preload; }
     void SetPreload(bool val) { preload = val; }
 
-    // Bounding box
+    // Bounding box, in frame pixels (half-open), shared by all frames
     const Rect& GetBBox() const { return bbox; }
     void SetBBox(const Rect& bb) { bbox = bb; }
 
+    // Recomputes the bbox for the bbox mode: automatic fits the solid pixels
+    // (alpha above tolerance, or the masks once generated), full covers the
+    // whole frame, and manual boxes are left as set
+    void ComputeBBox(uint8_t tolerance = 0);
+
     // Collision
     SpriteCollisionType GetCollisionType() const { return collision_type; }
     void SetCollisionType(SpriteCollisionType type) { collision_type = type; }
 
+    // Precise collision masks, one per frame, built from the frame textures'
+    // alpha (pixels with alpha above tolerance are solid)
+    void GenerateMasks(uint8_t tolerance = 0);
+    void SetMask(uint32_t frame_index, CollisionMask mask);
+    const CollisionMask* GetMask(uint32_t frame_index) const;
+
     // Speed
     double GetPlaybackSpeed() const { return playback_speed; }
     void SetPlaybackSpeed(double speed) { playback_speed = speed; }
@@ -117,6 +129,7 @@ private:
     bool preload = true;
     Rect bbox;
     SpriteCollisionType collision_type = SpriteCollisionType::AxisAlignedRect;
+    std::vector<CollisionMask> masks;
     double playback_speed = 1.0;
     PlaybackSpeedType playback_speed_type = PlaybackSpeedType::FramesPerSecond;
     int bbox_mode = 0;
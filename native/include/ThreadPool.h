@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GM {
+
+/**
+ * Work-stealing thread pool for data-parallel passes
+ *
+ * ParallelFor cuts a range into chunks and deals each thread a contiguous
+ * block of them. Threads take chunks from the front of their own block and,
+ * once it is empty, steal from the back of another thread's, so uneven
+ * chunks (a few expensive events) still balance. The calling thread works
+ * too. Workers are started on the first call that needs them and sleep
+ * between calls.
+ */
+class ThreadPool {
+public:
+    using ChunkFn = std::function<void(size_t chunk, size_t begin, size_t end)>;
+
+    // Counting the calling thread; 0 uses one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const { return thread_count; }
+
+    // Calls fn for every chunk of [0, count): chunk c covers
+    // [c * chunk_size, min((c + 1) * chunk_size, count)). Returns once all
+    // have run. With one chunk or one thread everything runs inline, in
+    // order. Not reentrant: fn must not call ParallelFor.
+    void ParallelFor(size_t count, size_t chunk_size, const ChunkFn& fn);
+
+    static size_t ChunkCount(size_t count, size_t chunk_size) {
+        return chunk_size ? (count + chunk_size - 1) / chunk_size : 0;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> chunks;
+    };
+
+    void StartWorkers();
+    void WorkerLoop(size_t index);
+    bool RunChunk(size_t index);  // Own chunk first, else steal; false if none left
+
+    size_t thread_count;
+    std::vector<std::thread> workers;
+    std::unique_ptr<Queue[]> queues;
+
+    // The running call, published under mutex before its chunks are dealt
+    const ChunkFn* current = nullptr;
+    size_t current_count = 0;
+    size_t current_chunk_size = 0;
+    std::atomic<size_t> remaining{ 0 };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t job = 0;
+    size_t active = 0;  // Workers inside a call
+    bool stopping = false;
+};
+
+} // namespace GM
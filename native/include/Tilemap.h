@@ -0,0 +1,223 @@
+#pragma once
+
+#include "GMLTypes.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class IRenderer;
+
+namespace GM {
+
+class RoomManager;
+class VirtualMachine;
+
+/**
+ * The grid of tiles on a Tiles layer
+ *
+ * Cells hold GML tile data: the tile's index in the tileset in the low
+ * bits and the mirror, flip and rotate flags above it; 0 is an empty cell.
+ * The grid is cut into CHUNK_SIZE x CHUNK_SIZE chunks, allocated when a
+ * tile is first set in them and freed when they empty again, so empty
+ * space costs one pointer per chunk. Each chunk keeps a bitmap of its
+ * non-empty cells, one word per row, so area queries test a row of a
+ * chunk at a time.
+ *
+ * Cells are 32 bits wide, or 16 with Bits16, which keeps the index in the
+ * low 13 bits and the flags in the top three. Setting data that doesn't
+ * fit widens the whole map to 32 bits.
+ *
+ * Each chunk also caches its draw batch: one quad per run of identical
+ * tiles along a row. Setting a cell marks its row of the chunk dirty, and
+ * Draw only visits the chunks under the view, rebuilding just the dirty
+ * rows' runs of those.
+ */
+class Tilemap {
+public:
+    static constexpr uint32_t CHUNK_SHIFT = 5;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_SHIFT;  // Cells per chunk side, one bitmap word per row
+
+    // GML tile data
+    static constexpr uint32_t TILE_INDEX_MASK = 0x7FFFF;
+    static constexpr uint32_t TILE_MIRROR = 1u << 28;
+    static constexpr uint32_t TILE_FLIP = 1u << 29;
+    static constexpr uint32_t TILE_ROTATE = 1u << 30;
+    static constexpr uint32_t TILE_DATA_MASK = TILE_INDEX_MASK | TILE_MIRROR | TILE_FLIP | TILE_ROTATE;
+
+    enum class CellFormat { Bits16, Bits32 };
+
+    // A run of identical tiles: world-space corners and the run's length
+    // in cells, for a textured renderer to repeat the tile across
+    struct Quad {
+        float x1, y1, x2, y2;
+        uint32_t tile;
+        uint32_t run;
+    };
+
+    Tilemap(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height,
+            CellFormat format = CellFormat::Bits32);
+    ~Tilemap();
+
+    Tilemap(const Tilemap&) = delete;
+    Tilemap& operator=(const Tilemap&) = delete;
+
+    // Size in cells and cell size in pixels
+    uint32_t GetWidth() const { return width; }
+    uint32_t GetHeight() const { return height; }
+    uint32_t GetTileWidth() const { return tile_width; }
+    uint32_t GetTileHeight() const { return tile_height; }
+    CellFormat GetCellFormat() const { return format; }
+
+    // Position of the top-left cell in the room. Moving the map rebuilds
+    // every batch.
+    double GetX() const { return x; }
+    double GetY() const { return y; }
+    void SetPosition(double new_x, double new_y);
+
+    // Tileset (background or sprite) the tile indices refer to
+    uint32_t GetTileset() const { return tileset; }
+    void SetTileset(uint32_t id) { tileset = id; }
+
+    // tilemap_get / tilemap_set. Get returns 0 for empty cells and cells
+    // outside the map; Set fails outside it. Bits outside TILE_DATA_MASK
+    // are dropped.
+    uint32_t Get(int64_t cell_x, int64_t cell_y) const {
+        // Negative cells wrap to huge unsigned values, so one compare per axis
+        if ((uint64_t)cell_x >= width || (uint64_t)cell_y >= height) return 0;
+        return ReadAt((uint32_t)cell_x, (uint32_t)cell_y);
+    }
+    bool Set(int64_t cell_x, int64_t cell_y, uint32_t data);
+    void Clear();
+
+    // The cell under a room position, or -1 outside the map
+    int64_t GetCellX(double px) const { return CellAt(px - x, tile_width, inverse_tile_width, exact_x, width); }
+    int64_t GetCellY(double py) const { return CellAt(py - y, tile_height, inverse_tile_height, exact_y, height); }
+
+    // tilemap_get_at_pixel: the tile under a room position, 0 if none.
+    // CellAt has already bounded the cell, so it is read unchecked.
+    uint32_t GetAtPixel(double px, double py) const {
+        int64_t cell_x = GetCellX(px), cell_y = GetCellY(py);
+        if (cell_x < 0 || cell_y < 0) return 0;
+        return ReadAt((uint32_t)cell_x, (uint32_t)cell_y);
+    }
+
+    // Whether any non-empty cell touches area (closed test, like the
+    // broadphase), for tile collisions
+    bool Overlaps(const Rect& area) const;
+
+    // Non-empty cells, and the chunks holding them
+    size_t GetTileCount() const { return tile_count; }
+    size_t GetChunkCount() const { return chunk_count; }
+
+    // Draws the chunks under view (room coordinates), rebuilding their
+    // batches first where cells changed. With a null renderer the batches
+    // are still brought up to date.
+    void Draw(IRenderer* renderer, const Rect& view);
+
+    // Calls fn(quad) for every quad of the chunks under view, rebuilding
+    // as Draw does
+    template <typename Fn>
+    void ForEachQuad(const Rect& view, Fn&& fn) {
+        ChunkRange range = ChunksFor(view);
+        for (uint32_t cy = range.y0; cy < range.y1; cy++) {
+            for (uint32_t cx = range.x0; cx < range.x1; cx++) {
+                Chunk* chunk = chunks[(size_t)cy * chunks_x + cx].get();
+                if (!chunk) continue;
+                if (chunk->dirty_rows) BuildBatch(*chunk, cx, cy);
+                for (const Quad& quad : chunk->batch) fn(quad);
+            }
+        }
+    }
+
+    // Batches brought up to date so far, and the rows rebuilt for them
+    size_t GetRebuildCount() const { return rebuilds; }
+    size_t GetRowRebuildCount() const { return row_rebuilds; }
+
+    // Bytes held by the chunks' cells, bitmaps and batches
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr uint32_t CHUNK_MASK = CHUNK_SIZE - 1;
+    static constexpr uint32_t ALL_ROWS = ~0u;
+
+    struct Chunk {
+        std::vector<uint16_t> narrow;  // Bits16
+        std::vector<uint32_t> wide;    // Bits32
+        uint32_t rows[CHUNK_SIZE] = {};  // Bit x of word y: cell (x, y) is non-empty
+        uint32_t count = 0;
+        uint32_t dirty_rows = ALL_ROWS;  // Bit y: row y's runs in batch are stale
+        uint8_t row_quads[CHUNK_SIZE] = {};  // Quads of each row in batch, which holds the rows in order
+        std::vector<Quad> batch;
+    };
+
+    struct ChunkRange {
+        uint32_t x0, y0, x1, y1;  // Half-open
+    };
+
+    // Bits16 cells: the index in the low 13 bits, the flags moved down
+    // into the top three
+    static constexpr uint32_t NARROW_INDEX_MASK = (1u << 13) - 1;
+    static constexpr uint32_t NARROW_FLAG_SHIFT = 28 - 13;
+
+    static bool Fits16(uint32_t data);
+    static uint16_t Pack16(uint32_t data);
+    static uint32_t Unpack16(uint16_t cell) {
+        return (cell & NARROW_INDEX_MASK) | (uint32_t)(cell & ~NARROW_INDEX_MASK) << NARROW_FLAG_SHIFT;
+    }
+
+    // Cell under an offset from the map's edge, or -1 outside count cells.
+    // Multiplying by the reciprocal keeps a divide off the lookup's path.
+    // For power-of-two sizes the reciprocal is exact; otherwise the
+    // product can land a cell off right on a boundary, so it is corrected
+    // against the exact size.
+    static int64_t CellAt(double offset, double size, double inverse, bool exact, uint32_t count) {
+        double scaled = offset * inverse;
+        if (!(scaled >= 0 && scaled < count + 1.0)) return -1;
+        uint32_t cell = (uint32_t)scaled;
+        if (!exact) {
+            if (cell * size > offset) cell--;
+            else if ((cell + 1) * size <= offset) cell++;
+        }
+        return cell < count ? (int64_t)cell : -1;
+    }
+
+    // A cell known to be inside the map
+    uint32_t ReadAt(uint32_t cell_x, uint32_t cell_y) const {
+        const void* data = cells[(size_t)(cell_y >> CHUNK_SHIFT) * chunks_x + (cell_x >> CHUNK_SHIFT)];
+        if (!data) return 0;
+        uint32_t index = (cell_y & CHUNK_MASK) << CHUNK_SHIFT | (cell_x & CHUNK_MASK);
+        return format == CellFormat::Bits16 ? Unpack16(static_cast<const uint16_t*>(data)[index])
+                                            : static_cast<const uint32_t*>(data)[index];
+    }
+    uint32_t ReadCell(const Chunk& chunk, uint32_t index) const {
+        return format == CellFormat::Bits16 ? Unpack16(chunk.narrow[index]) : chunk.wide[index];
+    }
+    void Widen();
+    ChunkRange ChunksFor(const Rect& view) const;
+    void BuildBatch(Chunk& chunk, uint32_t cx, uint32_t cy);
+    uint32_t BuildRow(const Chunk& chunk, uint32_t cx, uint32_t cy, uint32_t row, Quad* out) const;
+
+    uint32_t width, height;
+    uint32_t tile_width, tile_height;
+    double inverse_tile_width, inverse_tile_height;
+    bool exact_x, exact_y;  // Power-of-two tile sizes, whose reciprocals are exact
+    CellFormat format;
+    double x = 0, y = 0;
+    uint32_t tileset = 0;
+
+    uint32_t chunks_x, chunks_y;
+    std::vector<std::unique_ptr<Chunk>> chunks;  // Row-major, null while empty
+    std::vector<const void*> cells;  // Each chunk's cell array, so lookups skip the chunk itself
+    size_t chunk_count = 0;
+    size_t tile_count = 0;
+    size_t rebuilds = 0;
+    size_t row_rebuilds = 0;
+};
+
+// tilemap_get, tilemap_set, tilemap_get_at_pixel, tilemap_set_at_pixel,
+// tilemap_get_cell_x_at_pixel / y, tilemap_get_width / height and
+// layer_tilemap_get_id against the current room. A tilemap is named by
+// the id of the layer holding it.
+void RegisterTilemapBuiltins(VirtualMachine& vm, RoomManager& rooms);
+
+} // namespace GM
@@ -5,6 +5,8 @@
 #include <stack>
 #include <map>
 #include <memory>
+#include <functional>
+#include <unordered_map>
 #include "VM_Value.h"
 #include "VM_Instruction.h"
 
@@ -29,6 +31,8 @@ struct ExecutionFrame {
  */
 class VirtualMachine {
 public:
+    using BuiltInFunction = std::function<Value(const std::vector<Value>& args)>;
+
     VirtualMachine();
     ~VirtualMachine() = default;
 
@@ -36,6 +40,10 @@ public:
     void AddCodeBlock(const CodeBlock& block);
     void LoadCodeBlocks(const std::vector<CodeBlock>& blocks);
 
+    // Native built-in functions, resolved by CALL when no code block matches
+    void RegisterBuiltIn(const std::string& name, BuiltInFunction fn);
+    bool HasBuiltIn(const std::string& name) const;
+
     // Execution
     Value ExecuteFunction(const std::string& functionName);
     bool IsValid() const { return !codeBlocks_.empty(); }
@@ -47,6 +55,7 @@ public:
 private:
     // Code storage
     std::map<std::string, CodeBlock> codeBlocks_;
+    std::unordered_map<std::string, BuiltInFunction> builtIns_;
     
     // Execution state
     std::stack<Value> stack_;
@@ -4,12 +4,22 @@
 #include <variant>
 #include <memory>
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <utility>
 
 namespace GM {
 
+class Value;
+class Struct;
+
+// GML arrays and structs are reference types shared between values
+using Array = std::vector<Value>;
+
 /**
  * GML Value - Dynamically typed value that can hold any GML data type
- * Supports: real (double), string, bool, undefined
+ * Supports: real (double), string, bool, undefined, array, struct
  */
 class Value {
 public:
@@ -17,15 +27,23 @@ public:
         UNDEFINED,
         REAL,
         STRING,
-        BOOL
+        BOOL,
+        ARRAY,
+        STRUCT
     };
 
     // Constructors
     Value();
     Value(double real);
     Value(const std::string& str);
+    Value(std::string&& str);
     Value(bool b);
     Value(const char* str);
+    Value(std::shared_ptr<Array> arr);
+    Value(std::shared_ptr<Struct> obj);
+
+    static Value MakeArray();
+    static Value MakeStruct();
     
     // Type checking
     Type GetType() const { return type_; }
@@ -33,12 +51,21 @@ public:
     bool IsString() const { return type_ == Type::STRING; }
     bool IsBool() const { return type_ == Type::BOOL; }
     bool IsUndefined() const { return type_ == Type::UNDEFINED; }
+    bool IsArray() const { return type_ == Type::ARRAY; }
+    bool IsStruct() const { return type_ == Type::STRUCT; }
 
     // Conversions
     double AsReal() const;
     std::string AsString() const;
     bool AsBool() const;
 
+    // Direct access to string storage (only valid when IsString())
+    const std::string& GetStringRef() const { return std::get<std::string>(data_); }
+
+    // Shared array/struct storage; nullptr for other types
+    Array* GetArray() const { return IsArray() ? std::get<std::shared_ptr<Array>>(data_).get() : nullptr; }
+    Struct* GetStruct() const { return IsStruct() ? std::get<std::shared_ptr<Struct>>(data_).get() : nullptr; }
+
     // Operators
     Value operator+(const Value& other) const;
     Value operator-(const Value& other) const;
@@ -69,7 +96,40 @@ public:
 
 private:
     Type type_;
-    std::variant<double, std::string, bool> data_;
+    std::variant<double, std::string, bool, std::shared_ptr<Array>, std::shared_ptr<Struct>> data_;
+};
+
+// Saturating real to integer conversion for built-in arguments; GML truncates
+// towards zero, and NaN becomes 0
+int64_t ToInt64(double v);
+
+/**
+ * GML struct - members keep insertion order; a hash index is built once the
+ * struct outgrows a short linear scan
+ */
+class Struct {
+public:
+    using Member = std::pair<std::string, Value>;
+
+    size_t Size() const { return members.size(); }
+    void Reserve(size_t n) { members.reserve(n); }
+
+    Value* Find(const std::string& name);
+    const Value* Find(const std::string& name) const;
+    bool Contains(const std::string& name) const { return Find(name) != nullptr; }
+    void Set(std::string name, Value val);
+    bool Remove(const std::string& name);
+
+    const std::vector<Member>& GetMembers() const { return members; }
+
+private:
+    static constexpr size_t INDEX_THRESHOLD = 8;
+
+    int64_t IndexOf(const std::string& name) const;
+    void RebuildIndex();
+
+    std::vector<Member> members;
+    std::unordered_map<std::string, size_t> index;
 };
 
 } // namespace GM
@@ -0,0 +1,230 @@
+#include "../include/AABBTree.h"
+#include <algorithm>
+
+namespace GM {
+
+static Rect Union(const Rect& a, const Rect& b) {
+    return { std::min(a.x1, b.x1), std::min(a.y1, b.y1), std::max(a.x2, b.x2), std::max(a.y2, b.y2) };
+}
+
+// Surface-area heuristic in 2D
+static double Perimeter(const Rect& r) {
+    return 2.0 * ((r.x2 - r.x1) + (r.y2 - r.y1));
+}
+
+static Rect Fatten(const Rect& box, double dx, double dy) {
+    Rect fat = { box.x1 - AABBTree::FAT_MARGIN, box.y1 - AABBTree::FAT_MARGIN,
+                 box.x2 + AABBTree::FAT_MARGIN, box.y2 + AABBTree::FAT_MARGIN };
+    dx *= AABBTree::DISPLACEMENT_SCALE;
+    dy *= AABBTree::DISPLACEMENT_SCALE;
+    if (dx < 0) fat.x1 += dx; else fat.x2 += dx;
+    if (dy < 0) fat.y1 += dy; else fat.y2 += dy;
+    return fat;
+}
+
+// ============================================================================
+// Node pool
+// ============================================================================
+
+int32_t AABBTree::AllocateNode() {
+    if (free_node == NULL_NODE) {
+        nodes.emplace_back();
+        return (int32_t)nodes.size() - 1;
+    }
+    int32_t id = free_node;
+    free_node = nodes[id].parent;
+    nodes[id] = Node();
+    return id;
+}
+
+void AABBTree::FreeNode(int32_t id) {
+    nodes[id].parent = free_node;
+    nodes[id].height = -1;
+    nodes[id].owner = INVALID_INSTANCE;
+    free_node = id;
+}
+
+// ============================================================================
+// Proxies
+// ============================================================================
+
+ProxyId AABBTree::Insert(const Rect& box, InstanceHandle owner) {
+    int32_t leaf = AllocateNode();
+    Node& node = nodes[leaf];
+    node.box = box;
+    node.fat = Fatten(box, 0, 0);
+    node.owner = owner;
+    node.height = 0;
+    InsertLeaf(leaf);
+    proxy_count++;
+    return (ProxyId)leaf;
+}
+
+void AABBTree::Update(ProxyId proxy, const Rect& box) {
+    int32_t leaf = (int32_t)proxy;
+    Node& node = nodes[leaf];
+    Rect fat = Fatten(box, box.x1 - node.box.x1, box.y1 - node.box.y1);
+    node.box = box;
+
+    // Refit in place while the old fat box still covers the bbox, unless it
+    // has grown far larger than needed (an instance that stopped moving)
+    if (BoxContains(node.fat, box)) {
+        const double slack = 4.0 * FAT_MARGIN;
+        Rect loose = { fat.x1 - slack, fat.y1 - slack, fat.x2 + slack, fat.y2 + slack };
+        if (BoxContains(loose, node.fat)) return;
+    }
+
+    RemoveLeaf(leaf);
+    nodes[leaf].fat = fat;
+    InsertLeaf(leaf);
+}
+
+void AABBTree::Remove(ProxyId proxy) {
+    int32_t leaf = (int32_t)proxy;
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    proxy_count--;
+}
+
+// ============================================================================
+// Tree maintenance
+// ============================================================================
+
+void AABBTree::InsertLeaf(int32_t leaf) {
+    if (root == NULL_NODE) {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // Descend towards the sibling that grows the tree's perimeter the least
+    const Rect leaf_box = nodes[leaf].fat;
+    int32_t index = root;
+    while (!nodes[index].IsLeaf()) {
+        const Node& node = nodes[index];
+        double area = Perimeter(node.fat);
+        double combined = Perimeter(Union(node.fat, leaf_box));
+
+        // Cost of pairing with this node, and the cost pushed onto every
+        // ancestor by descending further
+        double cost = 2.0 * combined;
+        double inheritance = 2.0 * (combined - area);
+
+        auto child_cost = [&](int32_t child) {
+            const Rect& child_box = nodes[child].fat;
+            double grown = Perimeter(Union(child_box, leaf_box));
+            if (nodes[child].IsLeaf()) return grown + inheritance;
+            return grown - Perimeter(child_box) + inheritance;
+        };
+        double cost1 = child_cost(node.child1);
+        double cost2 = child_cost(node.child2);
+
+        if (cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    // Replace the sibling with a branch holding both (may reallocate nodes)
+    int32_t sibling = index;
+    int32_t old_parent = nodes[sibling].parent;
+    int32_t new_parent = AllocateNode();
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].fat = Union(leaf_box, nodes[sibling].fat);
+    nodes[new_parent].height = nodes[sibling].height + 1;
+    nodes[new_parent].child1 = sibling;
+    nodes[new_parent].child2 = leaf;
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if (old_parent == NULL_NODE) {
+        root = new_parent;
+    } else if (nodes[old_parent].child1 == sibling) {
+        nodes[old_parent].child1 = new_parent;
+    } else {
+        nodes[old_parent].child2 = new_parent;
+    }
+
+    Refit(new_parent);
+}
+
+void AABBTree::RemoveLeaf(int32_t leaf) {
+    if (leaf == root) {
+        root = NULL_NODE;
+        return;
+    }
+
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandparent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    // The sibling takes the parent's place
+    if (grandparent == NULL_NODE) {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+        return;
+    }
+    if (nodes[grandparent].child1 == parent) nodes[grandparent].child1 = sibling;
+    else nodes[grandparent].child2 = sibling;
+    nodes[sibling].parent = grandparent;
+    FreeNode(parent);
+
+    Refit(grandparent);
+}
+
+// Walks from id to the root, rebalancing and recomputing boxes and heights
+void AABBTree::Refit(int32_t id) {
+    while (id != NULL_NODE) {
+        id = Balance(id);
+        Node& node = nodes[id];
+        const Node& a = nodes[node.child1];
+        const Node& b = nodes[node.child2];
+        node.height = 1 + std::max(a.height, b.height);
+        node.fat = Union(a.fat, b.fat);
+        id = node.parent;
+    }
+}
+
+// If one child of a is two or more levels taller than the other, rotates
+// it up to take a's place. Returns the index now at a's position.
+int32_t AABBTree::Balance(int32_t ia) {
+    Node& a = nodes[ia];
+    if (a.IsLeaf() || a.height < 2) return ia;
+
+    int32_t ib = a.child1, ic = a.child2;
+    int32_t balance = nodes[ic].height - nodes[ib].height;
+    if (balance >= -1 && balance <= 1) return ia;
+
+    // Rotate the taller child (up) above a; lo is the other child of a
+    bool right = balance > 1;
+    int32_t iup = right ? ic : ib;
+    int32_t ilo = right ? ib : ic;
+    Node& up = nodes[iup];
+    int32_t i1 = up.child1, i2 = up.child2;
+
+    up.child1 = ia;
+    up.parent = a.parent;
+    a.parent = iup;
+    if (up.parent == NULL_NODE) {
+        root = iup;
+    } else if (nodes[up.parent].child1 == ia) {
+        nodes[up.parent].child1 = iup;
+    } else {
+        nodes[up.parent].child2 = iup;
+    }
+
+    // up keeps its taller grandchild; a adopts the shorter one in up's place
+    int32_t keep = nodes[i1].height > nodes[i2].height ? i1 : i2;
+    int32_t give = keep == i1 ? i2 : i1;
+    up.child2 = keep;
+    if (right) a.child2 = give;
+    else a.child1 = give;
+    nodes[give].parent = ia;
+
+    a.fat = Union(nodes[ilo].fat, nodes[give].fat);
+    a.height = 1 + std::max(nodes[ilo].height, nodes[give].height);
+    up.fat = Union(a.fat, nodes[keep].fat);
+    up.height = 1 + std::max(a.height, nodes[keep].height);
+    return iup;
+}
+
+} // namespace GM
@@ -0,0 +1,58 @@
+#include "../include/AlarmWheel.h"
+
+namespace GM {
+
+void AlarmWheel::Schedule(const Entry& entry) {
+    if (entry.due <= step) return;
+    Place(entry);
+    count++;
+}
+
+void AlarmWheel::Place(const Entry& entry) {
+    // The level is set by the highest bit where due and step differ, so an
+    // entry cascades down exactly when the step counter catches up with its
+    // upper bits
+    uint64_t diff = entry.due ^ step;
+    for (int level = 0; level < LEVELS; level++) {
+        if (diff < (1ull << (LEVEL_BITS * (level + 1)))) {
+            slots[level][(entry.due >> (LEVEL_BITS * level)) & (SLOTS - 1)].push_back(entry);
+            return;
+        }
+    }
+    overflow.push_back(entry);
+}
+
+void AlarmWheel::Cascade(int level) {
+    std::vector<Entry> moving;
+    if (level == LEVELS) {
+        moving.swap(overflow);
+    } else {
+        moving.swap(slots[level][(step >> (LEVEL_BITS * level)) & (SLOTS - 1)]);
+    }
+    for (const Entry& entry : moving) Place(entry);
+}
+
+void AlarmWheel::Advance(std::vector<Entry>& out) {
+    step++;
+
+    // Find the highest level whose span just rolled over and pour its
+    // current slot down, top first so each level refills the one below
+    int top = 0;
+    while (top < LEVELS && (step & ((1ull << (LEVEL_BITS * (top + 1))) - 1)) == 0) top++;
+    for (int level = top; level >= 1; level--) Cascade(level);
+
+    std::vector<Entry>& due = slots[0][step & (SLOTS - 1)];
+    count -= due.size();
+    out.insert(out.end(), due.begin(), due.end());
+    due.clear();
+}
+
+void AlarmWheel::Clear() {
+    for (auto& level : slots) {
+        for (auto& slot : level) slot.clear();
+    }
+    overflow.clear();
+    count = 0;
+}
+
+} // namespace GM
@@ -78,6 +78,8 @@ bool AssetLoader::LoadGameFromJSON(const std::string& json_path, ProgressCallbac
         return false;
     }
     
+    GameGlobals::Get().GetObjectManager().BuildDispatchTables();
+    
     std::cout << "[AssetLoader] Loading rooms..." << std::endl;
     if (!LoadRooms(game_data)) {
         std::cerr << "[AssetLoader] Failed to load rooms" << std::endl;
@@ -207,6 +209,24 @@ bool AssetLoader::LoadSprites(const json& game_data) {
             if (sprite_data.contains("yorigin")) {
                 sprite->SetYOrigin(sprite_data["yorigin"]);
             }
+
+            // Precise sprites get their per-frame masks now, not at first collision
+            if (sprite_data.contains("collision_kind")) {
+                sprite->SetCollisionType((SpriteCollisionType)(int)sprite_data["collision_kind"]);
+            }
+            uint8_t tolerance = (uint8_t)sprite_data.value("collision_tolerance", 0);
+            if (sprite->GetCollisionType() == SpriteCollisionType::Precise) {
+                sprite->GenerateMasks(tolerance);
+            }
+
+            // Bounding box (bbox_right/bottom are inclusive pixels, as in GML)
+            sprite->SetBBoxMode(sprite_data.value("bbox_mode", 0));
+            if (sprite->GetBBoxMode() == 2) {
+                sprite->SetBBox(Rect(sprite_data.value("bbox_left", 0), sprite_data.value("bbox_top", 0),
+                                     sprite_data.value("bbox_right", -1) + 1.0,
+                                     sprite_data.value("bbox_bottom", -1) + 1.0));
+            }
+            sprite->ComputeBBox(tolerance);
             
             sprite_manager.AddSprite(sprite);
             
@@ -247,6 +267,9 @@ bool AssetLoader::LoadObjects(const json& game_data) {
             if (object_data.contains("sprite_index")) {
                 object->SetSpriteIndex(object_data["sprite_index"]);
             }
+            if (object_data.contains("mask_index")) {
+                object->SetMaskIndex(object_data["mask_index"]);
+            }
             
             // Set parent
             if (object_data.contains("parent_index")) {
@@ -284,6 +307,7 @@ bool AssetLoader::LoadObjects(const json& game_data) {
 bool AssetLoader::LoadRooms(const json& game_data) {
     auto& room_manager = GameGlobals::Get().GetRoomManager();
     auto& object_manager = GameGlobals::Get().GetObjectManager();
+    auto& instance_manager = GameGlobals::Get().GetInstanceManager();
     
     std::cout << "[AssetLoader] Checking for rooms... contains: " << game_data.contains("rooms") << std::endl;
     if (game_data.contains("rooms")) {
@@ -320,11 +344,12 @@ bool AssetLoader::LoadRooms(const json& game_data) {
         int x = 20, y = 20;
         uint32_t inst_id = 0;
         for (auto& [tex_name, texture] : textures) {
-            auto inst = std::make_shared<Instance>(x, y, inst_id++, test_obj);
+            InstanceHandle handle = instance_manager.Create(x, y, inst_id++, test_obj.get());
+            Instance* inst = instance_manager.Get(handle);
             inst->SetSpeed(0);
             inst->SetVSpeed(0);
             inst->SetVisible(true);
-            room->AddInstance(inst);
+            room->AddInstance(handle);
             
             x += texture->GetWidth() + 10;
             if (x > 700) {
@@ -385,7 +410,8 @@ bool AssetLoader::LoadRooms(const json& game_data) {
             auto layer = std::make_shared<Layer>(0, "Instances", LayerType::Instances);
             room->AddLayer(layer);
             
-            // Load instances
+            // Load instance placements; the instances are created when the
+            // room is built (see RoomBuilder)
             if (room_data.contains("instances")) {
                 for (const auto& inst_data : room_data["instances"]) {
                     if (inst_data.is_null()) continue;
@@ -403,9 +429,7 @@ bool AssetLoader::LoadRooms(const json& game_data) {
                             object_manager.AddObject(obj);
                         }
                         
-                        auto inst = std::make_shared<Instance>(inst_x, inst_y, inst_id, obj);
-                        inst->SetVisible(true);
-                        room->AddInstance(inst);
+                        room->AddPlacement({ inst_id, obj_id, inst_x, inst_y });
                         
                         std::cout << "[AssetLoader] Room " << room_id << " Instance " << inst_id << ": " << obj->GetName() << " at (" << inst_x << ", " << inst_y << ")" << std::endl;
                     } catch (const std::exception& e) {
@@ -0,0 +1,189 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "../include/AABBTree.h"
+#include "../include/Bench.h"
+#include "../include/Random.h"
+#include "../include/SpatialGrid.h"
+
+// Compares the two collision broadphases on synthetic room layouts: build,
+// per-frame movement, region queries, all-pairs and raycasts. Each layout
+// also checks that both backends report the same hits.
+
+using GM::Bench::Clock;
+using GM::Bench::TimeOp;
+
+struct Layout {
+    std::string name;
+    double width, height;
+    std::vector<GM::Rect> boxes;
+    std::vector<bool> moving;
+};
+
+static GM::Rect Box(double x, double y, double w, double h) {
+    return { x, y, x + w, y + h };
+}
+
+// Evenly sized bullets spread over the room
+static Layout Uniform(size_t count) {
+    GM::RandomGenerator rng(1);
+    Layout layout{ "uniform", 4096, 4096, {}, {} };
+    for (size_t i = 0; i < count; i++) {
+        layout.boxes.push_back(Box(rng.Range(0, 4080), rng.Range(0, 4080), 16, 16));
+        layout.moving.push_back(true);
+    }
+    return layout;
+}
+
+// A hundred huge static solids under a swarm of tiny bullets; each solid
+// covers thousands of grid cells
+static Layout Mixed(size_t count) {
+    GM::RandomGenerator rng(2);
+    Layout layout{ "mixed sizes", 16384, 16384, {}, {} };
+    for (size_t i = 0; i < 100; i++) {
+        layout.boxes.push_back(Box(rng.Range(0, 12288), rng.Range(0, 12288), rng.Range(1024, 4096), rng.Range(1024, 4096)));
+        layout.moving.push_back(false);
+    }
+    for (size_t i = 100; i < count; i++) {
+        layout.boxes.push_back(Box(rng.Range(0, 16380), rng.Range(0, 16380), 4, 4));
+        layout.moving.push_back(true);
+    }
+    return layout;
+}
+
+// Everything crowded into ten hot spots of a large room
+static Layout Clustered(size_t count) {
+    GM::RandomGenerator rng(3);
+    Layout layout{ "clustered", 16384, 16384, {}, {} };
+    std::vector<std::pair<double, double>> centers;
+    for (int c = 0; c < 10; c++) centers.push_back({ rng.Range(512, 15872), rng.Range(512, 15872) });
+    for (size_t i = 0; i < count; i++) {
+        auto& c = centers[i % centers.size()];
+        layout.boxes.push_back(Box(c.first + rng.Range(-256, 256), c.second + rng.Range(-256, 256), 12, 12));
+        layout.moving.push_back(true);
+    }
+    return layout;
+}
+
+// Few instances in a huge room, forcing large grid cells
+static Layout Sparse(size_t count) {
+    GM::RandomGenerator rng(4);
+    Layout layout{ "sparse", 65536, 65536, {}, {} };
+    for (size_t i = 0; i < count; i++) {
+        layout.boxes.push_back(Box(rng.Range(0, 65500), rng.Range(0, 65500), 32, 32));
+        layout.moving.push_back(true);
+    }
+    return layout;
+}
+
+// Most instances outside the room's bounds (a level that scrolls past the
+// room size); the grid clamps them all into its border cells
+static Layout Offscreen(size_t count) {
+    GM::RandomGenerator rng(5);
+    Layout layout{ "offscreen", 1024, 768, {}, {} };
+    for (size_t i = 0; i < count; i++) {
+        layout.boxes.push_back(Box(rng.Range(-4096, 5120), rng.Range(-4096, 4864), 16, 16));
+        layout.moving.push_back(true);
+    }
+    return layout;
+}
+
+struct Results {
+    double build, update, query, pairs, ray;
+    size_t query_hits, pair_hits, ray_hits;
+};
+
+template <typename Broadphase>
+static Results Run(Broadphase& bp, const Layout& layout) {
+    Results r{};
+    std::vector<GM::ProxyId> proxies(layout.boxes.size());
+    std::vector<GM::Rect> boxes = layout.boxes;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < boxes.size(); i++) proxies[i] = bp.Insert(boxes[i], (GM::InstanceHandle)i);
+    r.build = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Bullets drift back and forth so every frame moves them by the same amount
+    int frame = 0;
+    r.update = TimeOp(30, [&] {
+        double step = (frame++ / 8) % 2 ? -3.0 : 3.0;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (!layout.moving[i]) continue;
+            boxes[i].x1 += step;
+            boxes[i].x2 += step;
+            bp.Update(proxies[i], boxes[i]);
+        }
+    });
+
+    GM::RandomGenerator rng(99);
+    std::vector<GM::Rect> areas;
+    std::vector<GM::Rect> rays;
+    for (int i = 0; i < 1000; i++) {
+        areas.push_back(Box(rng.Range(0, layout.width - 128), rng.Range(0, layout.height - 128), 128, 128));
+        double x = rng.Range(0, layout.width), y = rng.Range(0, layout.height);
+        double angle = rng.Range(0, 6.2831853);
+        rays.push_back({ x, y, x + std::cos(angle) * 512, y + std::sin(angle) * 512 });
+    }
+
+    r.query = TimeOp(20, [&] {
+        r.query_hits = 0;
+        for (const GM::Rect& area : areas) {
+            bp.Query(area, [&](GM::InstanceHandle, const GM::Rect&) { r.query_hits++; return true; });
+        }
+    });
+    r.pairs = TimeOp(5, [&] {
+        r.pair_hits = 0;
+        bp.QueryPairs([&](GM::InstanceHandle, GM::InstanceHandle) { r.pair_hits++; return true; });
+    });
+    r.ray = TimeOp(20, [&] {
+        r.ray_hits = 0;
+        for (const GM::Rect& ray : rays) {
+            bool hit = false;
+            bp.RayCast(ray.x1, ray.y1, ray.x2, ray.y2, [&](GM::InstanceHandle, const GM::Rect&, double t) {
+                hit = true;
+                return t;  // Nearest hit
+            });
+            r.ray_hits += hit;
+        }
+    });
+    return r;
+}
+
+int main() {
+    std::cout << std::left << std::setw(14) << "layout" << std::setw(8) << "backend" << std::right
+              << std::setw(12) << "build" << std::setw(12) << "update" << std::setw(12) << "1k queries"
+              << std::setw(12) << "all pairs" << std::setw(12) << "1k rays" << std::endl;
+
+    bool consistent = true;
+    for (const Layout& layout : { Uniform(10000), Mixed(10000), Clustered(10000), Sparse(2000), Offscreen(5000) }) {
+        GM::SpatialGrid grid(layout.width, layout.height);
+        GM::AABBTree tree;
+        Results g = Run(grid, layout);
+        Results t = Run(tree, layout);
+        if (g.query_hits != t.query_hits || g.pair_hits != t.pair_hits || g.ray_hits != t.ray_hits) {
+            consistent = false;
+        }
+
+        auto print = [&](const char* backend, const Results& r) {
+            std::cout << std::left << std::setw(14) << layout.name << std::setw(8) << backend << std::right
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(9) << r.build * 1e3 << " ms" << std::setw(9) << r.update * 1e3 << " ms"
+                      << std::setw(9) << r.query * 1e3 << " ms" << std::setw(9) << r.pairs * 1e3 << " ms"
+                      << std::setw(9) << r.ray * 1e3 << " ms" << std::endl;
+        };
+        print("grid", g);
+        print("tree", t);
+        std::cout << std::left << std::setw(22) << "" << "tree height " << tree.GetHeight() << ", "
+                  << g.pair_hits << " pairs, " << g.ray_hits << " ray hits" << std::endl;
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: grid and tree disagree" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: grid and tree agree on every layout" << std::endl;
+    return 0;
+}
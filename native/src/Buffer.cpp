@@ -0,0 +1,798 @@
+#include "../include/Buffer.h"
+#include "../include/IFileIO.h"
+#include "../include/VM_Executor.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <new>
+
+namespace GM {
+
+namespace {
+
+// Saturating like ToInt64, but keeps the top half of the unsigned range
+uint64_t ToUInt64(double v) {
+    if (v >= 18446744073709551615.0) return std::numeric_limits<uint64_t>::max();
+    if (v >= 9223372036854775808.0) return (uint64_t)v;
+    return (uint64_t)ToInt64(v);
+}
+
+uint16_t FloatToHalf(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));  // Inf / NaN
+    }
+    if (exponent >= 0x1F) return (uint16_t)(sign | 0x7C00);          // Overflow to infinity
+    if (exponent <= 0) {
+        if (exponent < -10) return (uint16_t)sign;                   // Underflow to zero
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;     // Round to nearest even
+    return (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Subnormal: normalise into a float exponent
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+    } else if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+bool IsStringType(BufferDataType type) {
+    return type == BufferDataType::String || type == BufferDataType::Text;
+}
+
+bool IsValidType(int type) {
+    return type >= (int)BufferDataType::U8 && type <= (int)BufferDataType::Text;
+}
+
+// Encodes a fixed-width value little-endian into out; returns the byte count
+size_t EncodeScalar(BufferDataType type, const Value& val, uint8_t* out) {
+    double v = val.AsReal();
+    switch (type) {
+        case BufferDataType::Bool:
+        case BufferDataType::U8:
+        case BufferDataType::S8: {
+            uint8_t b = type == BufferDataType::Bool ? (uint8_t)(val.AsBool() ? 1 : 0) : (uint8_t)ToInt64(v);
+            out[0] = b;
+            return 1;
+        }
+        case BufferDataType::U16:
+        case BufferDataType::S16: {
+            uint16_t x = (uint16_t)ToInt64(v);
+            std::memcpy(out, &x, 2);
+            return 2;
+        }
+        case BufferDataType::F16: {
+            uint16_t x = FloatToHalf((float)v);
+            std::memcpy(out, &x, 2);
+            return 2;
+        }
+        case BufferDataType::U32:
+        case BufferDataType::S32: {
+            uint32_t x = (uint32_t)ToInt64(v);
+            std::memcpy(out, &x, 4);
+            return 4;
+        }
+        case BufferDataType::F32: {
+            float x = (float)v;
+            std::memcpy(out, &x, 4);
+            return 4;
+        }
+        case BufferDataType::F64:
+            std::memcpy(out, &v, 8);
+            return 8;
+        case BufferDataType::U64: {
+            uint64_t x = ToUInt64(v);
+            std::memcpy(out, &x, 8);
+            return 8;
+        }
+        default:
+            return 0;
+    }
+}
+
+Value DecodeScalar(BufferDataType type, const uint8_t* in) {
+    switch (type) {
+        case BufferDataType::Bool: return Value(in[0] == 1);
+        case BufferDataType::U8: return Value((double)in[0]);
+        case BufferDataType::S8: return Value((double)(int8_t)in[0]);
+        case BufferDataType::U16: { uint16_t x; std::memcpy(&x, in, 2); return Value((double)x); }
+        case BufferDataType::S16: { int16_t x; std::memcpy(&x, in, 2); return Value((double)x); }
+        case BufferDataType::F16: { uint16_t x; std::memcpy(&x, in, 2); return Value((double)HalfToFloat(x)); }
+        case BufferDataType::U32: { uint32_t x; std::memcpy(&x, in, 4); return Value((double)x); }
+        case BufferDataType::S32: { int32_t x; std::memcpy(&x, in, 4); return Value((double)x); }
+        case BufferDataType::F32: { float x; std::memcpy(&x, in, 4); return Value((double)x); }
+        case BufferDataType::F64: { double x; std::memcpy(&x, in, 8); return Value(x); }
+        case BufferDataType::U64: { uint64_t x; std::memcpy(&x, in, 8); return Value((double)x); }
+        default: return Value();
+    }
+}
+
+size_t WrapOffset(int64_t offset, size_t size) {
+    int64_t s = (int64_t)size;
+    return (size_t)(((offset % s) + s) % s);
+}
+
+} // namespace
+
+size_t BufferSizeOf(BufferDataType type) {
+    switch (type) {
+        case BufferDataType::Bool:
+        case BufferDataType::U8:
+        case BufferDataType::S8:
+            return 1;
+        case BufferDataType::U16:
+        case BufferDataType::S16:
+        case BufferDataType::F16:
+            return 2;
+        case BufferDataType::U32:
+        case BufferDataType::S32:
+        case BufferDataType::F32:
+            return 4;
+        case BufferDataType::F64:
+        case BufferDataType::U64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+// ============================================================================
+// BufferArena
+// ============================================================================
+
+BufferArena::~BufferArena() {
+    Trim();
+}
+
+uint8_t* BufferArena::Allocate(size_t size, size_t& capacity) {
+    if (size > MAX_SIZE) return nullptr;
+    size_t size_class = MIN_CLASS;
+    while (size_class <= MAX_CLASS && ((size_t)1 << size_class) < size) {
+        size_class++;
+    }
+
+    if (size_class <= MAX_CLASS) {
+        capacity = (size_t)1 << size_class;
+        std::vector<uint8_t*>& pool = free_blocks[size_class];
+        if (!pool.empty()) {
+            uint8_t* block = pool.back();
+            pool.pop_back();
+            pooled_bytes -= capacity;
+            return block;
+        }
+    } else {
+        capacity = (size + 0xFFFF) & ~(size_t)0xFFFF;
+    }
+    return static_cast<uint8_t*>(::operator new(capacity, std::align_val_t(BLOCK_ALIGNMENT), std::nothrow));
+}
+
+void BufferArena::Release(uint8_t* block, size_t capacity) {
+    if (!block) return;
+
+    size_t size_class = MIN_CLASS;
+    while (size_class <= MAX_CLASS && ((size_t)1 << size_class) < capacity) {
+        size_class++;
+    }
+    bool pooled_class = size_class <= MAX_CLASS && ((size_t)1 << size_class) == capacity;
+    if (pooled_class && pooled_bytes + capacity <= MAX_POOLED_BYTES) {
+        free_blocks[size_class].push_back(block);
+        pooled_bytes += capacity;
+        return;
+    }
+    ::operator delete(block, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+void BufferArena::Trim() {
+    for (auto& pool : free_blocks) {
+        for (uint8_t* block : pool) {
+            ::operator delete(block, std::align_val_t(BLOCK_ALIGNMENT));
+        }
+        pool.clear();
+    }
+    pooled_bytes = 0;
+}
+
+// ============================================================================
+// Buffer
+// ============================================================================
+
+Buffer::Buffer(BufferArena& arena, BufferType type, size_t alignment)
+    : arena(arena), type(type) {
+    // GameMaker rounds the alignment up to a power of two, at most 1024
+    size_t a = std::min<size_t>(std::max<size_t>(alignment, 1), 1024);
+    this->alignment = 1;
+    while (this->alignment < a) this->alignment <<= 1;
+}
+
+Buffer::Buffer(BufferArena& arena, BufferType type, size_t size, size_t alignment)
+    : Buffer(arena, type, alignment) {
+    // A failed allocation leaves an empty buffer; BufferManager::Create rejects it
+    data = arena.Allocate(size, capacity);
+    if (!data) return;
+    std::memset(data, 0, size);
+    this->size = size;
+}
+
+Buffer::~Buffer() {
+    ReleaseStorage();
+}
+
+std::unique_ptr<Buffer> Buffer::Adopt(BufferArena& arena, IFileIO& io, void* data, size_t size) {
+    if (!data) return std::make_unique<Buffer>(arena, BufferType::Fixed, size, 1);
+    std::unique_ptr<Buffer> buffer(new Buffer(arena, BufferType::Fixed, 1));
+    buffer->storage = Storage::Adopted;
+    buffer->owner_io = &io;
+    buffer->data = static_cast<uint8_t*>(data);
+    buffer->size = buffer->capacity = buffer->used_size = size;
+    return buffer;
+}
+
+std::unique_ptr<Buffer> Buffer::CreateView(BufferArena& arena, void* data, size_t size) {
+    if (!data) return std::make_unique<Buffer>(arena, BufferType::Fixed, size, 1);
+    std::unique_ptr<Buffer> buffer(new Buffer(arena, BufferType::Fixed, 1));
+    buffer->storage = Storage::View;
+    buffer->data = static_cast<uint8_t*>(data);
+    buffer->size = buffer->capacity = buffer->used_size = size;
+    return buffer;
+}
+
+void Buffer::ReleaseStorage() {
+    switch (storage) {
+        case Storage::Arena: arena.Release(data, capacity); break;
+        case Storage::Adopted: owner_io->FreeFile(data); break;
+        case Storage::View: break;
+    }
+    data = nullptr;
+    capacity = 0;
+}
+
+BufferView Buffer::GetView(size_t offset, size_t length) const {
+    if (offset >= size) return BufferView();
+    return BufferView{ data + offset, std::min(length, size - offset) };
+}
+
+size_t Buffer::Seek(BufferSeek base, int64_t offset) {
+    int64_t target;
+    switch (base) {
+        case BufferSeek::Start: target = offset; break;
+        case BufferSeek::Relative: target = (int64_t)index + offset; break;
+        case BufferSeek::End: target = (int64_t)size - offset; break;
+        default: return index;
+    }
+    index = (size_t)std::min<int64_t>(std::max<int64_t>(target, 0), (int64_t)size);
+    return index;
+}
+
+bool Buffer::Resize(size_t new_size) {
+    if (storage == Storage::Arena && new_size <= capacity) {
+        if (new_size > size) std::memset(data + size, 0, new_size - size);
+    } else {
+        size_t new_capacity;
+        uint8_t* block = arena.Allocate(new_size, new_capacity);
+        if (!block) return false;
+        size_t keep = std::min(size, new_size);
+        std::memcpy(block, data, keep);
+        std::memset(block + keep, 0, new_size - keep);
+        ReleaseStorage();
+        storage = Storage::Arena;
+        owner_io = nullptr;
+        data = block;
+        capacity = new_capacity;
+    }
+    size = new_size;
+    index = std::min(index, size);
+    used_size = std::min(used_size, size);
+    return true;
+}
+
+bool Buffer::PrepareAccess(size_t length, bool writing) {
+    index = AlignedIndex();
+    if (type == BufferType::Wrap && size > 0) {
+        while (index >= size) {
+            align_offset = (align_offset + size) % alignment;
+            index -= size;
+        }
+    }
+    if (index + length <= size) return true;
+
+    if (writing && type == BufferType::Grow) {
+        // Doubling stops at the arena limit rather than overshooting it
+        if (length > BufferArena::MAX_SIZE || index > BufferArena::MAX_SIZE - length) return false;
+        size_t new_size = std::max<size_t>(size, 4);
+        while (index + length > new_size) new_size <<= 1;
+        return Resize(std::min(new_size, BufferArena::MAX_SIZE));
+    }
+    // Wrap buffers split the access at the end; everything else is out of room
+    return type == BufferType::Wrap && size > 0;
+}
+
+void Buffer::WrapCopyIn(const void* src, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(src);
+    while (length > 0) {
+        size_t chunk = std::min(length, size - index);
+        std::memcpy(data + index, bytes, chunk);
+        bytes += chunk;
+        length -= chunk;
+        index += chunk;
+        used_size = std::max(used_size, index);
+        if (index == size) {
+            align_offset = (align_offset + size) % alignment;
+            index = 0;
+        }
+    }
+}
+
+void Buffer::WrapCopyOut(void* dst, size_t length) {
+    uint8_t* bytes = static_cast<uint8_t*>(dst);
+    while (length > 0) {
+        size_t chunk = std::min(length, size - index);
+        std::memcpy(bytes, data + index, chunk);
+        bytes += chunk;
+        length -= chunk;
+        index += chunk;
+        if (index == size) {
+            align_offset = (align_offset + size) % alignment;
+            index = 0;
+        }
+    }
+}
+
+BufferResult Buffer::WriteBytesSlow(const void* src, size_t length) {
+    if (!PrepareAccess(length, true)) return BufferResult::OutOfSpace;
+    if (index + length > size) {
+        WrapCopyIn(src, length);
+        return BufferResult::Ok;
+    }
+    if (length > 0) std::memcpy(data + index, src, length);
+    index += length;
+    used_size = std::max(used_size, index);
+    return BufferResult::Ok;
+}
+
+bool Buffer::ReadBytesSlow(void* dst, size_t length) {
+    if (!PrepareAccess(length, false)) return false;
+    if (index + length > size) {
+        WrapCopyOut(dst, length);
+        return true;
+    }
+    if (length > 0) std::memcpy(dst, data + index, length);
+    index += length;
+    return true;
+}
+
+BufferResult Buffer::WriteBytes(const void* src, size_t length) {
+    size_t pos = AlignedIndex();
+    if (pos + length > size) return WriteBytesSlow(src, length);
+    if (length > 0) std::memcpy(data + pos, src, length);
+    index = pos + length;
+    if (index > used_size) used_size = index;
+    return BufferResult::Ok;
+}
+
+bool Buffer::ReadBytes(void* dst, size_t length) {
+    size_t pos = AlignedIndex();
+    if (pos + length > size) return ReadBytesSlow(dst, length);
+    if (length > 0) std::memcpy(dst, data + pos, length);
+    index = pos + length;
+    return true;
+}
+
+BufferResult Buffer::WriteString(const std::string& str, bool terminate) {
+    // The terminator goes in the same access so a string never half-fits
+    size_t length = str.size() + (terminate ? 1 : 0);
+    if (!PrepareAccess(length, true)) return BufferResult::OutOfSpace;
+    if (index + length > size) {
+        WrapCopyIn(str.data(), str.size());
+        if (terminate) WrapCopyIn("", 1);
+        return BufferResult::Ok;
+    }
+    std::memcpy(data + index, str.c_str(), length);
+    index += length;
+    used_size = std::max(used_size, index);
+    return BufferResult::Ok;
+}
+
+bool Buffer::ReadString(std::string& out) {
+    index = AlignedIndex();
+    if (type == BufferType::Wrap && size > 0) {
+        while (index >= size) {
+            align_offset = (align_offset + size) % alignment;
+            index -= size;
+        }
+    }
+    out.clear();
+    if (index >= size) return false;
+
+    // Strings end at a NUL or at the used size; bytes are already UTF-8
+    size_t end = std::min(used_size, size);
+    if (index >= end) return true;
+    const uint8_t* start = data + index;
+    const void* nul = std::memchr(start, 0, end - index);
+    size_t length = nul ? (size_t)(static_cast<const uint8_t*>(nul) - start) : end - index;
+    out.assign(reinterpret_cast<const char*>(start), length);
+    index += length + (nul ? 1 : 0);
+    return true;
+}
+
+BufferResult Buffer::WriteValue(BufferDataType type, const Value& val) {
+    switch (type) {
+        case BufferDataType::Bool: return Write<uint8_t>(val.AsBool() ? 1 : 0);
+        case BufferDataType::U8:
+        case BufferDataType::S8: return Write<uint8_t>((uint8_t)ToInt64(val.AsReal()));
+        case BufferDataType::U16:
+        case BufferDataType::S16: return Write<uint16_t>((uint16_t)ToInt64(val.AsReal()));
+        case BufferDataType::F16: return Write<uint16_t>(FloatToHalf((float)val.AsReal()));
+        case BufferDataType::U32:
+        case BufferDataType::S32: return Write<uint32_t>((uint32_t)ToInt64(val.AsReal()));
+        case BufferDataType::F32: return Write<float>((float)val.AsReal());
+        case BufferDataType::F64: return Write<double>(val.AsReal());
+        case BufferDataType::U64: return Write<uint64_t>(ToUInt64(val.AsReal()));
+        case BufferDataType::String:
+        case BufferDataType::Text:
+            if (val.IsString()) return WriteString(val.GetStringRef(), type == BufferDataType::String);
+            return WriteString(val.AsString(), type == BufferDataType::String);
+        default:
+            return BufferResult::InvalidType;
+    }
+}
+
+Value Buffer::ReadValue(BufferDataType type) {
+    if (IsStringType(type)) {
+        std::string str;
+        ReadString(str);
+        return Value(str);
+    }
+    size_t length = BufferSizeOf(type);
+    if (length == 0) return Value((double)(int)BufferResult::InvalidType);
+
+    uint8_t bytes[8];
+    if (!ReadBytes(bytes, length)) return Value((double)(int)BufferResult::OutOfBounds);
+    return DecodeScalar(type, bytes);
+}
+
+int64_t Buffer::ResolveOffset(int64_t offset, size_t length) const {
+    if (offset < 0 || size == 0) return -1;
+    if (type == BufferType::Wrap) return (int64_t)WrapOffset(offset, size);
+    if ((uint64_t)offset + length > size) return -1;
+    return offset;
+}
+
+Value Buffer::Peek(BufferDataType type, int64_t offset) const {
+    if (IsStringType(type)) {
+        int64_t pos = ResolveOffset(offset, 0);
+        size_t end = std::min(used_size, size);
+        if (pos < 0 || (size_t)pos >= end) return Value(std::string());
+        const uint8_t* start = data + pos;
+        const void* nul = std::memchr(start, 0, end - (size_t)pos);
+        size_t length = nul ? (size_t)(static_cast<const uint8_t*>(nul) - start) : end - (size_t)pos;
+        return Value(std::string(reinterpret_cast<const char*>(start), length));
+    }
+
+    size_t length = BufferSizeOf(type);
+    int64_t pos = ResolveOffset(offset, length);
+    if (length == 0 || pos < 0) return Value();
+
+    uint8_t bytes[8];
+    for (size_t i = 0; i < length; i++) {
+        bytes[i] = data[((size_t)pos + i) % size];
+    }
+    return DecodeScalar(type, bytes);
+}
+
+BufferResult Buffer::Poke(BufferDataType type, int64_t offset, const Value& val) {
+    uint8_t scalar[8];
+    std::string str;
+    const uint8_t* bytes = scalar;
+    size_t length;
+    if (IsStringType(type)) {
+        str = val.AsString();
+        length = str.size() + (type == BufferDataType::String ? 1 : 0);
+        bytes = reinterpret_cast<const uint8_t*>(str.c_str());
+    } else {
+        length = EncodeScalar(type, val, scalar);
+        if (length == 0) return BufferResult::InvalidType;
+    }
+
+    int64_t pos = ResolveOffset(offset, length);
+    if (pos < 0) return BufferResult::OutOfBounds;
+    for (size_t i = 0; i < length; i++) {
+        data[((size_t)pos + i) % size] = bytes[i];
+    }
+    used_size = std::max(used_size, std::min((size_t)pos + length, size));
+    return BufferResult::Ok;
+}
+
+BufferResult Buffer::Fill(int64_t offset, BufferDataType type, const Value& val, int64_t length) {
+    uint8_t scalar[8];
+    std::string str;
+    const uint8_t* bytes = scalar;
+    size_t element;
+    if (IsStringType(type)) {
+        str = val.AsString();
+        element = str.size() + (type == BufferDataType::String ? 1 : 0);
+        bytes = reinterpret_cast<const uint8_t*>(str.c_str());
+    } else {
+        element = EncodeScalar(type, val, scalar);
+    }
+    if (element == 0) return BufferResult::InvalidType;
+
+    // start + length saturates instead of overflowing
+    int64_t start_pos = std::max<int64_t>(offset, 0);
+    size_t start = (size_t)start_pos;
+    size_t end = start + (size_t)std::min(std::max<int64_t>(length, 0), std::numeric_limits<int64_t>::max() - start_pos);
+    if (end > size) {
+        if (this->type == BufferType::Grow && !Resize(end)) return BufferResult::OutOfSpace;
+        end = std::min(end, size);
+    }
+    if (start >= end) return BufferResult::Ok;
+
+    // Elements sit on aligned offsets; the padding between them is zeroed
+    size_t stride = (element + alignment - 1) & ~(alignment - 1);
+    size_t first = (start + alignment - 1) & ~(alignment - 1);
+    if (first + element > end) return BufferResult::Ok;
+    size_t count = (end - first - element) / stride + 1;
+
+    if (stride > element) std::memset(data + start, 0, end - start);
+    std::memcpy(data + first, bytes, element);
+    // Double the filled run until it covers every element
+    size_t filled = 1;
+    while (filled < count) {
+        size_t batch = std::min(filled, count - filled);
+        std::memcpy(data + first + filled * stride, data + first, (batch - 1) * stride + element);
+        filled += batch;
+    }
+    used_size = std::max(used_size, first + (count - 1) * stride + element);
+    return BufferResult::Ok;
+}
+
+BufferResult Buffer::CopyTo(Buffer& dest, int64_t src_offset, int64_t length, int64_t dest_offset) const {
+    if (size == 0) return BufferResult::OutOfBounds;
+
+    // Clamp (or wrap) the source range
+    bool src_wrap = type == BufferType::Wrap;
+    size_t copy_size = length < 0 ? size : (size_t)length;
+    size_t src_pos;
+    if (src_wrap) {
+        src_pos = WrapOffset(src_offset, size);
+        copy_size = std::min(copy_size, size);
+        if (src_pos + copy_size <= size) src_wrap = false;
+    } else {
+        src_pos = (size_t)std::min<int64_t>(std::max<int64_t>(src_offset, 0), (int64_t)size - 1);
+        copy_size = std::min(copy_size, size - src_pos);
+    }
+
+    // Clamp, wrap or grow the destination range; only grow buffers can start empty
+    bool grow = dest.type == BufferType::Grow;
+    bool dest_wrap = dest.type == BufferType::Wrap;
+    if (!grow && dest.size == 0) return BufferResult::OutOfBounds;
+    size_t dest_pos;
+    if (grow) {
+        dest_pos = (size_t)std::max<int64_t>(dest_offset, 0);
+        if (copy_size > std::numeric_limits<size_t>::max() - dest_pos) return BufferResult::OutOfSpace;
+        if (dest_pos + copy_size > dest.size && !dest.Resize(dest_pos + copy_size)) return BufferResult::OutOfSpace;
+        dest_wrap = false;
+    } else if (dest_wrap) {
+        dest_pos = WrapOffset(dest_offset, dest.size);
+        if (dest_pos + copy_size <= dest.size) dest_wrap = false;
+    } else {
+        dest_pos = (size_t)std::min<int64_t>(std::max<int64_t>(dest_offset, 0), (int64_t)dest.size - 1);
+        copy_size = std::min(copy_size, dest.size - dest_pos);
+    }
+
+    if (!src_wrap && !dest_wrap) {
+        // memmove: source and destination may be the same buffer
+        std::memmove(dest.data + dest_pos, data + src_pos, copy_size);
+        dest.used_size = std::max(dest.used_size, dest_pos + copy_size);
+        return BufferResult::Ok;
+    }
+
+    while (copy_size > 0) {
+        size_t chunk = std::min(copy_size, dest.size - dest_pos);
+        chunk = std::min(chunk, size - src_pos);
+        std::memmove(dest.data + dest_pos, data + src_pos, chunk);
+        dest.used_size = std::max(dest.used_size, dest_pos + chunk);
+        dest_pos = (dest_pos + chunk) % dest.size;
+        src_pos = (src_pos + chunk) % size;
+        copy_size -= chunk;
+    }
+    return BufferResult::Ok;
+}
+
+// ============================================================================
+// BufferManager
+// ============================================================================
+
+int64_t BufferManager::Create(BufferType type, size_t size, size_t alignment) {
+    auto buffer = std::make_unique<Buffer>(arena, type, size, alignment);
+    if (buffer->GetSize() != size) return -1;
+    return buffers.Create(std::move(buffer));
+}
+
+int64_t BufferManager::Load(const std::string& path) {
+    if (!file_io) return -1;
+    void* data = nullptr;
+    size_t size = 0;
+    if (!file_io->LoadFile(path.c_str(), data, size)) return -1;
+    return buffers.Create(Buffer::Adopt(arena, *file_io, data, size));
+}
+
+// ============================================================================
+// GML built-ins
+// ============================================================================
+
+namespace {
+
+using Args = std::vector<Value>;
+
+const Value& Arg(const Args& args, size_t i) {
+    static const Value undefined;
+    return i < args.size() ? args[i] : undefined;
+}
+
+int64_t ArgInt(const Args& args, size_t i) {
+    return ToInt64(Arg(args, i).AsReal());
+}
+
+Value Result(BufferResult result) {
+    return Value((double)(int)result);
+}
+
+// Wraps fn so it only runs with a live buffer resolved from args[0]
+template <typename Fn>
+VirtualMachine::BuiltInFunction Resolve(HandleTable<Buffer>& table, Value missing, Fn fn) {
+    return [&table, missing, fn](const Args& args) -> Value {
+        Buffer* buffer = table.Get(ArgInt(args, 0));
+        if (!buffer) return missing;
+        return fn(*buffer, args);
+    };
+}
+
+// Same, also validating a buffer_* data type argument
+template <typename Fn>
+VirtualMachine::BuiltInFunction ResolveTyped(HandleTable<Buffer>& table, size_t type_arg, Value missing, Fn fn) {
+    return Resolve(table, missing, [type_arg, fn](Buffer& buffer, const Args& args) -> Value {
+        int64_t type = ArgInt(args, type_arg);
+        if (!IsValidType((int)type)) return Result(BufferResult::InvalidType);
+        return fn(buffer, (BufferDataType)type, args);
+    });
+}
+
+} // namespace
+
+void RegisterBufferBuiltins(VirtualMachine& vm, BufferManager& manager) {
+    HandleTable<Buffer>& buffers = manager.GetBuffers();
+    const Value unknown = Result(BufferResult::UnknownBuffer);
+
+    vm.RegisterBuiltIn("buffer_create", [&manager](const Args& args) {
+        int64_t size = std::max<int64_t>(ArgInt(args, 0), 0);
+        int64_t type = ArgInt(args, 1);
+        if (type < (int64_t)BufferType::Fixed || type > (int64_t)BufferType::Fast) return Value(-1.0);
+        int64_t alignment = std::max<int64_t>(ArgInt(args, 2), 1);
+        return Value((double)manager.Create((BufferType)type, (size_t)size, (size_t)alignment));
+    });
+    vm.RegisterBuiltIn("buffer_delete", [&buffers](const Args& args) {
+        return Result(buffers.Destroy(ArgInt(args, 0)) ? BufferResult::Ok : BufferResult::UnknownBuffer);
+    });
+    vm.RegisterBuiltIn("buffer_exists", [&buffers](const Args& args) {
+        return Value(buffers.Exists(ArgInt(args, 0)));
+    });
+    vm.RegisterBuiltIn("buffer_sizeof", [](const Args& args) {
+        int64_t type = ArgInt(args, 0);
+        return Value(IsValidType((int)type) ? (double)BufferSizeOf((BufferDataType)type) : 0.0);
+    });
+
+    vm.RegisterBuiltIn("buffer_write", ResolveTyped(buffers, 1, unknown, [](Buffer& b, BufferDataType type, const Args& args) {
+        return Result(b.WriteValue(type, Arg(args, 2)));
+    }));
+    vm.RegisterBuiltIn("buffer_read", ResolveTyped(buffers, 1, Value(0.0), [](Buffer& b, BufferDataType type, const Args&) {
+        return b.ReadValue(type);
+    }));
+    vm.RegisterBuiltIn("buffer_peek", ResolveTyped(buffers, 2, Value(0.0), [](Buffer& b, BufferDataType type, const Args& args) {
+        return b.Peek(type, ArgInt(args, 1));
+    }));
+    vm.RegisterBuiltIn("buffer_poke", ResolveTyped(buffers, 2, Value(0.0), [](Buffer& b, BufferDataType type, const Args& args) {
+        return Result(b.Poke(type, ArgInt(args, 1), Arg(args, 3)));
+    }));
+    vm.RegisterBuiltIn("buffer_fill", ResolveTyped(buffers, 2, unknown, [](Buffer& b, BufferDataType type, const Args& args) {
+        return Result(b.Fill(ArgInt(args, 1), type, Arg(args, 3), ArgInt(args, 4)));
+    }));
+
+    vm.RegisterBuiltIn("buffer_seek", Resolve(buffers, Value(0.0), [](Buffer& b, const Args& args) {
+        return Value((double)b.Seek((BufferSeek)ArgInt(args, 1), ArgInt(args, 2)));
+    }));
+    vm.RegisterBuiltIn("buffer_tell", Resolve(buffers, unknown, [](Buffer& b, const Args&) {
+        return Value((double)b.Tell());
+    }));
+    vm.RegisterBuiltIn("buffer_get_size", Resolve(buffers, unknown, [](Buffer& b, const Args&) {
+        return Value((double)b.GetSize());
+    }));
+    vm.RegisterBuiltIn("buffer_get_type", Resolve(buffers, unknown, [](Buffer& b, const Args&) {
+        return Value((double)(int)b.GetType());
+    }));
+    vm.RegisterBuiltIn("buffer_get_alignment", Resolve(buffers, unknown, [](Buffer& b, const Args&) {
+        return Value((double)b.GetAlignment());
+    }));
+    vm.RegisterBuiltIn("buffer_resize", Resolve(buffers, unknown, [](Buffer& b, const Args& args) {
+        bool resized = b.Resize((size_t)std::max<int64_t>(ArgInt(args, 1), 0));
+        return Result(resized ? BufferResult::Ok : BufferResult::OutOfSpace);
+    }));
+
+    vm.RegisterBuiltIn("buffer_copy", [&buffers](const Args& args) {
+        Buffer* src = buffers.Get(ArgInt(args, 0));
+        Buffer* dest = buffers.Get(ArgInt(args, 3));
+        if (!src || !dest) return Result(BufferResult::UnknownBuffer);
+        return Result(src->CopyTo(*dest, ArgInt(args, 1), ArgInt(args, 2), ArgInt(args, 4)));
+    });
+
+    vm.RegisterBuiltIn("buffer_save", Resolve(buffers, unknown, [&manager](Buffer& b, const Args& args) {
+        IFileIO* io = manager.GetFileIO();
+        if (!io) return Result(BufferResult::GeneralError);
+        std::string path = Arg(args, 1).AsString();
+        return Result(io->SaveFile(path.c_str(), b.GetData(), b.GetSize()) ? BufferResult::Ok : BufferResult::GeneralError);
+    }));
+    vm.RegisterBuiltIn("buffer_save_ext", Resolve(buffers, unknown, [&manager](Buffer& b, const Args& args) {
+        IFileIO* io = manager.GetFileIO();
+        if (!io) return Result(BufferResult::GeneralError);
+        std::string path = Arg(args, 1).AsString();
+        BufferView view = b.GetView((size_t)std::max<int64_t>(ArgInt(args, 2), 0),
+                                    (size_t)std::max<int64_t>(ArgInt(args, 3), 0));
+        return Result(io->SaveFile(path.c_str(), view.data, view.size) ? BufferResult::Ok : BufferResult::GeneralError);
+    }));
+    vm.RegisterBuiltIn("buffer_load", [&manager](const Args& args) {
+        return Value((double)manager.Load(Arg(args, 0).AsString()));
+    });
+    vm.RegisterBuiltIn("buffer_load_ext", Resolve(buffers, unknown, [&manager](Buffer& b, const Args& args) {
+        IFileIO* io = manager.GetFileIO();
+        if (!io) return Result(BufferResult::GeneralError);
+        std::string path = Arg(args, 1).AsString();
+        void* data = nullptr;
+        size_t size = 0;
+        if (!io->LoadFile(path.c_str(), data, size)) return Result(BufferResult::GeneralError);
+        // Copy straight from the loaded memory into the target buffer
+        BufferResult result = BufferResult::Ok;
+        if (data && size > 0) {
+            std::unique_ptr<Buffer> file = Buffer::CreateView(manager.GetArena(), data, size);
+            result = file->CopyTo(b, 0, (int64_t)size, ArgInt(args, 2));
+        }
+        io->FreeFile(data);
+        return Result(result);
+    }));
+}
+
+} // namespace GM
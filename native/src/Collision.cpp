@@ -0,0 +1,220 @@
+#include "../include/Collision.h"
+#include "../include/Managers.h"
+#include "../include/Object.h"
+#include "../include/Room.h"
+#include "../include/Sprite.h"
+#include "../include/VM_Executor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GM {
+namespace Collision {
+
+static bool MatchesObject(const Instance* inst, int32_t object) {
+    if (object == OBJECT_ALL) return true;
+    for (const Object* obj = inst->GetObject(); obj; obj = obj->GetParent().get()) {
+        if ((int32_t)obj->GetID() == object) return true;
+    }
+    return false;
+}
+
+// The precise mask inst's current frame collides with at (x, y), if its
+// collision sprite (mask_index, else sprite_index) is precise
+static bool GetPreciseMask(const Instance* inst, double x, double y, MaskPlacement& out) {
+    uint32_t sprite_id = inst->GetCollisionSpriteIndex();
+    if (sprite_id == 0) return false;
+    auto sprite = GameGlobals::Get().GetSpriteManager().GetSprite(sprite_id);
+    if (!sprite || sprite->GetCollisionType() != SpriteCollisionType::Precise) return false;
+    out.mask = sprite->GetMask((uint32_t)std::max(0.0, inst->GetImageIndex()));
+    if (!out.mask) return false;
+    out.x = x;
+    out.y = y;
+    out.xorigin = sprite->GetXOrigin();
+    out.yorigin = sprite->GetYOrigin();
+    out.xscale = inst->GetImageXScale();
+    out.yscale = inst->GetImageYScale();
+    out.angle = inst->GetImageAngle();
+    return true;
+}
+
+// Narrow phase for two instances whose bboxes overlap, a placed at (ax, ay)
+// with the bbox a_box there; b where it stands
+static bool InstancesTouch(const Instance* a, double ax, double ay, const Rect& a_box, const Instance* b) {
+    MaskPlacement pa, pb;
+    bool a_precise = GetPreciseMask(a, ax, ay, pa);
+    bool b_precise = GetPreciseMask(b, b->GetX(), b->GetY(), pb);
+    if (a_precise && b_precise) return MasksOverlap(pa, pb);
+    if (a_precise) return MaskOverlapsRect(pa, b->GetBBox());
+    if (b_precise) return MaskOverlapsRect(pb, a_box);
+    return true;
+}
+
+// First candidate under area that passes test(box), the object filter and
+// exact(instance); the broadphase box test runs before any lookups
+template <typename Test, typename Exact>
+static InstanceHandle FindFirst(Room& room, const Rect& area, int32_t object, InstanceHandle notme,
+                                Test&& test, Exact&& exact) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    InstanceHandle found = INVALID_INSTANCE;
+    room.QueryCollision(area, [&](InstanceHandle owner, const Rect& box) {
+        if (owner == notme || !test(box)) return true;
+        Instance* other = manager.Get(owner);
+        if (!other || !other->GetActive() || other->IsMarked() || !MatchesObject(other, object)) return true;
+        if (!exact(other)) return true;
+        found = owner;
+        return false;
+    });
+    return found;
+}
+
+static bool AnyInstance(const Instance*) {
+    return true;
+}
+
+// Closed query shape against a half-open bbox
+static bool RectTouchesBox(const Rect& r, const Rect& box) {
+    return box.x1 <= r.x2 && r.x1 < box.x2 && box.y1 <= r.y2 && r.y1 < box.y2;
+}
+
+InstanceHandle InstancePlace(Room& room, Instance* inst, double x, double y, int32_t object) {
+    if (!inst) return INVALID_INSTANCE;
+    room.SyncCollision();
+    Rect area = inst->GetBBox();
+    double dx = x - inst->GetX(), dy = y - inst->GetY();
+    area.x1 += dx;
+    area.x2 += dx;
+    area.y1 += dy;
+    area.y2 += dy;
+    return FindFirst(room, area, object, inst->GetHandle(),
+        [&](const Rect& box) { return BoxOverlaps(area, box); },
+        [&](const Instance* other) { return InstancesTouch(inst, x, y, area, other); });
+}
+
+bool PlaceMeeting(Room& room, Instance* inst, double x, double y, int32_t object) {
+    return InstancePlace(room, inst, x, y, object) != INVALID_INSTANCE;
+}
+
+InstanceHandle Point(Room& room, double x, double y, int32_t object, bool precise, InstanceHandle notme) {
+    Rect area = { x, y, x, y };
+    return FindFirst(room, area, object, notme,
+        [&](const Rect& box) { return RectTouchesBox(area, box); },
+        [&](const Instance* other) {
+            MaskPlacement p;
+            return !precise || !GetPreciseMask(other, other->GetX(), other->GetY(), p) || MaskContainsPoint(p, x, y);
+        });
+}
+
+InstanceHandle Rectangle(Room& room, double x1, double y1, double x2, double y2, int32_t object,
+                         bool precise, InstanceHandle notme) {
+    Rect area = { std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2) };
+    return FindFirst(room, area, object, notme,
+        [&](const Rect& box) { return RectTouchesBox(area, box); },
+        [&](const Instance* other) {
+            MaskPlacement p;
+            return !precise || !GetPreciseMask(other, other->GetX(), other->GetY(), p) || MaskOverlapsRect(p, area);
+        });
+}
+
+InstanceHandle Circle(Room& room, double x, double y, double radius, int32_t object, InstanceHandle notme) {
+    radius = std::abs(radius);
+    Rect area = { x - radius, y - radius, x + radius, y + radius };
+    return FindFirst(room, area, object, notme, [&](const Rect& box) {
+        double nx = std::clamp(x, box.x1, box.x2) - x;
+        double ny = std::clamp(y, box.y1, box.y2) - y;
+        return nx * nx + ny * ny <= radius * radius;
+    }, AnyInstance);
+}
+
+InstanceHandle Line(Room& room, double x1, double y1, double x2, double y2, int32_t object, InstanceHandle notme) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    InstanceHandle nearest = INVALID_INSTANCE;
+    room.RayCastCollision(x1, y1, x2, y2, [&](InstanceHandle owner, const Rect&, double t) {
+        if (owner == notme) return 1.0;
+        Instance* other = manager.Get(owner);
+        if (!other || !other->GetActive() || other->IsMarked() || !MatchesObject(other, object)) return 1.0;
+        nearest = owner;
+        return t;  // Only nearer hits from here on
+    });
+    return nearest;
+}
+
+void DispatchEvents(Room& room) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    std::vector<InstanceHandle> hits;
+
+    // Only instances with collision events, in instance order
+    auto& subscribers = room.GetSubscribers(Room::EventList::Collision);
+    for (size_t i = 0; i < subscribers.size(); i++) {
+        Instance* inst = manager.Get(subscribers[i].handle);
+        if (!inst || !inst->GetActive() || inst->IsMarked() || !inst->GetObject()) continue;
+
+        // Indexed: an event may register more callbacks on the object
+        const std::vector<int>& targets = inst->GetObject()->GetCollisionTargets();
+        for (size_t t = 0; t < targets.size(); t++) {
+            int target = targets[t];
+            hits.clear();
+            room.SyncCollision();
+            const Rect area = inst->GetBBox();
+            room.QueryCollision(area, [&](InstanceHandle owner, const Rect& box) {
+                if (owner != inst->GetHandle() && BoxOverlaps(area, box)) hits.push_back(owner);
+                return true;
+            });
+
+            for (InstanceHandle handle : hits) {
+                Instance* other = manager.Get(handle);
+                if (!other || !other->GetActive() || other->IsMarked() || !MatchesObject(other, target)) continue;
+                if (inst->IsMarked()) break;
+                if (!InstancesTouch(inst, inst->GetX(), inst->GetY(), inst->GetBBox(), other)) continue;
+                inst->SetOther(handle);
+                inst->TriggerEvent(EventType::Collision, target);
+            }
+            inst->SetOther(INVALID_INSTANCE);
+        }
+    }
+}
+
+} // namespace Collision
+
+void RegisterCollisionBuiltins(VirtualMachine& vm, RoomManager& rooms) {
+    using Args = std::vector<Value>;
+    auto arg = [](const Args& args, size_t i) { return i < args.size() ? args[i].AsReal() : 0.0; };
+    auto result = [](InstanceHandle handle) {
+        return Value(handle == INVALID_INSTANCE ? Collision::NOONE : (double)handle);
+    };
+    // The object argument truncated like GML; false for NaN and reals outside int32,
+    // which name no object
+    auto object_arg = [arg](const Args& args, size_t i, int32_t& out) {
+        double v = arg(args, i);
+        if (!(v > -2147483649.0 && v < 2147483648.0)) return false;
+        out = (int32_t)v;
+        return true;
+    };
+
+    vm.RegisterBuiltIn("collision_point", [&rooms, arg, result, object_arg](const Args& args) {
+        auto room = rooms.GetCurrentRoom();
+        int32_t object;
+        if (!room || !object_arg(args, 2, object)) return result(INVALID_INSTANCE);
+        return result(Collision::Point(*room, arg(args, 0), arg(args, 1), object, arg(args, 3) != 0));
+    });
+    vm.RegisterBuiltIn("collision_rectangle", [&rooms, arg, result, object_arg](const Args& args) {
+        auto room = rooms.GetCurrentRoom();
+        int32_t object;
+        if (!room || !object_arg(args, 4, object)) return result(INVALID_INSTANCE);
+        return result(Collision::Rectangle(*room, arg(args, 0), arg(args, 1), arg(args, 2), arg(args, 3), object,
+                                           arg(args, 5) != 0));
+    });
+    vm.RegisterBuiltIn("collision_line", [&rooms, arg, result, object_arg](const Args& args) {
+        auto room = rooms.GetCurrentRoom();
+        int32_t object;
+        if (!room || !object_arg(args, 4, object)) return result(INVALID_INSTANCE);
+        return result(Collision::Line(*room, arg(args, 0), arg(args, 1), arg(args, 2), arg(args, 3), object));
+    });
+    vm.RegisterBuiltIn("collision_circle", [&rooms, arg, result, object_arg](const Args& args) {
+        auto room = rooms.GetCurrentRoom();
+        int32_t object;
+        if (!room || !object_arg(args, 3, object)) return result(INVALID_INSTANCE);
+        return result(Collision::Circle(*room, arg(args, 0), arg(args, 1), arg(args, 2), object));
+    });
+}
+
+} // namespace GM
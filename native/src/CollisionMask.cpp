@@ -0,0 +1,388 @@
+#include "../include/CollisionMask.h"
+#include "../include/SimdDispatch.h"
+#include <algorithm>
+#include <cmath>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace GM {
+
+// ============================================================================
+// Mask storage
+// ============================================================================
+
+CollisionMask::CollisionMask(uint32_t width, uint32_t height)
+    : width(width), height(height), stride((width + 63) / 64 + 1),
+      bits((size_t)height * stride, 0) {
+    UpdateBounds();
+}
+
+CollisionMask CollisionMask::FromRGBA(const uint8_t* pixels, uint32_t width, uint32_t height,
+                                      uint32_t pitch, uint8_t tolerance) {
+    CollisionMask mask(width, height);
+    if (!pixels) return mask;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = pixels + (size_t)y * pitch;
+        uint64_t* row = mask.bits.data() + (size_t)y * mask.stride;
+        for (uint32_t x = 0; x < width; x++) {
+            if (src[x * 4 + 3] > tolerance) {
+                row[x >> 6] |= 1ull << (x & 63);
+            }
+        }
+    }
+    mask.UpdateBounds();
+    return mask;
+}
+
+void CollisionMask::Set(uint32_t x, uint32_t y, bool solid) {
+    if (x >= width || y >= height) return;
+    uint64_t& word = bits[(size_t)y * stride + (x >> 6)];
+    uint64_t bit = 1ull << (x & 63);
+    word = solid ? (word | bit) : (word & ~bit);
+}
+
+void CollisionMask::UpdateBounds() {
+    uint32_t x1 = width, y1 = height, x2 = 0, y2 = 0;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint64_t* row = GetRow(y);
+        uint32_t words = stride - 1;
+        uint32_t first = 0;
+        while (first < words && row[first] == 0) first++;
+        if (first == words) continue;
+        uint32_t last = words - 1;
+        while (row[last] == 0) last--;
+
+        uint32_t lo = 0, hi = 63;
+        while (!((row[first] >> lo) & 1)) lo++;
+        while (!((row[last] >> hi) & 1)) hi--;
+        x1 = std::min(x1, first * 64 + lo);
+        x2 = std::max(x2, last * 64 + hi + 1);
+        y1 = std::min(y1, y);
+        y2 = y + 1;
+    }
+    if (x2 == 0) {
+        bounds = {};
+    } else {
+        bounds = { (double)x1, (double)y1, (double)x2, (double)y2 };
+    }
+}
+
+// ============================================================================
+// Placement
+// ============================================================================
+
+namespace {
+
+// Exact for multiples of 90 degrees, so quarter turns sample cleanly
+void AngleVector(double degrees, double& c, double& s) {
+    if (degrees == 0) { c = 1; s = 0; return; }
+    double a = std::fmod(degrees, 360.0);
+    if (a < 0) a += 360.0;
+    if (a == 0) { c = 1; s = 0; }
+    else if (a == 90) { c = 0; s = 1; }
+    else if (a == 180) { c = -1; s = 0; }
+    else if (a == 270) { c = 0; s = -1; }
+    else {
+        double r = a * 3.14159265358979323846 / 180.0;
+        c = std::cos(r);
+        s = std::sin(r);
+    }
+}
+
+// Room pixels whose centers lie in [lo, hi) are [PixelStart(lo), PixelStart(hi))
+int64_t PixelStart(double edge) {
+    return (int64_t)std::ceil(std::clamp(edge, -1e15, 1e15) - 0.5);
+}
+
+// Last pixel whose center is <= edge, plus one
+int64_t PixelEndClosed(double edge) {
+    return (int64_t)std::floor(std::clamp(edge, -1e15, 1e15) - 0.5) + 1;
+}
+
+inline uint32_t CountTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctzll(mask);
+#endif
+}
+
+uint64_t LowBits(uint32_t n) {
+    return n >= 64 ? ~0ull : (1ull << n) - 1;
+}
+
+// Box around the four corners of box once scaled and rotated by (c, s)
+Rect TransformBox(const MaskPlacement& p, const Rect& box, double c, double s) {
+    Rect r = { 1e300, 1e300, -1e300, -1e300 };
+    for (double u : { box.x1, box.x2 }) {
+        for (double v : { box.y1, box.y2 }) {
+            double lx = (u - p.xorigin) * p.xscale, ly = (v - p.yorigin) * p.yscale;
+            double wx = p.x + c * lx + s * ly;
+            double wy = p.y - s * lx + c * ly;
+            r.x1 = std::min(r.x1, wx);
+            r.y1 = std::min(r.y1, wy);
+            r.x2 = std::max(r.x2, wx);
+            r.y2 = std::max(r.y2, wy);
+        }
+    }
+    return r;
+}
+
+// Reads placed mask pixels a room row at a time
+struct Sampler {
+    const CollisionMask* mask;
+    bool aligned;
+    int64_t ax, ay;  // Room pixel of mask pixel (0, 0) when aligned
+    double x, y, xorigin, yorigin, c, s, inv_xscale, inv_yscale;
+    Rect bounds;     // Room-space box around the solid pixels; empty if none
+
+    explicit Sampler(const MaskPlacement& p)
+        : mask(p.mask), x(p.x), y(p.y), xorigin(p.xorigin), yorigin(p.yorigin),
+          inv_xscale(1.0 / p.xscale), inv_yscale(1.0 / p.yscale) {
+        AngleVector(p.angle, c, s);
+        aligned = p.xscale == 1 && p.yscale == 1 && c == 1;
+        ax = PixelStart(x - xorigin);
+        ay = PixelStart(y - yorigin);
+        if (!mask || mask->IsEmpty() || p.xscale == 0 || p.yscale == 0) {
+            bounds = {};
+            return;
+        }
+
+        const Rect& b = mask->GetBounds();
+        if (aligned) {
+            bounds = { ax + b.x1, ay + b.y1, ax + b.x2, ay + b.y2 };
+            return;
+        }
+        bounds = TransformBox(p, b, c, s);
+    }
+
+    bool IsEmpty() const { return bounds.x2 <= bounds.x1; }
+
+    // n (<= 64) pixels of room row j from column i; bit k is pixel i + k
+    uint64_t Row(int64_t j, int64_t i, uint32_t n) const {
+        if (aligned) {
+            int64_t ly = j - ay, lx = i - ax;
+            if (ly >= 0 && ly < mask->GetHeight() && lx >= 0) {
+                if (lx >= mask->GetWidth()) return 0;
+                return mask->GetBits((uint32_t)ly, (uint32_t)lx) & LowBits(n);
+            }
+        }
+
+        // Step the inverse transform across the row from the first pixel center
+        double px = (double)i + 0.5 - x, py = (double)j + 0.5 - y;
+        double u = (c * px - s * py) * inv_xscale + xorigin;
+        double v = (s * px + c * py) * inv_yscale + yorigin;
+        double du = c * inv_xscale, dv = s * inv_yscale;
+        uint64_t word = 0;
+        for (uint32_t k = 0; k < n; k++) {
+            if (mask->Get((int32_t)std::floor(u), (int32_t)std::floor(v))) {
+                word |= 1ull << k;
+            }
+            u += du;
+            v += dv;
+        }
+        return word;
+    }
+
+    // Whether any of the pixels of room row j from column i picked out by
+    // wanted (bit k is pixel i + k) is solid, sampling only those pixels
+    bool Any(int64_t j, int64_t i, uint64_t wanted) const {
+        if (aligned) return (Row(j, i, 64) & wanted) != 0;
+
+        double px = (double)i + 0.5 - x, py = (double)j + 0.5 - y;
+        double u0 = (c * px - s * py) * inv_xscale + xorigin;
+        double v0 = (s * px + c * py) * inv_yscale + yorigin;
+        double du = c * inv_xscale, dv = s * inv_yscale;
+        while (wanted) {
+            uint32_t k = CountTrailingZeros(wanted);
+            if (mask->Get((int32_t)std::floor(u0 + du * k), (int32_t)std::floor(v0 + dv * k))) return true;
+            wanted &= wanted - 1;
+        }
+        return false;
+    }
+};
+
+// ============================================================================
+// Row kernels: AND count pixels of two mask rows starting at arbitrary bit
+// offsets. Reads may run one word past the last pixel, into the row padding.
+// ============================================================================
+
+inline uint64_t Extract(const uint64_t* row, uint32_t bit) {
+    uint32_t word = bit >> 6, shift = bit & 63;
+    if (shift == 0) return row[word];
+    return (row[word] >> shift) | (row[word + 1] << (64 - shift));
+}
+
+bool RowOverlapScalar(const uint64_t* a, uint32_t a_bit, const uint64_t* b, uint32_t b_bit,
+                      uint32_t chunk, uint32_t chunks) {
+    for (; chunk < chunks; chunk++) {
+        if (Extract(a, a_bit + chunk * 64) & Extract(b, b_bit + chunk * 64)) return true;
+    }
+    return false;
+}
+
+#if GM_SIMD_X86
+// Shift counts of 64 shift everything out, so unaligned and aligned rows
+// take the same path
+GM_TARGET_SSE2 bool RowOverlapSSE2(const uint64_t* a, uint32_t a_bit, const uint64_t* b, uint32_t b_bit,
+                                   uint32_t chunks) {
+    const uint64_t* pa = a + (a_bit >> 6);
+    const uint64_t* pb = b + (b_bit >> 6);
+    __m128i a_lo = _mm_cvtsi32_si128((int)(a_bit & 63)), a_hi = _mm_cvtsi32_si128(64 - (int)(a_bit & 63));
+    __m128i b_lo = _mm_cvtsi32_si128((int)(b_bit & 63)), b_hi = _mm_cvtsi32_si128(64 - (int)(b_bit & 63));
+    __m128i zero = _mm_setzero_si128();
+    uint32_t c = 0;
+    for (; c + 2 <= chunks; c += 2) {
+        __m128i wa = _mm_or_si128(_mm_srl_epi64(_mm_loadu_si128((const __m128i*)(pa + c)), a_lo),
+                                  _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(pa + c + 1)), a_hi));
+        __m128i wb = _mm_or_si128(_mm_srl_epi64(_mm_loadu_si128((const __m128i*)(pb + c)), b_lo),
+                                  _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(pb + c + 1)), b_hi));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(wa, wb), zero)) != 0xFFFF) return true;
+    }
+    return RowOverlapScalar(a, a_bit, b, b_bit, c, chunks);
+}
+
+GM_TARGET_AVX2 bool RowOverlapAVX2(const uint64_t* a, uint32_t a_bit, const uint64_t* b, uint32_t b_bit,
+                                   uint32_t chunks) {
+    const uint64_t* pa = a + (a_bit >> 6);
+    const uint64_t* pb = b + (b_bit >> 6);
+    __m128i a_lo = _mm_cvtsi32_si128((int)(a_bit & 63)), a_hi = _mm_cvtsi32_si128(64 - (int)(a_bit & 63));
+    __m128i b_lo = _mm_cvtsi32_si128((int)(b_bit & 63)), b_hi = _mm_cvtsi32_si128(64 - (int)(b_bit & 63));
+    uint32_t c = 0;
+    for (; c + 4 <= chunks; c += 4) {
+        __m256i wa = _mm256_or_si256(_mm256_srl_epi64(_mm256_loadu_si256((const __m256i*)(pa + c)), a_lo),
+                                     _mm256_sll_epi64(_mm256_loadu_si256((const __m256i*)(pa + c + 1)), a_hi));
+        __m256i wb = _mm256_or_si256(_mm256_srl_epi64(_mm256_loadu_si256((const __m256i*)(pb + c)), b_lo),
+                                     _mm256_sll_epi64(_mm256_loadu_si256((const __m256i*)(pb + c + 1)), b_hi));
+        if (!_mm256_testz_si256(wa, wb)) return true;
+    }
+    if (c + 2 <= chunks) {
+        __m128i wa = _mm_or_si128(_mm_srl_epi64(_mm_loadu_si128((const __m128i*)(pa + c)), a_lo),
+                                  _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(pa + c + 1)), a_hi));
+        __m128i wb = _mm_or_si128(_mm_srl_epi64(_mm_loadu_si128((const __m128i*)(pb + c)), b_lo),
+                                  _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(pb + c + 1)), b_hi));
+        if (!_mm_testz_si128(wa, wb)) return true;
+        c += 2;
+    }
+    return RowOverlapScalar(a, a_bit, b, b_bit, c, chunks);
+}
+#endif
+
+bool RowOverlapScalarAll(const uint64_t* a, uint32_t a_bit, const uint64_t* b, uint32_t b_bit, uint32_t chunks) {
+    return RowOverlapScalar(a, a_bit, b, b_bit, 0, chunks);
+}
+
+using RowKernel = bool (*)(const uint64_t*, uint32_t, const uint64_t*, uint32_t, uint32_t);
+
+RowKernel SelectRowKernel() {
+#if GM_SIMD_X86
+    switch (GetSimdLevel()) {
+    case SimdLevel::AVX2: return RowOverlapAVX2;
+    case SimdLevel::SSE2: return RowOverlapSSE2;
+    default: break;
+    }
+#endif
+    return RowOverlapScalarAll;
+}
+
+} // namespace
+
+bool MaskPlacement::IsAxisAligned() const {
+    double c, s;
+    AngleVector(angle, c, s);
+    return xscale == 1 && yscale == 1 && c == 1;
+}
+
+Rect MaskPlacement::GetBounds() const {
+    return Sampler(*this).bounds;
+}
+
+Rect PlaceBox(const MaskPlacement& p, const Rect& box) {
+    if (p.angle == 0) {
+        double x1 = (box.x1 - p.xorigin) * p.xscale, x2 = (box.x2 - p.xorigin) * p.xscale;
+        double y1 = (box.y1 - p.yorigin) * p.yscale, y2 = (box.y2 - p.yorigin) * p.yscale;
+        return { p.x + std::min(x1, x2), p.y + std::min(y1, y2), p.x + std::max(x1, x2), p.y + std::max(y1, y2) };
+    }
+    double c, s;
+    AngleVector(p.angle, c, s);
+    return TransformBox(p, box, c, s);
+}
+
+// ============================================================================
+// Overlap tests
+// ============================================================================
+
+bool MasksOverlap(const MaskPlacement& a, const MaskPlacement& b) {
+    Sampler sa(a), sb(b);
+    if (sa.IsEmpty() || sb.IsEmpty()) return false;
+    const Rect& ra = sa.bounds;
+    const Rect& rb = sb.bounds;
+
+    int64_t x0 = std::max(PixelStart(ra.x1), PixelStart(rb.x1));
+    int64_t x1 = std::min(PixelStart(ra.x2), PixelStart(rb.x2));
+    int64_t y0 = std::max(PixelStart(ra.y1), PixelStart(rb.y1));
+    int64_t y1 = std::min(PixelStart(ra.y2), PixelStart(rb.y2));
+    if (x0 >= x1 || y0 >= y1) return false;
+
+    if (sa.aligned && sb.aligned) {
+        // Both rows line up with room pixels: AND them a word (or vector) at a time
+        uint32_t count = (uint32_t)(x1 - x0);
+        uint32_t a_bit = (uint32_t)(x0 - sa.ax), b_bit = (uint32_t)(x0 - sb.ax);
+        const uint64_t* row_a = a.mask->GetRow((uint32_t)(y0 - sa.ay));
+        const uint64_t* row_b = b.mask->GetRow((uint32_t)(y0 - sb.ay));
+        uint32_t stride_a = a.mask->GetStride(), stride_b = b.mask->GetStride();
+
+        if (count <= 64) {
+            // Typical sprites: one word per row, no dispatch
+            for (int64_t j = y0; j < y1; j++, row_a += stride_a, row_b += stride_b) {
+                if (Extract(row_a, a_bit) & Extract(row_b, b_bit)) return true;
+            }
+            return false;
+        }
+
+        RowKernel kernel = SelectRowKernel();
+        uint32_t chunks = (count + 63) / 64;
+        for (int64_t j = y0; j < y1; j++, row_a += stride_a, row_b += stride_b) {
+            if (kernel(row_a, a_bit, row_b, b_bit, chunks)) return true;
+        }
+        return false;
+    }
+
+    for (int64_t j = y0; j < y1; j++) {
+        for (int64_t i = x0; i < x1; i += 64) {
+            uint32_t n = (uint32_t)std::min<int64_t>(64, x1 - i);
+            uint64_t wa = sa.Row(j, i, n);
+            if (wa && sb.Any(j, i, wa)) return true;
+        }
+    }
+    return false;
+}
+
+bool MaskContainsPoint(const MaskPlacement& p, double x, double y) {
+    Sampler sampler(p);
+    if (sampler.IsEmpty()) return false;
+    return sampler.Row((int64_t)std::floor(y), (int64_t)std::floor(x), 1) != 0;
+}
+
+bool MaskOverlapsRect(const MaskPlacement& p, const Rect& area) {
+    Sampler sampler(p);
+    if (sampler.IsEmpty()) return false;
+    const Rect& r = sampler.bounds;
+
+    int64_t x0 = std::max(PixelStart(r.x1), PixelStart(area.x1));
+    int64_t x1 = std::min(PixelStart(r.x2), PixelEndClosed(area.x2));
+    int64_t y0 = std::max(PixelStart(r.y1), PixelStart(area.y1));
+    int64_t y1 = std::min(PixelStart(r.y2), PixelEndClosed(area.y2));
+
+    for (int64_t j = y0; j < y1; j++) {
+        for (int64_t i = x0; i < x1; i += 64) {
+            if (sampler.Row(j, i, (uint32_t)std::min<int64_t>(64, x1 - i))) return true;
+        }
+    }
+    return false;
+}
+
+} // namespace GM
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/Collision.h"
+#include "../include/Managers.h"
+#include "../include/Random.h"
+#include "../include/Sprite.h"
+
+// A room full of wandering instances where every instance asks
+// place_meeting(x, y, all) each frame. Compares a brute-force scan over
+// all instances with the room's spatial grid.
+
+using GM::Bench::TimeOp;
+
+// Moves every instance a little, as the motion pass would
+static void Wander(GM::Room& room, GM::RandomGenerator& rng) {
+    GM::InstanceStore& store = room.GetInstanceStore();
+    for (uint32_t row = 0; row < store.Size(); row++) {
+        store.xprevious[row] = store.x[row];
+        store.yprevious[row] = store.y[row];
+        store.x[row] = std::clamp(store.x[row] + rng.Range(-2, 2), 0.0, (double)room.GetWidth());
+        store.y[row] = std::clamp(store.y[row] + rng.Range(-2, 2), 0.0, (double)room.GetHeight());
+    }
+    room.MarkMoved();
+}
+
+int main() {
+    auto& manager = GM::GameGlobals::Get().GetInstanceManager();
+    auto object = std::make_shared<GM::Object>(1, "obj_actor");
+
+    // 32x32 actors
+    auto sprite = std::make_shared<GM::Sprite>(1, "spr_actor");
+    sprite->SetBBoxMode(2);
+    sprite->SetBBox(GM::Rect(0, 0, 32, 32));
+    GM::GameGlobals::Get().GetSpriteManager().AddSprite(sprite);
+    object->SetSpriteIndex(1);
+
+    std::cout << std::left << std::setw(12) << "instances" << std::right << std::setw(14) << "brute force"
+              << std::setw(14) << "grid" << std::setw(12) << "hits" << std::endl;
+
+    bool consistent = true;
+    for (size_t count : { 1000u, 10000u, 20000u }) {
+        // Keep density constant: about one instance per 64x64 pixels
+        uint32_t side = (uint32_t)(std::sqrt((double)count) * 64);
+        GM::Room room(0, "rm_bench");
+        room.SetWidth(side);
+        room.SetHeight(side);
+
+        GM::RandomGenerator rng(42);
+        for (size_t i = 0; i < count; i++) {
+            GM::InstanceHandle handle = object->CreateInstance(rng.Range(0, side), rng.Range(0, side), 100000 + (uint32_t)i);
+            room.AddInstance(handle);
+        }
+        std::vector<GM::Instance*> all;
+        for (GM::InstanceHandle handle : room.GetInstances()) all.push_back(manager.Get(handle));
+
+        size_t brute_hits = 0, grid_hits = 0;
+        double brute = TimeOp(count > 10000 ? 1 : 3, [&] {
+            room.UpdateBBoxes();
+            brute_hits = 0;
+            for (GM::Instance* inst : all) {
+                for (GM::Instance* other : all) {
+                    if (other != inst && GM::BoxOverlaps(inst->GetBBox(), other->GetBBox())) {
+                        brute_hits++;
+                        break;
+                    }
+                }
+            }
+        });
+        double grid = TimeOp(20, [&] {
+            grid_hits = 0;
+            for (GM::Instance* inst : all) {
+                if (GM::Collision::PlaceMeeting(room, inst, inst->GetX(), inst->GetY(), GM::Collision::OBJECT_ALL)) {
+                    grid_hits++;
+                }
+            }
+        });
+        if (brute_hits != grid_hits) consistent = false;
+
+        // Per-frame cost with movement, including the index updates
+        double moving = TimeOp(20, [&] {
+            Wander(room, rng);
+            for (GM::Instance* inst : all) {
+                GM::Collision::PlaceMeeting(room, inst, inst->GetX(), inst->GetY(), GM::Collision::OBJECT_ALL);
+            }
+        });
+
+        std::cout << std::left << std::setw(12) << count << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(11) << brute * 1e3 << " ms" << std::setw(11) << grid * 1e3 << " ms"
+                  << std::setw(12) << grid_hits
+                  << "   (moving: " << moving * 1e3 << " ms/frame)" << std::endl;
+        room.Clear();
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: grid and brute force disagree" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: grid matches brute force" << std::endl;
+    return 0;
+}
@@ -0,0 +1,766 @@
+#include "DataStructures.h"
+#include "VM_Executor.h"
+#include "DSGridOps.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+
+namespace GM {
+
+static constexpr size_t NPOS = (size_t)-1;
+static constexpr size_t MAP_INITIAL_CAPACITY = 16;
+
+// Shared helpers
+
+bool DSValuesEqual(const Value& a, const Value& b) {
+    if (a.IsArray() || a.IsStruct() || b.IsArray() || b.IsStruct()) {
+        return a == b;
+    }
+    if (a.IsString() || b.IsString()) {
+        return a.IsString() && b.IsString() && a.GetStringRef() == b.GetStringRef();
+    }
+    if (a.IsUndefined() || b.IsUndefined()) {
+        return a.IsUndefined() && b.IsUndefined();
+    }
+    return a.AsReal() == b.AsReal();
+}
+
+uint32_t DSHashValue(const Value& v) {
+    if (v.IsString()) {
+        return (uint32_t)std::hash<std::string>()(v.GetStringRef());
+    }
+    if (v.IsUndefined()) {
+        return 0x9E3779B9u;
+    }
+    if (v.IsArray() || v.IsStruct()) {
+        const void* ref = v.IsArray() ? (const void*)v.GetArray() : (const void*)v.GetStruct();
+        return (uint32_t)std::hash<const void*>()(ref);
+    }
+    double d = v.AsReal();
+    if (d == 0.0) d = 0.0;  // Fold -0.0 onto 0.0
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    bits ^= bits >> 33;
+    bits *= 0xFF51AFD7ED558CCDull;
+    bits ^= bits >> 33;
+    return (uint32_t)bits;
+}
+
+// Reals sort before strings, as in GameMaker
+static bool DSValueLess(const Value& a, const Value& b) {
+    bool a_str = a.IsString();
+    bool b_str = b.IsString();
+    if (a_str != b_str) return !a_str;
+    if (a_str) return a.GetStringRef() < b.GetStringRef();
+    return a.AsReal() < b.AsReal();
+}
+
+// DSList implementation
+Value DSList::Get(size_t index) const {
+    if (index < items.size()) {
+        return items[index];
+    }
+    return Value();
+}
+
+void DSList::Set(size_t index, const Value& val) {
+    if (index >= items.size()) {
+        items.resize(index + 1, Value(0.0));
+    }
+    items[index] = val;
+}
+
+void DSList::Insert(size_t index, const Value& val) {
+    if (index <= items.size()) {
+        items.insert(items.begin() + index, val);
+    }
+}
+
+void DSList::Delete(size_t index) {
+    if (index < items.size()) {
+        items.erase(items.begin() + index);
+    }
+}
+
+int64_t DSList::FindIndex(const Value& val) const {
+    for (size_t i = 0; i < items.size(); i++) {
+        if (DSValuesEqual(items[i], val)) {
+            return (int64_t)i;
+        }
+    }
+    return -1;
+}
+
+void DSList::Sort(bool ascending) {
+    if (ascending) {
+        std::stable_sort(items.begin(), items.end(), DSValueLess);
+    } else {
+        std::stable_sort(items.begin(), items.end(),
+            [](const Value& a, const Value& b) { return DSValueLess(b, a); });
+    }
+}
+
+// DSMap implementation
+DSMap::DSMap() {
+    entries.resize(MAP_INITIAL_CAPACITY);
+}
+
+void DSMap::Clear() {
+    entries.assign(MAP_INITIAL_CAPACITY, Entry());
+    count = 0;
+    tombstones = 0;
+}
+
+size_t DSMap::FindSlot(const Value& key, uint32_t hash) const {
+    size_t mask = entries.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Entry& e = entries[i];
+        if (e.state == SlotState::Empty) {
+            return NPOS;
+        }
+        if (e.state == SlotState::Full && e.hash == hash && DSValuesEqual(e.key, key)) {
+            return i;
+        }
+    }
+}
+
+Value* DSMap::Find(const Value& key) {
+    size_t slot = FindSlot(key, DSHashValue(key));
+    return slot != NPOS ? &entries[slot].value : nullptr;
+}
+
+const Value* DSMap::Find(const Value& key) const {
+    size_t slot = FindSlot(key, DSHashValue(key));
+    return slot != NPOS ? &entries[slot].value : nullptr;
+}
+
+void DSMap::Rehash(size_t new_capacity) {
+    std::vector<Entry> old;
+    old.swap(entries);
+    entries.resize(new_capacity);
+    tombstones = 0;
+
+    size_t mask = new_capacity - 1;
+    for (auto& e : old) {
+        if (e.state != SlotState::Full) continue;
+        size_t i = e.hash & mask;
+        while (entries[i].state != SlotState::Empty) {
+            i = (i + 1) & mask;
+        }
+        entries[i] = std::move(e);
+    }
+}
+
+bool DSMap::Set(const Value& key, const Value& val) {
+    if (Value* existing = Find(key)) {
+        *existing = val;
+        return false;
+    }
+    return Add(key, val);
+}
+
+bool DSMap::Add(const Value& key, const Value& val) {
+    uint32_t hash = DSHashValue(key);
+    if (FindSlot(key, hash) != NPOS) {
+        return false;
+    }
+
+    // Keep live + dead slots under 75% so probes always terminate quickly
+    if ((count + tombstones + 1) * 4 > entries.size() * 3) {
+        bool grow = (count + 1) * 2 > entries.size();
+        Rehash(grow ? entries.size() * 2 : entries.size());
+    }
+
+    size_t mask = entries.size() - 1;
+    size_t i = hash & mask;
+    while (entries[i].state == SlotState::Full) {
+        i = (i + 1) & mask;
+    }
+    if (entries[i].state == SlotState::Deleted) {
+        tombstones--;
+    }
+    entries[i].key = key;
+    entries[i].value = val;
+    entries[i].hash = hash;
+    entries[i].state = SlotState::Full;
+    count++;
+    return true;
+}
+
+bool DSMap::Remove(const Value& key) {
+    size_t slot = FindSlot(key, DSHashValue(key));
+    if (slot == NPOS) {
+        return false;
+    }
+    Entry& e = entries[slot];
+    e.key = Value();
+    e.value = Value();
+    e.state = SlotState::Deleted;
+    count--;
+    tombstones++;
+    return true;
+}
+
+const Value* DSMap::KeyFromSlot(size_t start) const {
+    for (size_t i = start; i < entries.size(); i++) {
+        if (entries[i].state == SlotState::Full) {
+            return &entries[i].key;
+        }
+    }
+    return nullptr;
+}
+
+const Value* DSMap::FirstKey() const {
+    return KeyFromSlot(0);
+}
+
+const Value* DSMap::NextKey(const Value& key) const {
+    size_t slot = FindSlot(key, DSHashValue(key));
+    if (slot == NPOS) {
+        return nullptr;
+    }
+    return KeyFromSlot(slot + 1);
+}
+
+// DSGrid implementation
+DSGrid::DSGrid(uint32_t width, uint32_t height)
+    : width(width), height(height), reals((size_t)width * height, 0.0) {
+}
+
+Value DSGrid::Get(uint32_t x, uint32_t y) const {
+    size_t i = Index(x, y);
+    if (!boxed.empty()) {
+        auto it = boxed.find(i);
+        if (it != boxed.end()) {
+            return it->second;
+        }
+    }
+    return Value(reals[i]);
+}
+
+void DSGrid::Set(uint32_t x, uint32_t y, const Value& val) {
+    size_t i = Index(x, y);
+    if (val.IsReal() || val.IsBool()) {
+        reals[i] = val.AsReal();
+        if (!boxed.empty()) {
+            boxed.erase(i);
+        }
+    } else {
+        reals[i] = 0.0;
+        boxed[i] = val;
+    }
+}
+
+void DSGrid::Add(uint32_t x, uint32_t y, const Value& val) {
+    size_t i = Index(x, y);
+    if (!IsBoxed(i) && (val.IsReal() || val.IsBool())) {
+        reals[i] += val.AsReal();
+        return;
+    }
+    // Strings concatenate, mismatched types overwrite
+    Value current = Get(x, y);
+    if (current.IsString() && val.IsString()) {
+        Set(x, y, Value(current.GetStringRef() + val.GetStringRef()));
+    } else {
+        Set(x, y, val);
+    }
+}
+
+void DSGrid::Multiply(uint32_t x, uint32_t y, const Value& val) {
+    size_t i = Index(x, y);
+    if (val.IsString()) return;
+    if (!IsBoxed(i)) {
+        reals[i] *= val.AsReal();
+        return;
+    }
+    Value current = Get(x, y);
+    if (current.IsString()) return;
+    Set(x, y, Value(current.AsReal() * val.AsReal()));
+}
+
+void DSGrid::Clear(const Value& val) {
+    boxed.clear();
+    if (val.IsReal() || val.IsBool()) {
+        std::fill(reals.begin(), reals.end(), val.AsReal());
+        return;
+    }
+    std::fill(reals.begin(), reals.end(), 0.0);
+    for (size_t i = 0; i < reals.size(); i++) {
+        boxed[i] = val;
+    }
+}
+
+void DSGrid::Resize(uint32_t new_width, uint32_t new_height) {
+    std::vector<double> new_reals((size_t)new_width * new_height, 0.0);
+    std::unordered_map<size_t, Value> new_boxed;
+
+    uint32_t copy_w = std::min(width, new_width);
+    uint32_t copy_h = std::min(height, new_height);
+    for (uint32_t y = 0; y < copy_h; y++) {
+        std::memcpy(&new_reals[(size_t)y * new_width], &reals[Index(0, y)], copy_w * sizeof(double));
+    }
+    for (auto& [index, val] : boxed) {
+        uint32_t x = (uint32_t)(index % width);
+        uint32_t y = (uint32_t)(index / width);
+        if (x < new_width && y < new_height) {
+            new_boxed[(size_t)y * new_width + x] = val;
+        }
+    }
+
+    width = new_width;
+    height = new_height;
+    reals.swap(new_reals);
+    boxed.swap(new_boxed);
+}
+
+void DSGrid::CopyFrom(const DSGrid& other) {
+    width = other.width;
+    height = other.height;
+    reals = other.reals;
+    boxed = other.boxed;
+}
+
+// DSPriority implementation
+void DSPriority::SiftUp(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (heap[parent].priority <= heap[index].priority) break;
+        std::swap(heap[parent], heap[index]);
+        index = parent;
+    }
+}
+
+void DSPriority::SiftDown(size_t index) {
+    size_t n = heap.size();
+    for (;;) {
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        size_t smallest = index;
+        if (left < n && heap[left].priority < heap[smallest].priority) smallest = left;
+        if (right < n && heap[right].priority < heap[smallest].priority) smallest = right;
+        if (smallest == index) break;
+        std::swap(heap[smallest], heap[index]);
+        index = smallest;
+    }
+}
+
+void DSPriority::RemoveAt(size_t index) {
+    std::swap(heap[index], heap.back());
+    heap.pop_back();
+    if (index < heap.size()) {
+        SiftDown(index);
+        SiftUp(index);
+    }
+}
+
+int64_t DSPriority::IndexOf(const Value& val) const {
+    for (size_t i = 0; i < heap.size(); i++) {
+        if (DSValuesEqual(heap[i].value, val)) {
+            return (int64_t)i;
+        }
+    }
+    return -1;
+}
+
+size_t DSPriority::MaxIndex() const {
+    size_t best = heap.size() / 2;
+    for (size_t i = best + 1; i < heap.size(); i++) {
+        if (heap[i].priority > heap[best].priority) best = i;
+    }
+    return best;
+}
+
+void DSPriority::Add(const Value& val, double priority) {
+    heap.push_back({priority, val});
+    SiftUp(heap.size() - 1);
+}
+
+bool DSPriority::ChangePriority(const Value& val, double priority) {
+    int64_t index = IndexOf(val);
+    if (index < 0) return false;
+    double old = heap[index].priority;
+    heap[index].priority = priority;
+    if (priority < old) {
+        SiftUp((size_t)index);
+    } else {
+        SiftDown((size_t)index);
+    }
+    return true;
+}
+
+bool DSPriority::FindPriority(const Value& val, double& out_priority) const {
+    int64_t index = IndexOf(val);
+    if (index < 0) return false;
+    out_priority = heap[index].priority;
+    return true;
+}
+
+bool DSPriority::DeleteValue(const Value& val) {
+    int64_t index = IndexOf(val);
+    if (index < 0) return false;
+    RemoveAt((size_t)index);
+    return true;
+}
+
+Value DSPriority::FindMin() const {
+    return heap.empty() ? Value() : heap[0].value;
+}
+
+Value DSPriority::DeleteMin() {
+    if (heap.empty()) return Value();
+    Value val = heap[0].value;
+    RemoveAt(0);
+    return val;
+}
+
+Value DSPriority::FindMax() const {
+    return heap.empty() ? Value() : heap[MaxIndex()].value;
+}
+
+Value DSPriority::DeleteMax() {
+    if (heap.empty()) return Value();
+    size_t index = MaxIndex();
+    Value val = heap[index].value;
+    RemoveAt(index);
+    return val;
+}
+
+// DataStructureManager implementation
+bool DataStructureManager::Exists(int64_t handle, DSType type) const {
+    switch (type) {
+        case DSType::List: return lists.Exists(handle);
+        case DSType::Map: return maps.Exists(handle);
+        case DSType::Grid: return grids.Exists(handle);
+        case DSType::Priority: return priorities.Exists(handle);
+        default: return false;
+    }
+}
+
+void DataStructureManager::Clear() {
+    lists.Clear();
+    maps.Clear();
+    grids.Clear();
+    priorities.Clear();
+}
+
+// VM built-ins
+
+namespace {
+
+using Args = std::vector<Value>;
+
+const Value& Arg(const Args& args, size_t i) {
+    static const Value undefined;
+    return i < args.size() ? args[i] : undefined;
+}
+
+int64_t ArgInt(const Args& args, size_t i) {
+    return ToInt64(Arg(args, i).AsReal());
+}
+
+// Grid dimensions from args[i] and args[i + 1]; false unless both are
+// positive and the cell count fits under DSGrid::MAX_CELLS
+bool ArgGridSize(const Args& args, size_t i, uint32_t& width, uint32_t& height) {
+    int64_t w = ArgInt(args, i);
+    int64_t h = ArgInt(args, i + 1);
+    if (w <= 0 || h <= 0 || w > UINT32_MAX || h > UINT32_MAX) return false;
+    if ((uint64_t)w * (uint64_t)h > DSGrid::MAX_CELLS) return false;
+    width = (uint32_t)w;
+    height = (uint32_t)h;
+    return true;
+}
+
+// Wraps fn so it only runs with a live structure resolved from args[0]
+template <typename T, typename Fn>
+VirtualMachine::BuiltInFunction Resolve(HandleTable<T>& table, Fn fn) {
+    return [&table, fn](const Args& args) -> Value {
+        T* ds = table.Get(ArgInt(args, 0));
+        if (!ds) return Value();
+        return fn(*ds, args);
+    };
+}
+
+// Wraps fn so it only runs for an in-bounds cell addressed by args[1], args[2]
+template <typename Fn>
+VirtualMachine::BuiltInFunction ResolveCell(HandleTable<DSGrid>& table, Fn fn) {
+    return Resolve(table, [fn](DSGrid& grid, const Args& args) -> Value {
+        int64_t x = ArgInt(args, 1);
+        int64_t y = ArgInt(args, 2);
+        if (!grid.InBounds(x, y)) return Value();
+        return fn(grid, (uint32_t)x, (uint32_t)y, args);
+    });
+}
+
+void RegisterListBuiltins(VirtualMachine& vm, HandleTable<DSList>& lists) {
+    vm.RegisterBuiltIn("ds_list_create", [&lists](const Args&) {
+        return Value((double)lists.Create(std::make_unique<DSList>()));
+    });
+    vm.RegisterBuiltIn("ds_list_destroy", [&lists](const Args& args) {
+        lists.Destroy(ArgInt(args, 0));
+        return Value();
+    });
+    vm.RegisterBuiltIn("ds_list_clear", Resolve(lists, [](DSList& l, const Args&) {
+        l.Clear();
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_empty", Resolve(lists, [](DSList& l, const Args&) {
+        return Value(l.Empty());
+    }));
+    vm.RegisterBuiltIn("ds_list_size", Resolve(lists, [](DSList& l, const Args&) {
+        return Value((double)l.Size());
+    }));
+    vm.RegisterBuiltIn("ds_list_add", Resolve(lists, [](DSList& l, const Args& args) {
+        for (size_t i = 1; i < args.size(); i++) {
+            l.Add(args[i]);
+        }
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_set", Resolve(lists, [](DSList& l, const Args& args) {
+        int64_t pos = ArgInt(args, 1);
+        if (pos >= 0) l.Set((size_t)pos, Arg(args, 2));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_insert", Resolve(lists, [](DSList& l, const Args& args) {
+        int64_t pos = ArgInt(args, 1);
+        if (pos >= 0) l.Insert((size_t)pos, Arg(args, 2));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_delete", Resolve(lists, [](DSList& l, const Args& args) {
+        int64_t pos = ArgInt(args, 1);
+        if (pos >= 0) l.Delete((size_t)pos);
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_find_index", Resolve(lists, [](DSList& l, const Args& args) {
+        return Value((double)l.FindIndex(Arg(args, 1)));
+    }));
+    vm.RegisterBuiltIn("ds_list_find_value", Resolve(lists, [](DSList& l, const Args& args) {
+        int64_t pos = ArgInt(args, 1);
+        return pos >= 0 ? l.Get((size_t)pos) : Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_sort", Resolve(lists, [](DSList& l, const Args& args) {
+        l.Sort(Arg(args, 1).AsBool());
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_list_copy", Resolve(lists, [&lists](DSList& l, const Args& args) {
+        DSList* source = lists.Get(ArgInt(args, 1));
+        if (source && source != &l) l.GetItems() = source->GetItems();
+        return Value();
+    }));
+}
+
+void RegisterMapBuiltins(VirtualMachine& vm, HandleTable<DSMap>& maps) {
+    vm.RegisterBuiltIn("ds_map_create", [&maps](const Args&) {
+        return Value((double)maps.Create(std::make_unique<DSMap>()));
+    });
+    vm.RegisterBuiltIn("ds_map_destroy", [&maps](const Args& args) {
+        maps.Destroy(ArgInt(args, 0));
+        return Value();
+    });
+    vm.RegisterBuiltIn("ds_map_clear", Resolve(maps, [](DSMap& m, const Args&) {
+        m.Clear();
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_map_empty", Resolve(maps, [](DSMap& m, const Args&) {
+        return Value(m.Empty());
+    }));
+    vm.RegisterBuiltIn("ds_map_size", Resolve(maps, [](DSMap& m, const Args&) {
+        return Value((double)m.Size());
+    }));
+    vm.RegisterBuiltIn("ds_map_add", Resolve(maps, [](DSMap& m, const Args& args) {
+        return Value(m.Add(Arg(args, 1), Arg(args, 2)));
+    }));
+    auto set = Resolve(maps, [](DSMap& m, const Args& args) {
+        m.Set(Arg(args, 1), Arg(args, 2));
+        return Value();
+    });
+    vm.RegisterBuiltIn("ds_map_set", set);
+    vm.RegisterBuiltIn("ds_map_replace", set);
+    vm.RegisterBuiltIn("ds_map_delete", Resolve(maps, [](DSMap& m, const Args& args) {
+        m.Remove(Arg(args, 1));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_map_exists", Resolve(maps, [](DSMap& m, const Args& args) {
+        return Value(m.Contains(Arg(args, 1)));
+    }));
+    vm.RegisterBuiltIn("ds_map_find_value", Resolve(maps, [](DSMap& m, const Args& args) {
+        const Value* val = m.Find(Arg(args, 1));
+        return val ? *val : Value();
+    }));
+    vm.RegisterBuiltIn("ds_map_find_first", Resolve(maps, [](DSMap& m, const Args&) {
+        const Value* key = m.FirstKey();
+        return key ? *key : Value();
+    }));
+    vm.RegisterBuiltIn("ds_map_find_next", Resolve(maps, [](DSMap& m, const Args& args) {
+        const Value* key = m.NextKey(Arg(args, 1));
+        return key ? *key : Value();
+    }));
+    vm.RegisterBuiltIn("ds_map_copy", Resolve(maps, [&maps](DSMap& m, const Args& args) {
+        DSMap* source = maps.Get(ArgInt(args, 1));
+        if (source && source != &m) m = *source;
+        return Value();
+    }));
+}
+
+void RegisterGridBuiltins(VirtualMachine& vm, HandleTable<DSGrid>& grids) {
+    vm.RegisterBuiltIn("ds_grid_create", [&grids](const Args& args) {
+        uint32_t w, h;
+        if (!ArgGridSize(args, 0, w, h)) return Value(-1.0);
+        std::unique_ptr<DSGrid> grid;
+        try {
+            grid = std::make_unique<DSGrid>(w, h);
+        } catch (const std::bad_alloc&) {
+            return Value(-1.0);
+        }
+        return Value((double)grids.Create(std::move(grid)));
+    });
+    vm.RegisterBuiltIn("ds_grid_destroy", [&grids](const Args& args) {
+        grids.Destroy(ArgInt(args, 0));
+        return Value();
+    });
+    vm.RegisterBuiltIn("ds_grid_width", Resolve(grids, [](DSGrid& g, const Args&) {
+        return Value((double)g.GetWidth());
+    }));
+    vm.RegisterBuiltIn("ds_grid_height", Resolve(grids, [](DSGrid& g, const Args&) {
+        return Value((double)g.GetHeight());
+    }));
+    vm.RegisterBuiltIn("ds_grid_resize", Resolve(grids, [](DSGrid& g, const Args& args) {
+        uint32_t w, h;
+        if (ArgGridSize(args, 1, w, h)) g.Resize(w, h);
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_grid_clear", Resolve(grids, [](DSGrid& g, const Args& args) {
+        g.Clear(Arg(args, 1));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_grid_get", ResolveCell(grids, [](DSGrid& g, uint32_t x, uint32_t y, const Args&) {
+        return g.Get(x, y);
+    }));
+    vm.RegisterBuiltIn("ds_grid_set", ResolveCell(grids, [](DSGrid& g, uint32_t x, uint32_t y, const Args& args) {
+        g.Set(x, y, Arg(args, 3));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_grid_add", ResolveCell(grids, [](DSGrid& g, uint32_t x, uint32_t y, const Args& args) {
+        g.Add(x, y, Arg(args, 3));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_grid_multiply", ResolveCell(grids, [](DSGrid& g, uint32_t x, uint32_t y, const Args& args) {
+        g.Multiply(x, y, Arg(args, 3));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_grid_copy", Resolve(grids, [&grids](DSGrid& g, const Args& args) {
+        DSGrid* source = grids.Get(ArgInt(args, 1));
+        if (source && source != &g) g.CopyFrom(*source);
+        return Value();
+    }));
+
+    // Bulk region and disk operations (SIMD-dispatched, see DSGridOps)
+    using RegionOp = void (*)(DSGrid&, int64_t, int64_t, int64_t, int64_t, const Value&);
+    using DiskOp = void (*)(DSGrid&, double, double, double, const Value&);
+    auto region_op = [&grids](RegionOp op) {
+        return Resolve(grids, [op](DSGrid& g, const Args& args) {
+            op(g, ArgInt(args, 1), ArgInt(args, 2), ArgInt(args, 3), ArgInt(args, 4), Arg(args, 5));
+            return Value();
+        });
+    };
+    auto disk_op = [&grids](DiskOp op) {
+        return Resolve(grids, [op](DSGrid& g, const Args& args) {
+            op(g, Arg(args, 1).AsReal(), Arg(args, 2).AsReal(), Arg(args, 3).AsReal(), Arg(args, 4));
+            return Value();
+        });
+    };
+    vm.RegisterBuiltIn("ds_grid_set_region", region_op(GridOps::SetRegion));
+    vm.RegisterBuiltIn("ds_grid_add_region", region_op(GridOps::AddRegion));
+    vm.RegisterBuiltIn("ds_grid_multiply_region", region_op(GridOps::MultiplyRegion));
+    vm.RegisterBuiltIn("ds_grid_set_disk", disk_op(GridOps::SetDisk));
+    vm.RegisterBuiltIn("ds_grid_add_disk", disk_op(GridOps::AddDisk));
+    vm.RegisterBuiltIn("ds_grid_multiply_disk", disk_op(GridOps::MultiplyDisk));
+
+    using StatField = double (*)(const GridStats&);
+    auto region_stat = [&grids](StatField field) {
+        return Resolve(grids, [field](DSGrid& g, const Args& args) {
+            return Value(field(GridOps::GetRegionStats(g, ArgInt(args, 1), ArgInt(args, 2), ArgInt(args, 3), ArgInt(args, 4))));
+        });
+    };
+    auto disk_stat = [&grids](StatField field) {
+        return Resolve(grids, [field](DSGrid& g, const Args& args) {
+            return Value(field(GridOps::GetDiskStats(g, Arg(args, 1).AsReal(), Arg(args, 2).AsReal(), Arg(args, 3).AsReal())));
+        });
+    };
+    StatField sum = [](const GridStats& s) { return s.sum; };
+    StatField min = [](const GridStats& s) { return s.min; };
+    StatField max = [](const GridStats& s) { return s.max; };
+    StatField mean = [](const GridStats& s) { return s.Mean(); };
+    vm.RegisterBuiltIn("ds_grid_get_sum", region_stat(sum));
+    vm.RegisterBuiltIn("ds_grid_get_min", region_stat(min));
+    vm.RegisterBuiltIn("ds_grid_get_max", region_stat(max));
+    vm.RegisterBuiltIn("ds_grid_get_mean", region_stat(mean));
+    vm.RegisterBuiltIn("ds_grid_get_disk_sum", disk_stat(sum));
+    vm.RegisterBuiltIn("ds_grid_get_disk_min", disk_stat(min));
+    vm.RegisterBuiltIn("ds_grid_get_disk_max", disk_stat(max));
+    vm.RegisterBuiltIn("ds_grid_get_disk_mean", disk_stat(mean));
+}
+
+void RegisterPriorityBuiltins(VirtualMachine& vm, HandleTable<DSPriority>& priorities) {
+    vm.RegisterBuiltIn("ds_priority_create", [&priorities](const Args&) {
+        return Value((double)priorities.Create(std::make_unique<DSPriority>()));
+    });
+    vm.RegisterBuiltIn("ds_priority_destroy", [&priorities](const Args& args) {
+        priorities.Destroy(ArgInt(args, 0));
+        return Value();
+    });
+    vm.RegisterBuiltIn("ds_priority_clear", Resolve(priorities, [](DSPriority& p, const Args&) {
+        p.Clear();
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_priority_empty", Resolve(priorities, [](DSPriority& p, const Args&) {
+        return Value(p.Empty());
+    }));
+    vm.RegisterBuiltIn("ds_priority_size", Resolve(priorities, [](DSPriority& p, const Args&) {
+        return Value((double)p.Size());
+    }));
+    vm.RegisterBuiltIn("ds_priority_add", Resolve(priorities, [](DSPriority& p, const Args& args) {
+        p.Add(Arg(args, 1), Arg(args, 2).AsReal());
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_priority_change_priority", Resolve(priorities, [](DSPriority& p, const Args& args) {
+        p.ChangePriority(Arg(args, 1), Arg(args, 2).AsReal());
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_priority_find_priority", Resolve(priorities, [](DSPriority& p, const Args& args) {
+        double priority;
+        return p.FindPriority(Arg(args, 1), priority) ? Value(priority) : Value();
+    }));
+    vm.RegisterBuiltIn("ds_priority_delete_value", Resolve(priorities, [](DSPriority& p, const Args& args) {
+        p.DeleteValue(Arg(args, 1));
+        return Value();
+    }));
+    vm.RegisterBuiltIn("ds_priority_find_min", Resolve(priorities, [](DSPriority& p, const Args&) {
+        return p.FindMin();
+    }));
+    vm.RegisterBuiltIn("ds_priority_delete_min", Resolve(priorities, [](DSPriority& p, const Args&) {
+        return p.DeleteMin();
+    }));
+    vm.RegisterBuiltIn("ds_priority_find_max", Resolve(priorities, [](DSPriority& p, const Args&) {
+        return p.FindMax();
+    }));
+    vm.RegisterBuiltIn("ds_priority_delete_max", Resolve(priorities, [](DSPriority& p, const Args&) {
+        return p.DeleteMax();
+    }));
+}
+
+} // namespace
+
+void RegisterDataStructureBuiltins(VirtualMachine& vm, DataStructureManager& ds) {
+    RegisterListBuiltins(vm, ds.GetLists());
+    RegisterMapBuiltins(vm, ds.GetMaps());
+    RegisterGridBuiltins(vm, ds.GetGrids());
+    RegisterPriorityBuiltins(vm, ds.GetPriorities());
+
+    vm.RegisterBuiltIn("ds_exists", [&ds](const Args& args) {
+        return Value(ds.Exists(ArgInt(args, 0), (DSType)ArgInt(args, 1)));
+    });
+}
+
+} // namespace GM
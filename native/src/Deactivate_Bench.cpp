@@ -0,0 +1,131 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/GameEngine.h"
+#include "../include/Object.h"
+#include "../include/Random.h"
+
+// A large open-world room where only the area around the camera needs to
+// run. Full engine steps with every instance active versus with camera
+// activation (instances far from the view moved to the room's cold store),
+// then the cost of the region operations themselves. The final active set
+// is checked against the hysteresis rule by brute force.
+
+using GM::Bench::Clock;
+using GM::Bench::TimeOp;
+
+static bool Touches(const GM::Rect& a, const GM::Rect& b) {
+    return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+int main() {
+    constexpr double ROOM_SIZE = 32768;
+    constexpr double ACTIVATE_MARGIN = 128, DEACTIVATE_MARGIN = 512;
+
+    GM::GameEngine engine(nullptr);
+    auto& globals = engine.GetGlobals();
+
+    // Wanderers steer a little every step; one controller stays active
+    auto wanderer = std::make_shared<GM::Object>(1, "obj_wanderer");
+    wanderer->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep, [](GM::Instance* inst) {
+        double dir = std::sin(inst->GetX() * 0.001) + std::cos(inst->GetY() * 0.001);
+        inst->SetHSpeed(std::cos(dir));
+        inst->SetVSpeed(std::sin(dir));
+        inst->SetDepth(-std::floor(inst->GetY()));
+    });
+    size_t controller_steps = 0;
+    auto controller = std::make_shared<GM::Object>(2, "obj_controller");
+    controller->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep,
+        [&](GM::Instance*) { controller_steps++; });
+    controller->SetKeepActive(true);
+
+    auto camera = std::make_shared<GM::Camera>();
+    camera->SetWidth(1280);
+    camera->SetHeight(720);
+
+    std::cout << std::left << std::setw(12) << "instances" << std::right << std::setw(14) << "all active"
+              << std::setw(14) << "camera" << std::setw(10) << "speedup" << std::setw(10) << "active"
+              << std::endl;
+
+    bool consistent = true;
+    for (size_t count : { 50000u, 200000u }) {
+        auto room = std::make_shared<GM::Room>(0, "rm_world");
+        room->SetWidth((uint32_t)ROOM_SIZE);
+        room->SetHeight((uint32_t)ROOM_SIZE);
+        room->AddCamera(camera);
+        room->SetActiveCamera(camera);
+        GM::RandomGenerator rng(3);
+        for (size_t i = 0; i < count; i++) {
+            room->AddInstance(wanderer->CreateInstance(rng.Range(0, ROOM_SIZE), rng.Range(0, ROOM_SIZE),
+                                                       1000 + (uint32_t)i));
+        }
+        room->AddInstance(controller->CreateInstance(0, 0, 999));
+        globals.GetRoomManager().SetCurrentRoom(room);
+
+        // The camera pans diagonally across the room
+        camera->SetX(ROOM_SIZE / 4);
+        camera->SetY(ROOM_SIZE / 4);
+        double all_time = TimeOp(10, [&] { engine.Update(); });
+
+        room->SetCameraActivation(true, ACTIVATE_MARGIN, DEACTIVATE_MARGIN);
+        double camera_time = TimeOp(50, [&] {
+            camera->SetX(camera->GetX() + 8);
+            camera->SetY(camera->GetY() + 5);
+            size_t before = controller_steps;
+            engine.Update();
+            if (controller_steps != before + 1) consistent = false;
+        });
+
+        // The last step moved instances after activation ran, so apply it
+        // once more before checking
+        room->UpdateCameraActivation();
+        GM::Rect near_rect(camera->GetX() - ACTIVATE_MARGIN, camera->GetY() - ACTIVATE_MARGIN,
+                           camera->GetX() + camera->GetWidth() + ACTIVATE_MARGIN,
+                           camera->GetY() + camera->GetHeight() + ACTIVATE_MARGIN);
+        GM::Rect far_rect(camera->GetX() - DEACTIVATE_MARGIN, camera->GetY() - DEACTIVATE_MARGIN,
+                          camera->GetX() + camera->GetWidth() + DEACTIVATE_MARGIN,
+                          camera->GetY() + camera->GetHeight() + DEACTIVATE_MARGIN);
+        for (GM::Instance* inst = wanderer->GetFirstInstance(); inst; inst = inst->GetNextInObject()) {
+            bool touches_near = Touches(inst->GetBBox(), near_rect);
+            bool touches_far = Touches(inst->GetBBox(), far_rect);
+            if (touches_near && !inst->GetActive()) consistent = false;
+            if (!touches_far && inst->GetActive()) consistent = false;
+        }
+        size_t active = room->GetInstanceCount();
+
+        std::cout << std::left << std::setw(12) << count << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << all_time * 1e3 << " ms" << std::setw(11) << camera_time * 1e3 << " ms"
+                  << std::setw(9) << std::setprecision(1) << all_time / camera_time << "x" << std::setw(10)
+                  << active << std::endl;
+
+        // Region operations on their own: everything back on, then off
+        // outside the view again
+        room->SetCameraActivation(false);
+        GM::Rect view(camera->GetX(), camera->GetY(), camera->GetX() + camera->GetWidth(),
+                      camera->GetY() + camera->GetHeight());
+        auto start = Clock::now();
+        room->ActivateRegion(view, false);
+        double activate_time = std::chrono::duration<double>(Clock::now() - start).count();
+        if (room->GetInactiveCount() != 0) consistent = false;
+        start = Clock::now();
+        room->DeactivateRegion(view, false);
+        double deactivate_time = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::left << std::setw(12) << "" << std::right << std::setprecision(3)
+                  << "activate all " << activate_time * 1e3 << " ms, deactivate outside view "
+                  << deactivate_time * 1e3 << " ms" << std::endl;
+
+        globals.GetRoomManager().SetCurrentRoom(nullptr);
+        room->Clear();
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: active set breaks the camera activation rule" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: active set follows the camera activation rule" << std::endl;
+    return 0;
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/Managers.h"
+#include "../include/Object.h"
+#include "../include/Random.h"
+
+// Cost of triggering one event on every instance of a room, through the
+// per-object dispatch tables versus the nested std::map lookup (walking the
+// parent chain) they replace. Objects form short inheritance chains, and
+// only some of them handle each event. Then a step over a room of mostly
+// static scenery, visiting every instance versus the room's subscriber list,
+// a step of alarms, counting down all twelve of every instance versus
+// popping the due ones off the room's alarm wheel, and a frame's draw order,
+// sorting every frame versus fixing up the room's persistent order.
+
+using GM::Bench::Clock;
+using GM::Bench::TimeOp;
+
+// The previous layout: [type][subType] maps per object, searched up the chain
+struct MapObject {
+    MapObject* parent = nullptr;
+    std::map<int, std::map<int, GM::Object::EventCallback>> event_callbacks;
+
+    void TriggerEvent(GM::Instance* inst, GM::EventType type, int subType) {
+        for (MapObject* obj = this; obj; obj = obj->parent) {
+            auto type_it = obj->event_callbacks.find((int)type);
+            if (type_it == obj->event_callbacks.end()) continue;
+            auto subtype_it = type_it->second.find(subType);
+            if (subtype_it == type_it->second.end()) continue;
+            subtype_it->second(inst);
+            return;
+        }
+    }
+};
+
+int main() {
+    constexpr int OBJECT_COUNT = 64;
+    constexpr size_t INSTANCE_COUNT = 100000;
+
+    size_t calls = 0;
+    GM::Object::EventCallback handler = [&](GM::Instance*) { calls++; };
+
+    // Chains of four: a base with step, alarm and collision handlers, then
+    // children overriding some of them. Every fourth chain handles nothing.
+    std::vector<std::shared_ptr<GM::Object>> objects;
+    std::vector<MapObject> map_objects(OBJECT_COUNT);
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        auto obj = std::make_shared<GM::Object>(i + 1, "obj_" + std::to_string(i));
+        MapObject& ref = map_objects[i];
+        int depth = i % 4, chain = i / 4;
+        if (depth > 0) {
+            obj->SetParent(objects[i - 1]);
+            ref.parent = &map_objects[i - 1];
+        }
+        auto add = [&](GM::EventType type, int subType) {
+            obj->SetEventCallback(type, subType, handler);
+            ref.event_callbacks[(int)type][subType] = handler;
+        };
+        if (chain % 4 != 3) {
+            if (depth == 0) {
+                add(GM::EventType::Step, (int)GM::StepEventType::NormalStep);
+                add(GM::EventType::Alarm, 0);
+                add(GM::EventType::Collision, 1);
+            }
+            if (depth == 2) add(GM::EventType::Step, (int)GM::StepEventType::NormalStep);
+            if (depth == 3) add(GM::EventType::Step, (int)GM::StepEventType::EndStep);
+        }
+        objects.push_back(obj);
+    }
+    auto start = Clock::now();
+    for (auto& obj : objects) obj->BuildDispatchTable();
+    double build = std::chrono::duration<double>(Clock::now() - start).count();
+
+    GM::RandomGenerator rng(5);
+    std::vector<int> kinds(INSTANCE_COUNT);
+    for (int& kind : kinds) kind = rng.IRange(0, OBJECT_COUNT - 1);
+
+    std::cout << "Dispatch tables for " << OBJECT_COUNT << " objects built in " << std::fixed
+              << std::setprecision(3) << build * 1e3 << " ms" << std::endl << std::endl;
+    std::cout << std::left << std::setw(18) << "event" << std::right << std::setw(14) << "map lookup"
+              << std::setw(14) << "table" << std::setw(10) << "speedup" << std::setw(10) << "calls" << std::endl;
+
+    bool consistent = true;
+    struct Case { const char* name; GM::EventType type; int subType; };
+    for (const Case& c : { Case{ "step", GM::EventType::Step, (int)GM::StepEventType::NormalStep },
+                           Case{ "end step", GM::EventType::Step, (int)GM::StepEventType::EndStep },
+                           Case{ "alarm 0", GM::EventType::Alarm, 0 },
+                           Case{ "draw (unhandled)", GM::EventType::Draw, 0 } }) {
+        size_t map_calls = 0, table_calls = 0;
+        double map_time = TimeOp(20, [&] {
+            calls = 0;
+            for (int kind : kinds) map_objects[kind].TriggerEvent(nullptr, c.type, c.subType);
+            map_calls = calls;
+        });
+        double table_time = TimeOp(20, [&] {
+            calls = 0;
+            for (int kind : kinds) objects[kind]->TriggerEvent(nullptr, c.type, c.subType);
+            table_calls = calls;
+        });
+        if (map_calls != table_calls) consistent = false;
+
+        std::cout << std::left << std::setw(18) << c.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(11) << map_time * 1e3 << " ms" << std::setw(11) << table_time * 1e3 << " ms"
+                  << std::setw(9) << map_time / table_time << "x" << std::setw(10) << table_calls << std::endl;
+    }
+
+    // Scenery has no events at all; a few actors step
+    auto& manager = GM::GameGlobals::Get().GetInstanceManager();
+    auto scenery = std::make_shared<GM::Object>(1000, "obj_scenery");
+    auto actor = std::make_shared<GM::Object>(1001, "obj_actor");
+    actor->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep, handler);
+    std::cout << std::endl << std::left << std::setw(18) << "room step" << std::right << std::setw(14)
+              << "all instances" << std::setw(14) << "subscribers" << std::setw(10) << "speedup" << std::setw(10)
+              << "calls" << std::endl;
+    for (size_t scenery_count : { 10000u, 100000u }) {
+        GM::Room room(0, "rm_bench");
+        uint32_t next_id = 100000;
+        for (size_t i = 0; i < scenery_count; i++) room.AddInstance(scenery->CreateInstance(0, 0, next_id++));
+        for (size_t i = 0; i < 500; i++) room.AddInstance(actor->CreateInstance(0, 0, next_id++));
+
+        size_t all_calls = 0, subscriber_calls = 0;
+        double all_time = TimeOp(20, [&] {
+            calls = 0;
+            auto& instances = room.GetInstances();
+            for (size_t i = 0; i < instances.size(); i++) {
+                GM::Instance* inst = manager.Get(instances[i]);
+                if (inst && inst->GetActive()) inst->StepEvent(GM::StepEventType::NormalStep);
+            }
+            all_calls = calls;
+        });
+        double subscriber_time = TimeOp(20, [&] {
+            calls = 0;
+            auto& subscribers = room.GetSubscribers(GM::Room::EventList::Step);
+            for (size_t i = 0; i < subscribers.size(); i++) {
+                GM::Instance* inst = manager.Get(subscribers[i].handle);
+                if (inst && inst->GetActive()) inst->StepEvent(GM::StepEventType::NormalStep);
+            }
+            subscriber_calls = calls;
+        });
+        if (all_calls != subscriber_calls) consistent = false;
+
+        std::cout << std::left << std::setw(18) << std::to_string(scenery_count) + " + 500" << std::right
+                  << std::fixed << std::setprecision(3) << std::setw(11) << all_time * 1e3 << " ms"
+                  << std::setw(11) << subscriber_time * 1e3 << " ms" << std::setw(9) << std::setprecision(1)
+                  << all_time / subscriber_time << "x" << std::setw(10) << subscriber_calls << std::endl;
+        room.Clear();
+    }
+
+    // Every instance keeps one alarm re-arming itself every 300 steps, so
+    // about 1 in 300 fires per step
+    constexpr int ALARM_PERIOD = 300;
+    auto ticker = std::make_shared<GM::Object>(1002, "obj_ticker");
+    ticker->SetEventCallback(GM::EventType::Alarm, 0, [&](GM::Instance* inst) {
+        calls++;
+        inst->SetAlarm(0, ALARM_PERIOD);
+    });
+    ticker->BuildDispatchTable();
+    std::cout << std::endl << std::left << std::setw(18) << "alarm step" << std::right << std::setw(14)
+              << "countdown" << std::setw(14) << "wheel" << std::setw(10) << "speedup" << std::setw(10)
+              << "calls" << std::endl;
+    for (size_t count : { 10000u, 100000u }) {
+        GM::Room room(0, "rm_bench");
+        std::vector<std::array<int, GM::Instance::ALARM_COUNT>> countdown(count);
+        std::vector<GM::Instance*> tickers;
+        for (size_t i = 0; i < count; i++) {
+            GM::InstanceHandle handle = ticker->CreateInstance(0, 0, 200000 + (uint32_t)i);
+            room.AddInstance(handle);
+            GM::Instance* inst = manager.Get(handle);
+            inst->SetAlarm(0, 1 + (int)(i % ALARM_PERIOD));
+            countdown[i].fill(-1);
+            countdown[i][0] = inst->GetAlarm(0);
+            tickers.push_back(inst);
+        }
+
+        // The per-instance countdown the wheel replaces
+        size_t countdown_calls = 0, wheel_calls = 0;
+        double countdown_time = TimeOp(ALARM_PERIOD, [&] {
+            calls = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (!tickers[i]->GetActive()) continue;
+                for (int& alarm : countdown[i]) {
+                    if (alarm >= 0 && --alarm == 0) {
+                        alarm = ALARM_PERIOD;
+                        calls++;
+                    }
+                }
+            }
+            countdown_calls += calls;
+        });
+        double wheel_time = TimeOp(ALARM_PERIOD, [&] {
+            calls = 0;
+            room.RunAlarms();
+            wheel_calls += calls;
+        });
+        if (countdown_calls != wheel_calls) consistent = false;
+
+        std::cout << std::left << std::setw(18) << std::to_string(count) << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(11) << countdown_time * 1e3 << " ms"
+                  << std::setw(11) << wheel_time * 1e3 << " ms" << std::setw(9) << std::setprecision(1)
+                  << countdown_time / wheel_time << "x" << std::setw(10) << wheel_calls << std::endl;
+        room.Clear();
+    }
+
+    // Drawn scenery at a few depths; a handful of instances change depth
+    // every frame
+    auto drawer = std::make_shared<GM::Object>(1003, "obj_drawer");
+    std::vector<GM::InstanceHandle> drawn;
+    drawer->SetEventCallback(GM::EventType::Draw, 0, [&](GM::Instance* inst) { drawn.push_back(inst->GetHandle()); });
+    drawer->BuildDispatchTable();
+    std::cout << std::endl << std::left << std::setw(18) << "draw order" << std::right << std::setw(14)
+              << "full sort" << std::setw(14) << "fixup" << std::setw(10) << "speedup" << std::endl;
+    for (size_t count : { 10000u, 100000u }) {
+        GM::Room room(0, "rm_bench");
+        std::vector<GM::Instance*> drawers;
+        for (size_t i = 0; i < count; i++) {
+            GM::InstanceHandle handle = drawer->CreateInstance(0, 0, 300000 + (uint32_t)i);
+            room.AddInstance(handle);
+            drawers.push_back(manager.Get(handle));
+            drawers.back()->SetDepth(rng.IRange(0, 7) * 100);
+        }
+        auto perturb = [&] {
+            for (int i = 0; i < 8; i++) drawers[rng.IRange(0, (int)count - 1)]->SetDepth(rng.IRange(0, 7) * 100);
+        };
+
+        // What Room::Draw did before: gather and stable sort every frame
+        std::vector<GM::Instance*> order;
+        std::vector<GM::InstanceHandle> sorted_drawn;
+        double sort_time = TimeOp(20, [&] {
+            perturb();
+            order.clear();
+            for (const auto& entry : room.GetSubscribers(GM::Room::EventList::Draw)) {
+                GM::Instance* inst = manager.Get(entry.handle);
+                if (inst && inst->GetVisible()) order.push_back(inst);
+            }
+            std::stable_sort(order.begin(), order.end(),
+                [](const GM::Instance* a, const GM::Instance* b) { return a->GetDepth() < b->GetDepth(); });
+            drawn.clear();
+            for (GM::Instance* inst : order) inst->DrawEvent();
+            sorted_drawn = drawn;
+        });
+        double fixup_time = TimeOp(20, [&] {
+            perturb();
+            drawn.clear();
+            room.Draw();
+        });
+
+        // Both orders agree on an unperturbed frame
+        drawn.clear();
+        room.Draw();
+        std::vector<GM::InstanceHandle> fixup_drawn = drawn;
+        order.clear();
+        for (const auto& entry : room.GetSubscribers(GM::Room::EventList::Draw)) order.push_back(manager.Get(entry.handle));
+        std::stable_sort(order.begin(), order.end(),
+            [](const GM::Instance* a, const GM::Instance* b) { return a->GetDepth() < b->GetDepth(); });
+        drawn.clear();
+        for (GM::Instance* inst : order) inst->DrawEvent();
+        if (drawn != fixup_drawn) consistent = false;
+
+        std::cout << std::left << std::setw(18) << std::to_string(count) << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(11) << sort_time * 1e3 << " ms"
+                  << std::setw(11) << fixup_time * 1e3 << " ms" << std::setw(9) << std::setprecision(1)
+                  << sort_time / fixup_time << "x" << std::endl;
+        room.Clear();
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: dispatch paths disagree" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: all dispatch paths agree" << std::endl;
+    return 0;
+}
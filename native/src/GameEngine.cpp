@@ -1,4 +1,6 @@
 #include "GameEngine.h"
+#include "Collision.h"
+#include <algorithm>
 #include <cstdio>
 
 namespace GM {
@@ -55,11 +57,8 @@ void GameEngine::Update() {
     // Begin step
     auto room = GetCurrentRoom();
     if (room) {
-        for (auto& inst : room->GetInstances()) {
-            if (inst->GetActive()) {
-                inst->StepEvent(StepEventType::BeginStep);
-            }
-        }
+        room->UpdateCameraActivation();
+        RunStepEvent(*room, Room::EventList::BeginStep, StepEventType::BeginStep);
     }
 
     // Normal step
@@ -67,11 +66,7 @@ void GameEngine::Update() {
 
     // End step
     if (room) {
-        for (auto& inst : room->GetInstances()) {
-            if (inst->GetActive()) {
-                inst->StepEvent(StepEventType::EndStep);
-            }
-        }
+        RunStepEvent(*room, Room::EventList::EndStep, StepEventType::EndStep);
     }
 
     // Update room
@@ -104,13 +99,97 @@ void GameEngine::DoStep() {
     auto room = GetCurrentRoom();
     if (!room) return;
 
-    // Update instances
-    for (auto& inst : room->GetInstances()) {
+    // Alarms and step events, in instance order
+    room->RunAlarms();
+    RunStepEvent(*room, Room::EventList::Step, StepEventType::NormalStep);
+
+    // Builtin motion and animation stream through the room's columns
+    RunBuiltins(room->GetInstanceStore());
+    room->MarkMoved();
+
+    Collision::DispatchEvents(*room);
+}
+
+void GameEngine::RunStepEvent(Room& room, Room::EventList list, StepEventType type) {
+    // Only instances that handle the event, in instance order. Indexed, as
+    // an event may create instances that join the list.
+    auto& manager = globals.GetInstanceManager();
+    auto& subscribers = room.GetSubscribers(list);
+    size_t run_end = 0;  // End of the self-only run found by the last scan
+    for (size_t i = 0; i < subscribers.size(); i++) {
+        Instance* inst = manager.Get(subscribers[i].handle);
+        if (!inst) continue;
+
+        // A long enough run of self-only handlers goes to the pool at once;
+        // any other handler is a barrier and runs in place. Scanning also
+        // resolves the objects' dispatch tables before threads read them.
+        if (i >= run_end) {
+            run_end = i;
+            while (run_end < subscribers.size()) {
+                Instance* next = manager.Get(subscribers[run_end].handle);
+                if (next && !next->GetObject()->IsSelfOnly(EventType::Step, (int)type)) break;
+                run_end++;
+            }
+            if (run_end - i >= PARALLEL_MIN_RUN) {
+                RunSelfOnly(subscribers, i, run_end, type);
+                i = run_end - 1;
+                continue;
+            }
+            if (run_end == i) run_end = i + 1;  // Not self-only; rescan after it
+        }
         if (inst->GetActive()) {
-            inst->Animate();
-            inst->Update();
+            inst->StepEvent(type);
+        }
+    }
+}
+
+void GameEngine::RunSelfOnly(const std::vector<Room::Subscriber>& subscribers, size_t begin, size_t end,
+                             StepEventType type) {
+    // Writes beyond self are recorded per chunk and applied in chunk order,
+    // so they land in instance order however the chunks were scheduled
+    ThreadPool& pool = GetStepPool();
+    size_t count = end - begin;
+    size_t chunk_size = std::max<size_t>(64, count / (pool.GetThreadCount() * 8));
+    size_t chunks = ThreadPool::ChunkCount(count, chunk_size);
+    if (step_commands.size() < chunks) step_commands.resize(chunks);
+
+    auto& manager = globals.GetInstanceManager();
+    pool.ParallelFor(count, chunk_size, [&](size_t chunk, size_t first, size_t last) {
+        CommandBuffer::SetCurrent(&step_commands[chunk]);
+        for (size_t i = begin + first; i < begin + last; i++) {
+            Instance* inst = manager.Get(subscribers[i].handle);
+            if (inst && inst->GetActive()) {
+                inst->StepEvent(type);
+            }
         }
+        CommandBuffer::SetCurrent(nullptr);
+    });
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        step_commands[chunk].Apply();
+    }
+}
+
+void GameEngine::RunBuiltins(InstanceStore& store) {
+    if (store.Size() < PARALLEL_MIN_ROWS) {
+        store.ApplyMotion();
+        store.Animate();
+        return;
     }
+    // Whole cache lines of every column per chunk
+    GetStepPool().ParallelFor(store.Size(), 1024, [&](size_t, size_t first, size_t last) {
+        store.ApplyMotion(first, last);
+        store.Animate(first, last);
+    });
+}
+
+void GameEngine::SetStepThreads(size_t threads) {
+    step_threads = threads;
+    step_pool.reset();
+}
+
+ThreadPool& GameEngine::GetStepPool() {
+    if (!step_pool) step_pool = std::make_unique<ThreadPool>(step_threads);
+    return *step_pool;
 }
 
 void GameEngine::LoadRoom(std::shared_ptr<Room> room) {
@@ -127,33 +206,78 @@ void GameEngine::LoadRoom(std::shared_ptr<Room> room) {
 
 void GameEngine::SwitchRoom(uint32_t room_id, bool starting) {
     auto room = globals.GetRoomManager().GetRoom(room_id);
-    if (room) {
+    if (!room) return;
+    if (starting) {
+        globals.GetRoomManager().SetCurrentRoom(room);
+        RoomStart(room, true);
+    } else {
         LoadRoom(room);
     }
 }
 
+void GameEngine::PrefetchRoom(uint32_t room_id) {
+    auto room = globals.GetRoomManager().GetRoom(room_id);
+    if (!room || room->IsBuilt() || room == GetCurrentRoom() || room_builders.count(room_id)) return;
+    auto builder = std::make_unique<RoomBuilder>(room);
+    builder->Start();
+    room_builders[room_id] = std::move(builder);
+}
+
+bool GameEngine::IsRoomPrefetched(uint32_t room_id) const {
+    auto it = room_builders.find(room_id);
+    return it != room_builders.end() && it->second->IsReady();
+}
+
+void GameEngine::BuildRoom(const std::shared_ptr<Room>& room) {
+    if (room->IsBuilt()) return;
+    auto it = room_builders.find(room->GetID());
+    if (it != room_builders.end() && it->second->GetRoom() == room) {
+        it->second->Finish();
+        room_builders.erase(it);
+    } else {
+        RoomBuilder(room).Finish();
+    }
+}
+
 void GameEngine::RoomStart(std::shared_ptr<Room> room, bool starting) {
     if (!room) return;
 
+    BuildRoom(room);
     room->RoomStartEvent();
-    
-    // Trigger room start event for all instances
-    for (auto& inst : room->GetInstances()) {
-        inst->CreateEvent();
+
+    // A persistent room comes back as it was left
+    if (room->IsFrozen()) {
+        room->Thaw();
+        return;
     }
 
+    // Runs the create event of every instance
     room->Init();
 }
 
 void GameEngine::RoomEnd(std::shared_ptr<Room> room) {
     if (!room) return;
 
+    if (room->GetPersistent()) {
+        room->RoomEndEvent();
+        room->Freeze();
+        return;
+    }
+
     // Trigger room end event for all instances
-    for (auto& inst : room->GetInstances()) {
-        inst->DestroyEvent();
+    auto& manager = globals.GetInstanceManager();
+    auto& instances = room->GetInstances();
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (Instance* inst = manager.Get(instances[i])) {
+            inst->DestroyEvent();
+        }
     }
 
     room->RoomEndEvent();
+
+    // An ordinary room is left empty, and entering it again rebuilds it
+    // from its placements
+    room->Clear();
 }
 
 } // namespace GM
@@ -1,41 +1,133 @@
 #include "Instance.h"
 #include "Object.h"
+#include "Room.h"
 #include "Graphics.h"
 #include "Managers.h"
+#include "Sprite.h"
 #include <cmath>
 #include <algorithm>
 
 namespace GM {
 
-Instance::Instance(double x, double y, uint32_t id, std::shared_ptr<Object> object)
-    : x(x), y(y), xprevious(x), yprevious(y), xstart(x), ystart(y),
-      id(id), object(object), object_index(object ? object->GetID() : 0) {
-    
+Instance::Instance(double x, double y, uint32_t id, Object* object)
+    : Instance(x, y, id, object, InstanceStore::Detached()) {
+}
+
+Instance::Instance(double x, double y, uint32_t id, Object* object, InstanceStore& dst)
+    : store(&dst), id(id), object(object),
+      object_index(object ? object->GetID() : 0), xstart(x), ystart(y) {
+    row = store->Allocate(this);
+    store->x[row] = x;
+    store->y[row] = y;
+    store->xprevious[row] = x;
+    store->yprevious[row] = y;
+
     if (object) {
-        sprite_index = object->GetSpriteIndex();
-        solid = object->GetSolid();
-        visible = object->GetVisible();
-        depth = object->GetDepth();
+        store->sprite_index[row] = object->GetSpriteIndex();
+        mask_index = object->GetMaskIndex();
+        SetSolid(object->GetSolid());
+        SetVisible(object->GetVisible());
+        store->depth[row] = object->GetDepth();
     }
-    
-    UpdateBBox();
 }
 
 Instance::~Instance() {
+    store->Release(row);
+}
+
+void Instance::MoveToStore(InstanceStore& dst) {
+    if (&dst == store) return;
+    uint32_t new_row = dst.Allocate(this);
+    dst.CopyRow(new_row, *store, row);
+    store->Release(row);
+    store = &dst;
+    row = new_row;
+}
+
+void Instance::SetActive(bool val) {
+    if (val == GetActive()) return;
+    if (!val) StopAlarms();
+    store->SetFlag(row, InstanceStore::FLAG_ACTIVE, val);
+    if (!room) return;
+    if (val) StartAlarms();
+
+    // The room moves the instance between its hot sets and cold store
+    Room* owner = room;
+    RunOrDefer([owner, h = handle] {
+        Instance* inst = GameGlobals::Get().GetInstanceManager().Get(h);
+        if (inst && inst->room == owner) owner->ApplyActive(inst);
+    });
+}
+
+void Instance::SetDepth(double val) {
+    if (store->depth[row] == val) return;
+    store->depth[row] = val;
+    if (room) room->QueueDepthChange(this);
 }
 
 void Instance::SetSpriteIndex(uint32_t val) {
-    sprite_index = val;
+    uint32_t old = store->sprite_index[row];
+    store->sprite_index[row] = val;
+    MarkBBoxDirty();
+
+    // Gaining or losing a sprite changes whether there is anything to draw
+    if (room && (old == 0) != (val == 0)) {
+        Room* owner = room;
+        RunOrDefer([owner, h = handle] {
+            Instance* inst = GameGlobals::Get().GetInstanceManager().Get(h);
+            if (inst && inst->room == owner) owner->RefreshEventLists(inst);
+        });
+    }
+}
+
+void Instance::MarkBBoxDirty() {
     bbox_dirty = true;
+    if (room && !collision_queued) {
+        collision_queued = true;
+        room->QueueCollisionUpdate(handle);
+    }
 }
 
-void Instance::UpdateBBox() {
-    // TODO: Get actual sprite dimensions
-    bbox.x1 = x;
-    bbox.y1 = y;
-    bbox.x2 = x + 32;  // Default size
-    bbox.y2 = y + 32;
+void Instance::UpdateBBox() const {
     bbox_dirty = false;
+    double x = GetX(), y = GetY();
+    uint32_t sprite_id = GetCollisionSpriteIndex();
+    auto sprite = sprite_id ? GameGlobals::Get().GetSpriteManager().GetSprite(sprite_id) : nullptr;
+    if (!sprite || sprite->GetBBox().x2 <= sprite->GetBBox().x1) {
+        // Nothing to collide with
+        bbox = { x, y, x, y };
+        return;
+    }
+
+    MaskPlacement placement;
+    placement.x = x;
+    placement.y = y;
+    placement.xorigin = sprite->GetXOrigin();
+    placement.yorigin = sprite->GetYOrigin();
+    placement.xscale = image_xscale;
+    placement.yscale = image_yscale;
+    placement.angle = image_angle;
+    bbox = PlaceBox(placement, sprite->GetBBox());
+}
+
+void Instance::Mark() {
+    if (IsMarked()) return;
+    store->SetFlag(row, InstanceStore::FLAG_MARKED, true);
+    if (handle == INVALID_INSTANCE) return;  // Not the manager's
+    RunOrDefer([h = handle] { GameGlobals::Get().GetInstanceManager().QueueDestroy(h); });
+}
+
+void Instance::ChangeObject(Object* obj, bool perform_events) {
+    RunOrDefer([h = handle, obj, perform_events] {
+        GameGlobals::Get().GetInstanceManager().QueueChangeObject(h, obj, perform_events);
+    });
+}
+
+void Instance::SetObject(Object* obj) {
+    if (object) object->RemoveInstance(this);
+    object = obj;
+    object_index = obj ? obj->GetID() : 0;
+    if (object) object->AddInstance(this);
 }
 
 void Instance::TriggerEvent(EventType type, int subType) {
@@ -53,41 +145,41 @@ void Instance::DestroyEvent() {
 }
 
 void Instance::StepEvent(StepEventType stepType) {
-    // Update alarms
-    for (int i = 0; i < 12; i++) {
-        if (alarm[i] > -1) {
-            alarm[i]--;
-            if (alarm[i] == -1) {
-                TriggerEvent(EventType::Alarm, i);
-            }
-        }
-    }
+    // Builtin motion runs separately in InstanceStore::ApplyMotion
+    TriggerEvent(EventType::Step, (int)stepType);
+}
 
-    // Apply motion
-    x += hspeed;
-    y += vspeed;
+int Instance::GetAlarm(int index) const {
+    if (index < 0 || index >= ALARM_COUNT) return -1;
+    if (alarm_due[index] == NOT_COUNTING) return alarm[index];
+    uint64_t step = room->GetAlarmStep(this, index);
+    return alarm_due[index] >= step ? (int)(alarm_due[index] - step) : -1;
+}
 
-    // Apply gravity
-    if (gravity != 0) {
-        double angle_rad = gravity_direction * 3.14159265359 / 180.0;
-        vspeed += gravity * std::sin(angle_rad);
-        hspeed += gravity * std::cos(angle_rad);
+void Instance::SetAlarm(int index, int val) {
+    if (index < 0 || index >= ALARM_COUNT) return;
+    alarm_token[index]++;
+    if (val >= 0 && room && GetActive()) {
+        room->ScheduleAlarm(this, index, val);
+    } else {
+        alarm_due[index] = NOT_COUNTING;
+        alarm[index] = val;
     }
+}
 
-    // Apply friction
-    if (friction > 0) {
-        double speed_mag = std::sqrt(hspeed * hspeed + vspeed * vspeed);
-        if (speed_mag > friction) {
-            double factor = 1.0 - (friction / speed_mag);
-            hspeed *= factor;
-            vspeed *= factor;
-        } else {
-            hspeed = 0;
-            vspeed = 0;
-        }
+void Instance::StartAlarms() {
+    for (int i = 0; i < ALARM_COUNT; i++) {
+        if (alarm_due[i] == NOT_COUNTING && alarm[i] >= 0) SetAlarm(i, alarm[i]);
     }
+}
 
-    TriggerEvent(EventType::Step, (int)stepType);
+void Instance::StopAlarms() {
+    for (int i = 0; i < ALARM_COUNT; i++) {
+        if (alarm_due[i] == NOT_COUNTING) continue;
+        alarm[i] = GetAlarm(i);
+        alarm_due[i] = NOT_COUNTING;
+        alarm_token[i]++;
+    }
 }
 
 void Instance::DrawEvent() {
@@ -96,37 +188,29 @@ void Instance::DrawEvent() {
     if (renderer) {
         // Draw a colored rectangle representing this instance
         // Vary color based on instance ID
+        int x = (int)GetX(), y = (int)GetY();
         unsigned int color = 0xFF000000 | ((object_index * 15 + 100) & 0xFF) << 16 | 
                             ((object_index * 25 + 50) & 0xFF) << 8 | 
                             ((object_index * 35) & 0xFF);
         
-        renderer->DrawRect((int)x - 32, (int)y - 32, 64, 64, color, true);
-        renderer->DrawRect((int)x - 32, (int)y - 32, 64, 64, 0xFFFFFFFF, false);  // White outline
+        renderer->DrawRect(x - 32, y - 32, 64, 64, color, true);
+        renderer->DrawRect(x - 32, y - 32, 64, 64, 0xFFFFFFFF, false);  // White outline
     }
     
     TriggerEvent(EventType::Draw, 0);
 }
 
 void Instance::Animate() {
-    if (sprite_index == 0) return;
-    
-    // TODO: Get actual sprite frame count
-    image_index += image_speed;
-    if (image_index >= 1.0) {
-        image_index = 0;
-    }
+    uint32_t sprite_id = store->sprite_index[row];
+    if (sprite_id == 0) return;
+    auto sprite = GameGlobals::Get().GetSpriteManager().GetSprite(sprite_id);
+    store->AdvanceFrame(row, sprite ? sprite->GetFrameCount() : 1);
 }
 
 void Instance::UpdateAnimation() {
     Animate();
 }
 
-void Instance::Update() {
-    if (bbox_dirty) {
-        UpdateBBox();
-    }
-}
-
 Variant Instance::GetVariable(const std::string& name) {
     auto it = variables.find(name);
     if (it != variables.end()) {
@@ -0,0 +1,33 @@
+#include "../include/InstancePool.h"
+
+namespace GM {
+
+void InstancePool::AddSlab() {
+    slabs.emplace_back(new Slot[SLAB_SIZE]);
+    Slot* slab = slabs.back().get();
+
+    // Thread back to front so the slab is handed out in address order
+    for (size_t i = SLAB_SIZE; i-- > 0;) {
+        FreeNode* node = reinterpret_cast<FreeNode*>(&slab[i]);
+        node->next = free_list;
+        free_list = node;
+    }
+}
+
+void InstancePool::Adopt(InstancePool& other) {
+    for (auto& slab : other.slabs) slabs.push_back(std::move(slab));
+    other.slabs.clear();
+
+    // Their free slots go in front of ours
+    if (other.free_list) {
+        FreeNode* tail = other.free_list;
+        while (tail->next) tail = tail->next;
+        tail->next = free_list;
+        free_list = other.free_list;
+        other.free_list = nullptr;
+    }
+    live += other.live;
+    other.live = 0;
+}
+
+} // namespace GM
@@ -0,0 +1,343 @@
+#include "../include/InstanceStore.h"
+#include "../include/Instance.h"
+#include "../include/Managers.h"
+#include "../include/Sprite.h"
+#include "../include/SimdDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace GM {
+
+// ============================================================================
+// Motion kernels
+// ============================================================================
+
+namespace {
+
+// Column pointers for one ApplyMotion pass
+struct MotionColumns {
+    double* x;
+    double* y;
+    double* xprevious;
+    double* yprevious;
+    double* hspeed;
+    double* vspeed;
+    const double* gravity;
+    const double* gravity_dx;
+    const double* gravity_dy;
+    const double* friction;
+    const uint8_t* flags;
+};
+
+// Friction, then gravity, then motion with the updated speeds, as the
+// runner's AdaptSpeed/UpdatePositions apply them. Every kernel uses the
+// same operations in the same order, so all SIMD levels produce
+// bit-identical results.
+void MotionScalar(const MotionColumns& c, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        if (!(c.flags[i] & InstanceStore::FLAG_ACTIVE)) continue;
+
+        double h = c.hspeed[i], v = c.vspeed[i];
+        double f = c.friction[i];
+        if (f > 0) {
+            double speed = std::sqrt(h * h + v * v);
+            double factor = speed > f ? 1.0 - f / speed : 0.0;
+            h *= factor;
+            v *= factor;
+        }
+
+        h += c.gravity[i] * c.gravity_dx[i];
+        v += c.gravity[i] * c.gravity_dy[i];
+
+        c.xprevious[i] = c.x[i];
+        c.yprevious[i] = c.y[i];
+        c.x[i] += h;
+        c.y[i] += v;
+        c.hspeed[i] = h;
+        c.vspeed[i] = v;
+    }
+}
+
+#if GM_SIMD_X86
+// Lanes where mask is set take new_val, the rest keep old_val
+GM_TARGET_SSE2 inline __m128d SelectSSE2(__m128d mask, __m128d old_val, __m128d new_val) {
+    return _mm_or_pd(_mm_and_pd(mask, new_val), _mm_andnot_pd(mask, old_val));
+}
+
+GM_TARGET_SSE2 size_t MotionSSE2(const MotionColumns& c, size_t n) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d active = _mm_castsi128_pd(_mm_set_epi64x(
+            -(int64_t)(c.flags[i + 1] & InstanceStore::FLAG_ACTIVE),
+            -(int64_t)(c.flags[i] & InstanceStore::FLAG_ACTIVE)));
+
+        __m128d x = _mm_loadu_pd(c.x + i), y = _mm_loadu_pd(c.y + i);
+        __m128d h = _mm_loadu_pd(c.hspeed + i), v = _mm_loadu_pd(c.vspeed + i);
+        __m128d xp = _mm_loadu_pd(c.xprevious + i), yp = _mm_loadu_pd(c.yprevious + i);
+
+        __m128d f = _mm_loadu_pd(c.friction + i);
+        __m128d speed = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(h, h), _mm_mul_pd(v, v)));
+        __m128d moving = _mm_cmpgt_pd(speed, f);
+        __m128d factor = _mm_and_pd(moving, _mm_sub_pd(one, _mm_div_pd(f, speed)));
+        __m128d has_friction = _mm_cmpgt_pd(f, zero);
+        factor = SelectSSE2(has_friction, one, factor);
+        __m128d nh = _mm_mul_pd(h, factor);
+        __m128d nv = _mm_mul_pd(v, factor);
+
+        __m128d g = _mm_loadu_pd(c.gravity + i);
+        nh = _mm_add_pd(nh, _mm_mul_pd(g, _mm_loadu_pd(c.gravity_dx + i)));
+        nv = _mm_add_pd(nv, _mm_mul_pd(g, _mm_loadu_pd(c.gravity_dy + i)));
+
+        __m128d nx = _mm_add_pd(x, nh);
+        __m128d ny = _mm_add_pd(y, nv);
+
+        // Inactive lanes keep their old values
+        _mm_storeu_pd(c.xprevious + i, SelectSSE2(active, xp, x));
+        _mm_storeu_pd(c.yprevious + i, SelectSSE2(active, yp, y));
+        _mm_storeu_pd(c.x + i, SelectSSE2(active, x, nx));
+        _mm_storeu_pd(c.y + i, SelectSSE2(active, y, ny));
+        _mm_storeu_pd(c.hspeed + i, SelectSSE2(active, h, nh));
+        _mm_storeu_pd(c.vspeed + i, SelectSSE2(active, v, nv));
+    }
+    return i;
+}
+
+GM_TARGET_AVX2_EXACT size_t MotionAVX2(const MotionColumns& c, size_t n) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256i active_bit = _mm256_set1_epi64x(InstanceStore::FLAG_ACTIVE);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t flag_bytes;
+        std::memcpy(&flag_bytes, c.flags + i, sizeof(flag_bytes));
+        __m256i lane_flags = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(flag_bytes));
+        __m256d active = _mm256_castsi256_pd(
+            _mm256_cmpeq_epi64(_mm256_and_si256(lane_flags, active_bit), active_bit));
+
+        __m256d x = _mm256_loadu_pd(c.x + i), y = _mm256_loadu_pd(c.y + i);
+        __m256d h = _mm256_loadu_pd(c.hspeed + i), v = _mm256_loadu_pd(c.vspeed + i);
+        __m256d xp = _mm256_loadu_pd(c.xprevious + i), yp = _mm256_loadu_pd(c.yprevious + i);
+
+        __m256d f = _mm256_loadu_pd(c.friction + i);
+        __m256d speed = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(h, h), _mm256_mul_pd(v, v)));
+        __m256d moving = _mm256_cmp_pd(speed, f, _CMP_GT_OQ);
+        __m256d factor = _mm256_and_pd(moving, _mm256_sub_pd(one, _mm256_div_pd(f, speed)));
+        factor = _mm256_blendv_pd(one, factor, _mm256_cmp_pd(f, zero, _CMP_GT_OQ));
+        __m256d nh = _mm256_mul_pd(h, factor);
+        __m256d nv = _mm256_mul_pd(v, factor);
+
+        __m256d g = _mm256_loadu_pd(c.gravity + i);
+        nh = _mm256_add_pd(nh, _mm256_mul_pd(g, _mm256_loadu_pd(c.gravity_dx + i)));
+        nv = _mm256_add_pd(nv, _mm256_mul_pd(g, _mm256_loadu_pd(c.gravity_dy + i)));
+
+        __m256d nx = _mm256_add_pd(x, nh);
+        __m256d ny = _mm256_add_pd(y, nv);
+
+        _mm256_storeu_pd(c.xprevious + i, _mm256_blendv_pd(xp, x, active));
+        _mm256_storeu_pd(c.yprevious + i, _mm256_blendv_pd(yp, y, active));
+        _mm256_storeu_pd(c.x + i, _mm256_blendv_pd(x, nx, active));
+        _mm256_storeu_pd(c.y + i, _mm256_blendv_pd(y, ny, active));
+        _mm256_storeu_pd(c.hspeed + i, _mm256_blendv_pd(h, nh, active));
+        _mm256_storeu_pd(c.vspeed + i, _mm256_blendv_pd(v, nv, active));
+    }
+    return i;
+}
+#endif
+
+// Exact values on the axes so straight-down gravity adds no sideways drift
+void DirectionVector(double degrees, double& dx, double& dy) {
+    double quadrant = degrees / 90.0;
+    if (quadrant == std::floor(quadrant)) {
+        static const double axis_x[4] = { 1, 0, -1, 0 };
+        static const double axis_y[4] = { 0, -1, 0, 1 };
+        int q = (int)std::fmod(quadrant, 4.0);
+        if (q < 0) q += 4;
+        dx = axis_x[q];
+        dy = axis_y[q];
+        return;
+    }
+    // y grows downwards, so 90 degrees points up
+    double angle_rad = degrees * 3.14159265358979323846 / 180.0;
+    dx = std::cos(angle_rad);
+    dy = -std::sin(angle_rad);
+}
+
+} // namespace
+
+uint32_t InstanceStore::Allocate(Instance* owner) {
+    uint32_t row = (uint32_t)owners.size();
+    owners.push_back(owner);
+    x.push_back(0);
+    y.push_back(0);
+    xprevious.push_back(0);
+    yprevious.push_back(0);
+    hspeed.push_back(0);
+    vspeed.push_back(0);
+    gravity.push_back(0);
+    gravity_direction.push_back(270);
+    gravity_dx.push_back(0);
+    gravity_dy.push_back(1);
+    friction.push_back(0);
+    image_index.push_back(0);
+    image_speed.push_back(1.0);
+    depth.push_back(0);
+    sprite_index.push_back(0);
+    flags.push_back(FLAG_ACTIVE | FLAG_VISIBLE | FLAG_SOLID);
+    return row;
+}
+
+void InstanceStore::Release(uint32_t row) {
+    uint32_t last = (uint32_t)owners.size() - 1;
+    if (row != last) {
+        CopyRow(row, *this, last);
+        owners[row] = owners[last];
+        owners[row]->row = row;
+    }
+    owners.pop_back();
+    x.pop_back();
+    y.pop_back();
+    xprevious.pop_back();
+    yprevious.pop_back();
+    hspeed.pop_back();
+    vspeed.pop_back();
+    gravity.pop_back();
+    gravity_direction.pop_back();
+    gravity_dx.pop_back();
+    gravity_dy.pop_back();
+    friction.pop_back();
+    image_index.pop_back();
+    image_speed.pop_back();
+    depth.pop_back();
+    sprite_index.pop_back();
+    flags.pop_back();
+}
+
+void InstanceStore::CopyRow(uint32_t dst_row, const InstanceStore& src, uint32_t src_row) {
+    x[dst_row] = src.x[src_row];
+    y[dst_row] = src.y[src_row];
+    xprevious[dst_row] = src.xprevious[src_row];
+    yprevious[dst_row] = src.yprevious[src_row];
+    hspeed[dst_row] = src.hspeed[src_row];
+    vspeed[dst_row] = src.vspeed[src_row];
+    gravity[dst_row] = src.gravity[src_row];
+    gravity_direction[dst_row] = src.gravity_direction[src_row];
+    gravity_dx[dst_row] = src.gravity_dx[src_row];
+    gravity_dy[dst_row] = src.gravity_dy[src_row];
+    friction[dst_row] = src.friction[src_row];
+    image_index[dst_row] = src.image_index[src_row];
+    image_speed[dst_row] = src.image_speed[src_row];
+    depth[dst_row] = src.depth[src_row];
+    sprite_index[dst_row] = src.sprite_index[src_row];
+    flags[dst_row] = src.flags[src_row];
+}
+
+void InstanceStore::Reserve(size_t count) {
+    owners.reserve(count);
+    x.reserve(count);
+    y.reserve(count);
+    xprevious.reserve(count);
+    yprevious.reserve(count);
+    hspeed.reserve(count);
+    vspeed.reserve(count);
+    gravity.reserve(count);
+    gravity_direction.reserve(count);
+    gravity_dx.reserve(count);
+    gravity_dy.reserve(count);
+    friction.reserve(count);
+    image_index.reserve(count);
+    image_speed.reserve(count);
+    depth.reserve(count);
+    sprite_index.reserve(count);
+    flags.reserve(count);
+}
+
+void InstanceStore::ShrinkToFit() {
+    owners.shrink_to_fit();
+    x.shrink_to_fit();
+    y.shrink_to_fit();
+    xprevious.shrink_to_fit();
+    yprevious.shrink_to_fit();
+    hspeed.shrink_to_fit();
+    vspeed.shrink_to_fit();
+    gravity.shrink_to_fit();
+    gravity_direction.shrink_to_fit();
+    gravity_dx.shrink_to_fit();
+    gravity_dy.shrink_to_fit();
+    friction.shrink_to_fit();
+    image_index.shrink_to_fit();
+    image_speed.shrink_to_fit();
+    depth.shrink_to_fit();
+    sprite_index.shrink_to_fit();
+    flags.shrink_to_fit();
+}
+
+void InstanceStore::SetGravityDirection(uint32_t row, double direction) {
+    if (gravity_direction[row] == direction) return;
+    gravity_direction[row] = direction;
+    if (!std::isfinite(direction)) {
+        gravity_dx[row] = 0;
+        gravity_dy[row] = 0;
+        return;
+    }
+    DirectionVector(direction, gravity_dx[row], gravity_dy[row]);
+}
+
+void InstanceStore::ApplyMotion(size_t begin, size_t end) {
+    // The kernels see the range as a store of its own
+    size_t count = end - begin;
+    MotionColumns c = {
+        x.data() + begin, y.data() + begin, xprevious.data() + begin, yprevious.data() + begin,
+        hspeed.data() + begin, vspeed.data() + begin, gravity.data() + begin, gravity_dx.data() + begin,
+        gravity_dy.data() + begin, friction.data() + begin, flags.data() + begin
+    };
+
+    size_t done = 0;
+#if GM_SIMD_X86
+    switch (GetSimdLevel()) {
+    case SimdLevel::AVX2: done = MotionAVX2(c, count); break;
+    case SimdLevel::SSE2: done = MotionSSE2(c, count); break;
+    default: break;
+    }
+#endif
+    MotionScalar(c, done, count);
+}
+
+void InstanceStore::AdvanceFrame(size_t row, uint32_t frames) {
+    // image_index wraps around the sprite's frames, in either direction
+    double count = (double)std::max(frames, 1u);
+    double& index = image_index[row];
+    index += image_speed[row];
+    if (index >= count || index < 0) {
+        index = std::fmod(index, count);
+        if (index < 0) index += count;
+        if (index >= count) index = 0;  // A tiny negative remainder rounds up to count
+    }
+}
+
+void InstanceStore::Animate(size_t begin, size_t end) {
+    auto& sprites = GameGlobals::Get().GetSpriteManager();
+
+    // Neighbouring rows tend to share a sprite, so each run looks it up once
+    uint32_t sprite_id = 0;
+    uint32_t frames = 1;
+    for (size_t i = begin; i < end; i++) {
+        if (!(flags[i] & FLAG_ACTIVE) || sprite_index[i] == 0) continue;
+        if (sprite_index[i] != sprite_id) {
+            sprite_id = sprite_index[i];
+            auto sprite = sprites.GetSprite(sprite_id);
+            frames = sprite ? sprite->GetFrameCount() : 1;
+        }
+        AdvanceFrame(i, frames);
+    }
+}
+
+InstanceStore& InstanceStore::Detached() {
+    // Never destroyed, so instances outliving static teardown stay valid
+    static InstanceStore* detached = new InstanceStore();
+    return *detached;
+}
+
+} // namespace GM
@@ -0,0 +1,226 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+#include "../include/Managers.h"
+
+// Bullet-hell churn: every frame spawns a wave of instances and destroys the
+// wave that has reached the end of its lifetime. Compares heap allocations
+// and time per frame for the old make_shared path and the pooled handles.
+// Then `with` and instance_number over an object hierarchy: scanning every
+// instance of the room into a fresh vector versus the room's per-object
+// lists and the objects' descendant index. Last, bullets churning beside
+// that population: the end-of-step pass that looked for marked instances
+// in the whole room, versus the instance manager's queue.
+
+static std::atomic<size_t> allocation_count{ 0 };
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct FrameStats {
+    double allocations_per_frame;
+    double microseconds_per_frame;
+};
+
+static constexpr int WARMUP_FRAMES = 120;
+static constexpr int MEASURED_FRAMES = 600;
+
+static FrameStats RunFrames(const std::function<void(int)>& frame) {
+    for (int f = 0; f < WARMUP_FRAMES; f++) frame(f);
+    size_t start_allocs = allocation_count;
+    auto start = Clock::now();
+    for (int f = WARMUP_FRAMES; f < WARMUP_FRAMES + MEASURED_FRAMES; f++) frame(f);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return { (double)(allocation_count - start_allocs) / MEASURED_FRAMES, seconds * 1e6 / MEASURED_FRAMES };
+}
+
+int main() {
+    const int lifetime = 30;
+    auto object = std::make_shared<GM::Object>(1, "obj_bullet");
+
+    std::cout << std::left << std::setw(16) << "spawn/frame" << std::setw(8) << "live"
+              << std::right << std::setw(16) << "before allocs" << std::setw(14) << "before us"
+              << std::setw(16) << "pooled allocs" << std::setw(14) << "pooled us" << std::endl;
+
+    for (int wave : { 50, 200 }) {
+        // Before: shared_ptr instances in room and object lists, erased by remove_if
+        FrameStats before;
+        {
+            std::vector<std::shared_ptr<GM::Instance>> room_list, object_list;
+            std::vector<std::vector<std::shared_ptr<GM::Instance>>> ring(lifetime);
+            uint32_t next_id = 100000;
+            before = RunFrames([&](int f) {
+                auto& slot = ring[f % lifetime];
+                for (auto& inst : slot) inst->Mark();
+                slot.clear();
+                auto marked = [](const std::shared_ptr<GM::Instance>& inst) { return inst->IsMarked(); };
+                room_list.erase(std::remove_if(room_list.begin(), room_list.end(), marked), room_list.end());
+                object_list.erase(std::remove_if(object_list.begin(), object_list.end(), marked), object_list.end());
+                for (int i = 0; i < wave; i++) {
+                    auto inst = std::make_shared<GM::Instance>(i * 4.0, f * 2.0, next_id++, object.get());
+                    room_list.push_back(inst);
+                    object_list.push_back(inst);
+                    slot.push_back(inst);
+                }
+            });
+        }
+
+        // After: pooled instances referenced by handle
+        FrameStats pooled;
+        {
+            GM::Room room(0, "rm_bench");
+            auto& manager = GM::GameGlobals::Get().GetInstanceManager();
+            std::vector<std::vector<GM::InstanceHandle>> ring(lifetime);
+            uint32_t next_id = 100000;
+            pooled = RunFrames([&](int f) {
+                auto& slot = ring[f % lifetime];
+                for (GM::InstanceHandle handle : slot) manager.Get(handle)->Mark();
+                slot.clear();
+                room.Update();
+                for (int i = 0; i < wave; i++) {
+                    GM::InstanceHandle handle = object->CreateInstance(i * 4.0, f * 2.0, next_id++);
+                    room.AddInstance(handle);
+                    slot.push_back(handle);
+                }
+            });
+            room.Clear();
+        }
+
+        std::cout << std::left << std::setw(16) << wave << std::setw(8) << wave * lifetime
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(16) << before.allocations_per_frame << std::setw(14) << before.microseconds_per_frame
+                  << std::setw(16) << pooled.allocations_per_frame << std::setw(14) << pooled.microseconds_per_frame
+                  << std::endl;
+    }
+
+    // Eight chains of base <- enemy <- elite; every other instance is scenery
+    std::vector<std::shared_ptr<GM::Object>> objects;
+    auto scenery = std::make_shared<GM::Object>(2, "obj_scenery");
+    for (uint32_t chain = 0; chain < 8; chain++) {
+        for (uint32_t level = 0; level < 3; level++) {
+            auto obj = std::make_shared<GM::Object>(10 + chain * 3 + level, "obj_chain");
+            if (level > 0) obj->SetParent(objects.back());
+            objects.push_back(obj);
+        }
+    }
+
+    GM::Room room(0, "rm_bench");
+    auto& manager = GM::GameGlobals::Get().GetInstanceManager();
+    uint32_t next_id = 100000;
+    for (int i = 0; i < 100000; i++) {
+        auto& obj = i % 2 ? scenery : objects[(i / 2) % objects.size()];
+        room.AddInstance(obj->CreateInstance(i % 1000, i / 1000, next_id++));
+    }
+
+    std::cout << std::endl << std::left << std::setw(22) << "query (100000 live)" << std::right << std::setw(10)
+              << "matches" << std::setw(16) << "scan allocs" << std::setw(14) << "scan us"
+              << std::setw(16) << "index allocs" << std::setw(14) << "index us" << std::endl;
+    bool consistent = true;
+    struct Query { const char* name; GM::Object* obj; bool count_only; };
+    for (const Query& q : { Query{ "with (chain base)", objects[0].get(), false },
+                            Query{ "with (elite)", objects[2].get(), false },
+                            Query{ "instance_number", objects[0].get(), true } }) {
+        double scan_sum = 0, index_sum = 0;
+        size_t scan_matches = 0, index_matches = 0;
+        FrameStats scan = RunFrames([&](int) {
+            // Every instance, walking each one's parent chain
+            std::vector<GM::InstanceHandle> found;
+            for (GM::InstanceHandle handle : room.GetInstances()) {
+                GM::Instance* inst = manager.Get(handle);
+                if (!inst) continue;
+                for (const GM::Object* obj = inst->GetObject(); obj; obj = obj->GetParent().get()) {
+                    if (obj == q.obj) {
+                        found.push_back(handle);
+                        break;
+                    }
+                }
+            }
+            if (!q.count_only) {
+                for (GM::InstanceHandle handle : found) scan_sum += manager.Get(handle)->GetX();
+            }
+            scan_matches = found.size();
+        });
+        FrameStats index = RunFrames([&](int) {
+            if (q.count_only) {
+                index_matches = room.CountInstances(q.obj);
+                return;
+            }
+            index_matches = 0;
+            room.With(q.obj, [&](GM::Instance* inst) {
+                index_sum += inst->GetX();
+                index_matches++;
+            });
+        });
+        if (scan_matches != index_matches || scan_sum != index_sum) consistent = false;
+
+        std::cout << std::left << std::setw(22) << q.name << std::right << std::setw(10) << index_matches
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(16) << scan.allocations_per_frame << std::setw(14) << scan.microseconds_per_frame
+                  << std::setw(16) << index.allocations_per_frame << std::setw(14) << index.microseconds_per_frame
+                  << std::endl;
+    }
+
+    std::cout << std::endl << std::left << std::setw(22) << "churn (100000 live)" << std::right
+              << std::setw(10) << "spawn" << std::setw(16) << "scan allocs" << std::setw(14) << "scan us"
+              << std::setw(16) << "queue allocs" << std::setw(14) << "queue us" << std::endl;
+    const int wave = 200;
+    size_t resident = room.GetInstanceCount();
+    auto churn = [&](bool scan) {
+        std::vector<std::vector<GM::InstanceHandle>> ring(lifetime);
+        FrameStats stats = RunFrames([&](int f) {
+            auto& slot = ring[f % lifetime];
+            for (GM::InstanceHandle handle : slot) manager.Get(handle)->Mark();
+            slot.clear();
+            if (scan) {
+                for (GM::InstanceHandle handle : room.GetInstances()) {
+                    GM::Instance* inst = manager.Get(handle);
+                    if (inst && inst->IsMarked()) manager.Destroy(handle);
+                }
+                room.Compact();
+                manager.ApplyPending();  // Only entries for the destroyed instances
+            } else {
+                room.Update();
+            }
+            for (int i = 0; i < wave; i++) {
+                GM::InstanceHandle handle = object->CreateInstance(i * 4.0, f * 2.0, next_id++);
+                room.AddInstance(handle);
+                slot.push_back(handle);
+            }
+        });
+        for (auto& slot : ring) {
+            for (GM::InstanceHandle handle : slot) manager.Get(handle)->Mark();
+        }
+        room.Update();
+        if (room.GetInstanceCount() != resident) consistent = false;
+        return stats;
+    };
+    FrameStats scan = churn(true);
+    FrameStats queue = churn(false);
+    std::cout << std::left << std::setw(22) << "destroy at step end" << std::right << std::setw(10) << wave
+              << std::fixed << std::setprecision(1)
+              << std::setw(16) << scan.allocations_per_frame << std::setw(14) << scan.microseconds_per_frame
+              << std::setw(16) << queue.allocations_per_frame << std::setw(14) << queue.microseconds_per_frame
+              << std::endl;
+    room.Clear();
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: scan and index (or queue) disagree" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: scan and index (and queue) agree" << std::endl;
+    return 0;
+}
@@ -0,0 +1,506 @@
+#include "../include/JsonCodec.h"
+#include "../include/VM_Executor.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace GM {
+
+namespace {
+
+// Containers nested deeper than this are rejected by both directions
+constexpr size_t MAX_DEPTH = 512;
+
+// ============================================================================
+// String scanning
+// ============================================================================
+
+// Returns the length of the leading run of bytes that need no attention
+// inside a JSON string: anything but '"', '\\' and control characters.
+// Strings in save data are short, so a plain loop the compiler can inline
+// beats dispatching to SSE2/AVX2 kernels, which measured no faster.
+inline bool IsSpecial(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+inline size_t ScanPlain(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && !IsSpecial((unsigned char)p[i])) i++;
+    return i;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+/**
+ * Iterative SAX reader; Handler receives Null/Bool/Number/String/Key and
+ * Start/End events for objects and arrays. Strings are passed as (pointer,
+ * length) into the input when they contain no escapes, otherwise into a
+ * scratch buffer, and are only valid for the duration of the call.
+ */
+template <typename Handler>
+class Reader {
+public:
+    Reader(const char* text, size_t length, Handler& handler)
+        : p(text), begin(text), end(text + length), handler(handler) {}
+
+    bool Run(std::string* error) {
+        enum class State { Value, Key, AfterValue };
+        State state = State::Value;
+        std::vector<char> stack;   // '{' or '[' per open container
+
+        for (;;) {
+            switch (state) {
+                case State::Value: {
+                    SkipWhitespace();
+                    if (p >= end) return Fail(error, "unexpected end of input");
+                    char c = *p;
+                    if (c == '{' || c == '[') {
+                        if (stack.size() >= MAX_DEPTH) return Fail(error, "nesting too deep");
+                        p++;
+                        SkipWhitespace();
+                        char close = c == '{' ? '}' : ']';
+                        if (c == '{') handler.StartObject(); else handler.StartArray();
+                        if (p < end && *p == close) {
+                            p++;
+                            if (c == '{') handler.EndObject(); else handler.EndArray();
+                            state = State::AfterValue;
+                        } else {
+                            stack.push_back(c);
+                            state = c == '{' ? State::Key : State::Value;
+                        }
+                        break;
+                    }
+                    if (!ParseScalar(error)) return false;
+                    state = State::AfterValue;
+                    break;
+                }
+
+                case State::Key: {
+                    SkipWhitespace();
+                    if (p >= end || *p != '"') return Fail(error, "expected a string key");
+                    const char* str;
+                    size_t len;
+                    if (!ParseString(str, len, error)) return false;
+                    handler.Key(str, len);
+                    SkipWhitespace();
+                    if (p >= end || *p != ':') return Fail(error, "expected ':'");
+                    p++;
+                    state = State::Value;
+                    break;
+                }
+
+                case State::AfterValue: {
+                    SkipWhitespace();
+                    if (stack.empty()) {
+                        if (p < end) return Fail(error, "unexpected data after the root value");
+                        return true;
+                    }
+                    if (p >= end) return Fail(error, "unexpected end of input");
+                    char open = stack.back();
+                    if (*p == ',') {
+                        p++;
+                        state = open == '{' ? State::Key : State::Value;
+                    } else if (*p == (open == '{' ? '}' : ']')) {
+                        p++;
+                        stack.pop_back();
+                        if (open == '{') handler.EndObject(); else handler.EndArray();
+                    } else {
+                        return Fail(error, open == '{' ? "expected ',' or '}'" : "expected ',' or ']'");
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    void SkipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    }
+
+    bool Fail(std::string* error, const char* message) {
+        if (error) {
+            *error = std::string(message) + " at offset " + std::to_string((size_t)(p - begin));
+        }
+        return false;
+    }
+
+    bool ParseScalar(std::string* error) {
+        char c = *p;
+        if (c == '"') {
+            const char* str;
+            size_t len;
+            if (!ParseString(str, len, error)) return false;
+            handler.String(str, len);
+            return true;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            double val;
+            if (!ParseNumber(val, error)) return false;
+            handler.Number(val);
+            return true;
+        }
+        if (Literal("true")) { handler.Bool(true); return true; }
+        if (Literal("false")) { handler.Bool(false); return true; }
+        if (Literal("null")) { handler.Null(); return true; }
+        return Fail(error, "unexpected character");
+    }
+
+    bool Literal(const char* word) {
+        size_t len = std::strlen(word);
+        if ((size_t)(end - p) < len || std::memcmp(p, word, len) != 0) return false;
+        p += len;
+        return true;
+    }
+
+    bool ParseNumber(double& out, std::string* error) {
+        const char* start = p;
+        bool negative = *p == '-';
+        if (negative) p++;
+        if (p >= end || *p < '0' || *p > '9') return Fail(error, "invalid number");
+
+        // Integers of up to 15 digits are exact as doubles; everything else
+        // goes through from_chars for correct rounding
+        uint64_t mantissa = 0;
+        const char* digits = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            p++;
+        }
+        bool integral = (p >= end || (*p != '.' && *p != 'e' && *p != 'E')) && p - digits <= 15;
+        if (integral) {
+            out = negative ? -(double)mantissa : (double)mantissa;
+            return true;
+        }
+
+        auto result = std::from_chars(start, end, out);
+        if (result.ec == std::errc::result_out_of_range) {
+            // from_chars leaves out untouched here; strtod saturates to +-inf or 0
+            out = std::strtod(std::string(start, result.ptr).c_str(), nullptr);
+        } else if (result.ec != std::errc()) {
+            p = start;
+            return Fail(error, "invalid number");
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    bool ParseString(const char*& str, size_t& len, std::string* error) {
+        p++;  // Opening quote
+        const char* start = p;
+        p += ScanPlain(p, (size_t)(end - p));
+        if (p < end && *p == '"') {
+            str = start;
+            len = (size_t)(p - start);
+            p++;
+            return true;
+        }
+
+        // Slow path: decode escapes into the scratch buffer
+        scratch.assign(start, p);
+        for (;;) {
+            if (p >= end) return Fail(error, "unterminated string");
+            char c = *p;
+            if (c == '"') {
+                p++;
+                break;
+            }
+            if (c == '\\') {
+                if (!ParseEscape(error)) return false;
+            } else {
+                scratch += c;  // Raw control characters are tolerated
+                p++;
+            }
+            const char* run = p;
+            p += ScanPlain(p, (size_t)(end - p));
+            scratch.append(run, p);
+        }
+        str = scratch.data();
+        len = scratch.size();
+        return true;
+    }
+
+    bool ParseEscape(std::string* error) {
+        p++;  // Backslash
+        if (p >= end) return Fail(error, "unterminated string");
+        char c = *p++;
+        switch (c) {
+            case '"': scratch += '"'; return true;
+            case '\\': scratch += '\\'; return true;
+            case '/': scratch += '/'; return true;
+            case 'b': scratch += '\b'; return true;
+            case 'f': scratch += '\f'; return true;
+            case 'n': scratch += '\n'; return true;
+            case 'r': scratch += '\r'; return true;
+            case 't': scratch += '\t'; return true;
+            case 'u': {
+                uint32_t cp;
+                if (!ParseHex4(cp)) return Fail(error, "invalid \\u escape");
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    const char* save = p;
+                    p += 2;
+                    uint32_t low;
+                    if (ParseHex4(low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        p = save;
+                    }
+                }
+                // Unpaired surrogates become U+FFFD rather than invalid UTF-8
+                if (cp >= 0xD800 && cp <= 0xDFFF) cp = 0xFFFD;
+                AppendUtf8(scratch, cp);
+                return true;
+            }
+            default:
+                p--;
+                return Fail(error, "invalid escape");
+        }
+    }
+
+    bool ParseHex4(uint32_t& out) {
+        if (end - p < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = p[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = (uint32_t)(c - 'A' + 10);
+            else return false;
+            out = (out << 4) | digit;
+        }
+        p += 4;
+        return true;
+    }
+
+    const char* p;
+    const char* begin;
+    const char* end;
+    Handler& handler;
+    std::string scratch;
+};
+
+// Builds GML values straight from reader events. Children collect on one
+// shared stack and each container is allocated at its final size when it closes.
+class ValueBuilder {
+public:
+    void Null() { values.emplace_back(); }
+    void Bool(bool b) { values.emplace_back(b); }
+    void Number(double d) { values.emplace_back(d); }
+    void String(const char* str, size_t len) { values.emplace_back(std::string(str, len)); }
+    void Key(const char* str, size_t len) { keys.emplace_back(str, len); }
+
+    void StartObject() { frames.push_back({ values.size(), keys.size() }); }
+    void StartArray() { frames.push_back({ values.size(), keys.size() }); }
+
+    void EndObject() {
+        Frame frame = frames.back();
+        frames.pop_back();
+        auto obj = std::make_shared<Struct>();
+        obj->Reserve(values.size() - frame.first_value);
+        for (size_t i = frame.first_value, k = frame.first_key; i < values.size(); i++, k++) {
+            obj->Set(std::move(keys[k]), std::move(values[i]));
+        }
+        values.resize(frame.first_value);
+        keys.resize(frame.first_key);
+        values.emplace_back(std::move(obj));
+    }
+
+    void EndArray() {
+        Frame frame = frames.back();
+        frames.pop_back();
+        auto arr = std::make_shared<Array>(std::make_move_iterator(values.begin() + frame.first_value),
+                                           std::make_move_iterator(values.end()));
+        values.resize(frame.first_value);
+        values.emplace_back(std::move(arr));
+    }
+
+    Value& GetRoot() { return values.back(); }
+
+private:
+    struct Frame {
+        size_t first_value;
+        size_t first_key;
+    };
+
+    std::vector<Value> values;
+    std::vector<std::string> keys;
+    std::vector<Frame> frames;
+};
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+class Writer {
+public:
+    Writer(std::string& out, bool pretty) : out(out), pretty(pretty) {}
+
+    bool Write(const Value& val, size_t depth) {
+        if (Array* arr = val.GetArray()) {
+            if (depth >= MAX_DEPTH) return false;
+            out += '[';
+            for (size_t i = 0; i < arr->size(); i++) {
+                if (i > 0) out += ',';
+                NewLine(depth + 1);
+                if (!Write((*arr)[i], depth + 1)) return false;
+            }
+            if (!arr->empty()) NewLine(depth);
+            out += ']';
+            return true;
+        }
+        if (Struct* obj = val.GetStruct()) {
+            if (depth >= MAX_DEPTH) return false;
+            out += '{';
+            bool first = true;
+            for (const auto& member : obj->GetMembers()) {
+                if (!first) out += ',';
+                first = false;
+                NewLine(depth + 1);
+                WriteString(member.first);
+                out += pretty ? ": " : ":";
+                if (!Write(member.second, depth + 1)) return false;
+            }
+            if (!first) NewLine(depth);
+            out += '}';
+            return true;
+        }
+
+        switch (val.GetType()) {
+            case Value::Type::REAL: WriteNumber(val.AsReal()); break;
+            case Value::Type::STRING: WriteString(val.GetStringRef()); break;
+            case Value::Type::BOOL: out += val.AsBool() ? "true" : "false"; break;
+            default: out += "null"; break;
+        }
+        return true;
+    }
+
+private:
+    void NewLine(size_t depth) {
+        if (!pretty) return;
+        out += '\n';
+        out.append(depth * 2, ' ');
+    }
+
+    void WriteNumber(double d) {
+        if (!std::isfinite(d)) {
+            out += "null";  // JSON has no NaN or infinity
+            return;
+        }
+        char buf[32];
+        char* last;
+        if (d == std::floor(d) && std::fabs(d) < 1e15) {
+            last = std::to_chars(buf, buf + sizeof(buf), (int64_t)d).ptr;
+        } else {
+            // Shortest representation that reads back to the same double
+            last = std::to_chars(buf, buf + sizeof(buf), d).ptr;
+        }
+        out.append(buf, last);
+    }
+
+    void WriteString(const std::string& str) {
+        out += '"';
+        const char* p = str.data();
+        const char* end = p + str.size();
+        for (;;) {
+            const char* run = p;
+            p += ScanPlain(p, (size_t)(end - p));
+            out.append(run, p);
+            if (p >= end) break;
+
+            unsigned char c = (unsigned char)*p++;
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default: {
+                    static const char hex[] = "0123456789abcdef";
+                    char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                    out.append(esc, sizeof(esc));
+                    break;
+                }
+            }
+        }
+        out += '"';
+    }
+
+    std::string& out;
+    bool pretty;
+};
+
+} // namespace
+
+namespace Json {
+
+bool Parse(const char* text, size_t length, Value& out, std::string* error) {
+    ValueBuilder builder;
+    Reader<ValueBuilder> reader(text, length, builder);
+    if (!reader.Run(error)) {
+        out = Value();
+        return false;
+    }
+    out = std::move(builder.GetRoot());
+    return true;
+}
+
+bool Stringify(const Value& val, std::string& out, bool pretty) {
+    Writer writer(out, pretty);
+    return writer.Write(val, 0);
+}
+
+} // namespace Json
+
+// ============================================================================
+// GML built-ins
+// ============================================================================
+
+void RegisterJsonBuiltins(VirtualMachine& vm) {
+    vm.RegisterBuiltIn("json_parse", [](const std::vector<Value>& args) {
+        if (args.empty()) return Value();
+        std::string error;
+        Value result;
+        bool ok = args[0].IsString() ? Json::Parse(args[0].GetStringRef(), result, &error)
+                                     : Json::Parse(args[0].AsString(), result, &error);
+        if (!ok) throw std::runtime_error("json_parse: " + error);
+        return result;
+    });
+    vm.RegisterBuiltIn("json_stringify", [](const std::vector<Value>& args) {
+        if (args.empty()) return Value(std::string());
+        bool pretty = args.size() > 1 && args[1].AsBool();
+        std::string out;
+        if (!Json::Stringify(args[0], out, pretty)) {
+            throw std::runtime_error("json_stringify: value is nested too deeply (circular reference?)");
+        }
+        return Value(out);
+    });
+}
+
+} // namespace GM
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/JsonCodec.h"
+#include "nlohmann/json.hpp"
+
+// Measures json_parse / json_stringify throughput on synthetic save data and
+// compares parsing against building an nlohmann DOM from the same text.
+
+using GM::Bench::TimeOp;
+
+// An autosave-like document: per-instance records, inventories and journal text
+static GM::Value MakeSaveData(int instances) {
+    GM::Value root = GM::Value::MakeStruct();
+    GM::Struct* save = root.GetStruct();
+    save->Set("version", GM::Value(3.0));
+    save->Set("room", GM::Value("rm_overworld"));
+    save->Set("playtime", GM::Value(48213.625));
+
+    GM::Value list = GM::Value::MakeArray();
+    for (int i = 0; i < instances; i++) {
+        GM::Value inst = GM::Value::MakeStruct();
+        GM::Struct* s = inst.GetStruct();
+        s->Set("id", GM::Value(100000.0 + i));
+        s->Set("object", GM::Value(i % 3 == 0 ? "obj_enemy" : "obj_chest"));
+        s->Set("x", GM::Value(i * 16.5));
+        s->Set("y", GM::Value(i * 0.125 - 300.0));
+        s->Set("hp", GM::Value((double)(i % 100)));
+        s->Set("active", GM::Value(i % 2 == 0));
+        s->Set("note", GM::Value(std::string("Found near the old mill, second \"shelf\" from the left; ") +
+                                 "keep for the quest line in chapter " + std::to_string(i % 12)));
+
+        GM::Value items = GM::Value::MakeArray();
+        for (int k = 0; k < 4; k++) {
+            items.GetArray()->push_back(GM::Value((double)((i * 7 + k) % 250)));
+        }
+        s->Set("items", items);
+        list.GetArray()->push_back(inst);
+    }
+    save->Set("instances", list);
+    return root;
+}
+
+int main() {
+    bool consistent = true;
+    for (int instances : { 2000, 40000 }) {
+        GM::Value data = MakeSaveData(instances);
+        std::string text;
+        GM::Json::Stringify(data, text);
+        double mb = text.size() / (1024.0 * 1024.0);
+        int iterations = instances <= 2000 ? 50 : 5;
+
+        std::cout << instances << " instances, " << std::fixed << std::setprecision(2) << mb
+                  << " MB of JSON (" << iterations << " iterations)" << std::endl;
+
+        double parse = TimeOp(iterations, [&] {
+            GM::Value parsed;
+            GM::Json::Parse(text, parsed);
+        });
+        std::string out;
+        double stringify = TimeOp(iterations, [&] {
+            out.clear();
+            GM::Json::Stringify(data, out);
+        });
+        double dom = TimeOp(iterations, [&] {
+            nlohmann::json doc = nlohmann::json::parse(text);
+        });
+
+        // The parsed document must reproduce the same text
+        GM::Value parsed;
+        std::string round_trip;
+        if (!GM::Json::Parse(text, parsed) || !GM::Json::Stringify(parsed, round_trip) || round_trip != text) {
+            consistent = false;
+        }
+
+        std::cout << std::setprecision(1);
+        std::cout << std::left << std::setw(18) << "json_parse" << std::right << std::setw(9) << mb / parse
+                  << " MB/s" << std::endl;
+        std::cout << std::left << std::setw(18) << "json_stringify" << std::right << std::setw(9) << mb / stringify
+                  << " MB/s" << std::endl;
+        std::cout << std::left << std::setw(18) << "nlohmann parse" << std::right << std::setw(9) << mb / dom
+                  << " MB/s" << std::endl << std::endl;
+    }
+
+    if (!consistent) {
+        std::cout << "FAILURE: JSON round trip mismatch" << std::endl;
+        return 1;
+    }
+    std::cout << "SUCCESS: JSON round trips" << std::endl;
+    return 0;
+}
@@ -1,6 +1,5 @@
 #include "Layer.h"
-#include "Instance.h"
-#include <algorithm>
+#include "Managers.h"
 
 namespace GM {
 
@@ -17,23 +16,41 @@ Layer::Layer(uint32_t id, const std::string& name, LayerType type)
 }
 
 Layer::~Layer() {
-    instances.clear();
+    while (first_instance) {
+        Unlink(first_instance);
+    }
 }
 
-void Layer::AddInstance(std::shared_ptr<Instance> inst) {
-    if (!inst) return;
-    auto it = std::find(instances.begin(), instances.end(), inst);
-    if (it == instances.end()) {
-        instances.push_back(inst);
+void Layer::AddInstance(InstanceHandle handle) {
+    Instance* inst = GameGlobals::Get().GetInstanceManager().Get(handle);
+    if (!inst || inst->layer == this) return;
+    if (inst->layer) {
+        inst->layer->Unlink(inst);
     }
+    inst->layer = this;
+    inst->layer_prev = last_instance;
+    inst->layer_next = nullptr;
+    if (last_instance) last_instance->layer_next = inst;
+    else first_instance = inst;
+    last_instance = inst;
+    instance_count++;
 }
 
-void Layer::RemoveInstance(std::shared_ptr<Instance> inst) {
-    if (!inst) return;
-    auto it = std::find(instances.begin(), instances.end(), inst);
-    if (it != instances.end()) {
-        instances.erase(it);
+void Layer::RemoveInstance(InstanceHandle handle) {
+    Instance* inst = GameGlobals::Get().GetInstanceManager().Get(handle);
+    if (inst && inst->layer == this) {
+        Unlink(inst);
     }
 }
 
+void Layer::Unlink(Instance* inst) {
+    if (inst->layer_prev) inst->layer_prev->layer_next = inst->layer_next;
+    else first_instance = inst->layer_next;
+    if (inst->layer_next) inst->layer_next->layer_prev = inst->layer_prev;
+    else last_instance = inst->layer_prev;
+    inst->layer = nullptr;
+    inst->layer_prev = inst->layer_next = nullptr;
+    instance_count--;
+}
+
 } // namespace GM
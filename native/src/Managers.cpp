@@ -1,4 +1,6 @@
 #include "Managers.h"
+#include "Collision.h"
+#include "VM_Executor.h"
 #include <algorithm>
 
 namespace GM {
@@ -35,6 +37,12 @@ std::shared_ptr<Object> ObjectManager::GetObject(uint32_t id) {
     return nullptr;
 }
 
+void ObjectManager::BuildDispatchTables() {
+    for (const auto& obj : objects) {
+        obj->BuildDispatchTable();
+    }
+}
+
 void ObjectManager::Clear() {
     objects.clear();
     object_map.clear();
@@ -48,39 +56,99 @@ InstanceManager::~InstanceManager() {
     Clear();
 }
 
-void InstanceManager::AddInstance(std::shared_ptr<Instance> inst) {
-    instance_map[inst->GetID()] = inst;
-    instances.push_back(inst);
+InstanceHandle InstanceManager::Create(double x, double y, uint32_t id, Object* object) {
+    InstanceTable::Pointer inst(pool.Create(x, y, id, object), InstancePool::Deleter{ &pool });
+    Instance* created = inst.get();
+    InstanceHandle handle = table.Create(std::move(inst));
+    if (handle == InstanceTable::INVALID_HANDLE) {
+        return INVALID_INSTANCE;
+    }
+    created->handle = handle;
+    Register(created);
+    return handle;
 }
 
-void InstanceManager::RemoveInstance(uint32_t id) {
-    auto it = instance_map.find(id);
-    if (it != instance_map.end()) {
-        auto inst = it->second;
-        instance_map.erase(it);
-        instances.erase(std::find(instances.begin(), instances.end(), inst));
+void InstanceManager::Adopt(InstancePool& built_in, const std::vector<Instance*>& built) {
+    pool.Adopt(built_in);
+    instances.reserve(instances.size() + built.size());
+    instance_map.reserve(instance_map.size() + built.size());
+    for (Instance* inst : built) {
+        table.Fill(inst->handle, InstanceTable::Pointer(inst, InstancePool::Deleter{ &pool }));
+        Register(inst);
     }
 }
 
-std::shared_ptr<Instance> InstanceManager::GetInstance(uint32_t id) {
+void InstanceManager::Register(Instance* inst) {
+    InstanceHandle handle = inst->handle;
+    inst->manager_index = (uint32_t)instances.size();
+    instances.push_back(handle);
+
+    auto id_it = instance_map.find(inst->id);
+    if (id_it != instance_map.end()) {
+        id_it->second = handle;
+    } else if (!spare_id_nodes.empty()) {
+        auto node = std::move(spare_id_nodes.back());
+        spare_id_nodes.pop_back();
+        node.key() = inst->id;
+        node.mapped() = handle;
+        instance_map.insert(std::move(node));
+    } else {
+        instance_map.emplace(inst->id, handle);
+    }
+    if (inst->object) {
+        inst->object->AddInstance(inst);
+    }
+}
+
+bool InstanceManager::Destroy(InstanceHandle handle) {
+    Instance* inst = table.Get(handle);
+    if (!inst) return false;
+
+    // Every container holds a back-reference, so unlinking is O(1)
+    if (inst->GetRoom()) {
+        inst->GetRoom()->Unlink(inst);
+    }
+    if (inst->GetLayer()) {
+        inst->GetLayer()->Unlink(inst);
+    }
+    if (inst->GetObject()) {
+        inst->GetObject()->RemoveInstance(inst);
+    }
+    auto id_it = instance_map.find(inst->GetID());
+    if (id_it != instance_map.end() && id_it->second == handle) {
+        spare_id_nodes.push_back(instance_map.extract(id_it));
+    }
+
+    // Swap-and-pop out of the dense list
+    InstanceHandle last = instances.back();
+    instances[inst->manager_index] = last;
+    table.Get(last)->manager_index = inst->manager_index;
+    instances.pop_back();
+
+    return table.Destroy(handle);
+}
+
+InstanceHandle InstanceManager::FindByID(uint32_t id) const {
     auto it = instance_map.find(id);
     if (it != instance_map.end()) {
         return it->second;
     }
-    return nullptr;
+    return INVALID_INSTANCE;
 }
 
 void InstanceManager::Update() {
-    for (auto& inst : instances) {
+    for (size_t i = 0; i < instances.size(); i++) {
+        Instance* inst = table.Get(instances[i]);
         if (inst->GetActive()) {
             inst->StepEvent(StepEventType::NormalStep);
         }
     }
-    RemoveMarked();
+    ApplyPending();
 }
 
 void InstanceManager::Draw() {
-    for (auto& inst : instances) {
+    for (InstanceHandle handle : instances) {
+        Instance* inst = table.Get(handle);
         if (inst->GetVisible()) {
             inst->DrawEvent();
         }
@@ -88,28 +156,123 @@ void InstanceManager::Draw() {
 }
 
 void InstanceManager::Clear() {
-    instances.clear();
+    while (!instances.empty()) {
+        Destroy(instances.back());
+    }
     instance_map.clear();
+    spare_id_nodes.clear();
+    pending.clear();
+    apply_index = 0;
 }
 
 void InstanceManager::TriggerEvent(EventType type, int subType) {
-    for (auto& inst : instances) {
-        inst->TriggerEvent(type, subType);
-    }
-}
-
-void InstanceManager::RemoveMarked() {
-    instances.erase(
-        std::remove_if(instances.begin(), instances.end(),
-            [this](const std::shared_ptr<Instance>& inst) {
-                if (inst->IsMarked()) {
-                    instance_map.erase(inst->GetID());
-                    return true;
-                }
-                return false;
-            }),
-        instances.end()
-    );
+    for (size_t i = 0; i < instances.size(); i++) {
+        table.Get(instances[i])->TriggerEvent(type, subType);
+    }
+}
+
+void InstanceManager::QueueDestroy(InstanceHandle handle) {
+    pending.push_back({ PendingChange::Kind::Destroy, false, handle, nullptr, nullptr });
+}
+
+void InstanceManager::QueueJoin(InstanceHandle handle, Room* room) {
+    pending.push_back({ PendingChange::Kind::Join, false, handle, room, nullptr });
+}
+
+void InstanceManager::QueueChangeObject(InstanceHandle handle, Object* object, bool perform_events) {
+    pending.push_back({ PendingChange::Kind::ChangeObject, perform_events, handle, nullptr, object });
+}
+
+void InstanceManager::ApplyPending() {
+    // Indexed, as the events an object change runs may queue more
+    for (; apply_index < pending.size(); apply_index++) {
+        PendingChange change = pending[apply_index];
+        if (change.kind == PendingChange::Kind::Join) {
+            if (change.room) {
+                change.room->queued_joins--;
+                change.room->AddInstance(change.handle);
+            }
+            continue;
+        }
+
+        Instance* inst = table.Get(change.handle);
+        if (!inst) continue;
+        if (change.kind == PendingChange::Kind::Destroy) {
+            // Room::ApplyActive queues it again on activation
+            if (inst->GetActive() || !inst->GetRoom()) Destroy(change.handle);
+            continue;
+        }
+
+        if (change.perform_events) {
+            inst->DestroyEvent();
+            if (!(inst = table.Get(change.handle))) continue;
+        }
+        if (inst->GetRoom()) inst->GetRoom()->ChangeObject(inst, change.object);
+        else inst->SetObject(change.object);
+        if (change.perform_events) inst->CreateEvent();
+    }
+    pending.clear();
+    apply_index = 0;
+}
+
+void InstanceManager::DropJoins(Room* room, bool destroy) {
+    for (size_t i = apply_index; i < pending.size(); i++) {
+        PendingChange& change = pending[i];
+        if (change.kind != PendingChange::Kind::Join || change.room != room) continue;
+        change.room = nullptr;
+        if (destroy) Destroy(change.handle);
+    }
+}
+
+void RegisterInstanceBuiltins(VirtualMachine& vm, InstanceManager& manager) {
+    using Args = std::vector<Value>;
+    auto handle_arg = [](const Args& args) {
+        double v = args.empty() ? -1.0 : args[0].AsReal();
+        return (v >= 0 && v <= 9007199254740992.0) ? (InstanceHandle)v : INVALID_INSTANCE;
+    };
+    vm.RegisterBuiltIn("instance_exists", [&manager, handle_arg](const Args& args) {
+        return Value(manager.Exists(handle_arg(args)));
+    });
+    vm.RegisterBuiltIn("instance_destroy", [&manager, handle_arg](const Args& args) {
+        // Destruction is deferred to the end of the step, as in the runner
+        if (Instance* inst = manager.Get(handle_arg(args))) {
+            inst->Mark();
+        }
+        return Value();
+    });
+    vm.RegisterBuiltIn("instance_count", [&manager](const Args&) {
+        return Value((double)manager.Count());
+    });
+}
+
+void RegisterObjectBuiltins(VirtualMachine& vm, ObjectManager& objects, RoomManager& rooms) {
+    using Args = std::vector<Value>;
+    auto arg = [](const Args& args, size_t i) { return i < args.size() ? args[i].AsReal() : 0.0; };
+
+    // The object an argument names, null for `all`; false if it names none,
+    // including NaN and reals past the 32-bit id range
+    auto object_arg = [&objects](double v, Object*& out) {
+        out = nullptr;
+        if (!(v > -2147483649.0 && v < 4294967296.0)) return false;
+        if ((int64_t)v == Collision::OBJECT_ALL) return true;
+        if (v < 0) return false;
+        out = objects.GetObject((uint32_t)v).get();
+        return out != nullptr;
+    };
+    vm.RegisterBuiltIn("instance_number", [&rooms, arg, object_arg](const Args& args) {
+        auto room = rooms.GetCurrentRoom();
+        Object* obj;
+        if (!room || !object_arg(arg(args, 0), obj)) return Value(0.0);
+        return Value((double)room->CountInstances(obj));
+    });
+    vm.RegisterBuiltIn("instance_find", [&rooms, arg, object_arg](const Args& args) {
+        auto room = rooms.GetCurrentRoom();
+        Object* obj;
+        double n = arg(args, 1);
+        if (!room || !object_arg(arg(args, 0), obj) || n < 0) return Value(Collision::NOONE);
+        Instance* inst = room->FindInstanceOf(obj, (size_t)n);
+        return Value(inst ? (double)inst->GetHandle() : Collision::NOONE);
+    });
 }
 
 // RoomManager
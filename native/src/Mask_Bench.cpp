@@ -0,0 +1,162 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/Broadphase.h"
+#include "../include/CollisionMask.h"
+#include "../include/Random.h"
+#include "../include/SimdDispatch.h"
+
+// Cost of one precise instance-vs-instance test against the bbox test it
+// refines, for typical sprite sizes, rotated sampling and wide masks at
+// every SIMD level. Every level is checked against a brute-force
+// per-pixel reference.
+
+using GM::Bench::TimeOp;
+
+// A ring, so overlapping bboxes often have no overlapping pixels
+static GM::CollisionMask Ring(uint32_t size) {
+    GM::CollisionMask mask(size, size);
+    double c = size / 2.0, outer = size / 2.0, inner = size / 3.0;
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            double dx = x + 0.5 - c, dy = y + 0.5 - c;
+            double d2 = dx * dx + dy * dy;
+            if (d2 < outer * outer && d2 >= inner * inner) mask.Set(x, y, true);
+        }
+    }
+    mask.UpdateBounds();
+    return mask;
+}
+
+struct Pair {
+    GM::MaskPlacement a, b;
+};
+
+// Placements whose bboxes overlap, the case where the precise test runs
+static std::vector<Pair> MakePairs(const GM::CollisionMask& mask, bool transformed, uint32_t seed) {
+    GM::RandomGenerator rng(seed);
+    std::vector<Pair> pairs;
+    double size = mask.GetWidth();
+    for (int i = 0; i < 1000; i++) {
+        Pair p;
+        p.a.mask = p.b.mask = &mask;
+        p.a.x = 1000 + rng.IRange(0, 63);
+        p.a.y = 1000 + rng.IRange(0, 63);
+        p.b.x = p.a.x + rng.IRange(-(int)size + 1, (int)size - 1);
+        p.b.y = p.a.y + rng.IRange(-(int)size + 1, (int)size - 1);
+        if (transformed) {
+            p.b.xorigin = p.b.yorigin = size / 2;
+            p.b.x += size / 2;
+            p.b.y += size / 2;
+            p.b.angle = rng.Range(0, 360);
+            p.b.xscale = p.b.yscale = rng.Range(0.75, 1.25);
+        }
+        pairs.push_back(p);
+    }
+    return pairs;
+}
+
+// Whether the room pixel centered at (px, py) maps onto a solid mask pixel,
+// through the placement's inverse transform worked out directly
+static bool SolidAt(const GM::MaskPlacement& p, double px, double py) {
+    double r = p.angle * 3.14159265358979323846 / 180.0;
+    double c = std::cos(r), s = std::sin(r);
+    double dx = px - p.x, dy = py - p.y;
+    double u = (c * dx - s * dy) / p.xscale + p.xorigin;
+    double v = (s * dx + c * dy) / p.yscale + p.yorigin;
+    return p.mask->Get((int32_t)std::floor(u), (int32_t)std::floor(v));
+}
+
+// Room-space box around the whole mask (not just its solid pixels)
+static GM::Rect Extent(const GM::MaskPlacement& p) {
+    double r = p.angle * 3.14159265358979323846 / 180.0;
+    double c = std::cos(r), s = std::sin(r);
+    GM::Rect box = { 1e300, 1e300, -1e300, -1e300 };
+    for (double u : { 0.0, (double)p.mask->GetWidth() }) {
+        for (double v : { 0.0, (double)p.mask->GetHeight() }) {
+            double lx = (u - p.xorigin) * p.xscale, ly = (v - p.yorigin) * p.yscale;
+            double wx = p.x + c * lx + s * ly, wy = p.y - s * lx + c * ly;
+            box = { std::min(box.x1, wx), std::min(box.y1, wy), std::max(box.x2, wx), std::max(box.y2, wy) };
+        }
+    }
+    return box;
+}
+
+// Tests every room pixel both masks might cover, one at a time
+static bool ReferenceOverlap(const Pair& p) {
+    GM::Rect ea = Extent(p.a), eb = Extent(p.b);
+    int64_t x0 = (int64_t)std::floor(std::max(ea.x1, eb.x1)) - 1, x1 = (int64_t)std::ceil(std::min(ea.x2, eb.x2)) + 1;
+    int64_t y0 = (int64_t)std::floor(std::max(ea.y1, eb.y1)) - 1, y1 = (int64_t)std::ceil(std::min(ea.y2, eb.y2)) + 1;
+    for (int64_t j = y0; j < y1; j++) {
+        for (int64_t i = x0; i < x1; i++) {
+            if (SolidAt(p.a, i + 0.5, j + 0.5) && SolidAt(p.b, i + 0.5, j + 0.5)) return true;
+        }
+    }
+    return false;
+}
+
+int main() {
+    std::vector<GM::SimdLevel> levels = { GM::SimdLevel::Scalar };
+    if ((int)GM::GetDetectedSimdLevel() >= (int)GM::SimdLevel::SSE2) levels.push_back(GM::SimdLevel::SSE2);
+    if ((int)GM::GetDetectedSimdLevel() >= (int)GM::SimdLevel::AVX2) levels.push_back(GM::SimdLevel::AVX2);
+    std::cout << "Detected SIMD level: " << GM::SimdLevelName(GM::GetDetectedSimdLevel()) << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(24) << "case" << std::right << std::setw(12) << "bbox";
+    for (auto level : levels) std::cout << std::setw(12) << GM::SimdLevelName(level);
+    std::cout << std::setw(10) << "hits" << std::endl;
+
+    bool consistent = true, exact = true;
+    struct Case { const char* name; uint32_t size; bool transformed; };
+    for (const Case& c : { Case{ "16px aligned", 16, false }, Case{ "32px aligned", 32, false },
+                           Case{ "64px aligned", 64, false }, Case{ "32px rotated+scaled", 32, true },
+                           Case{ "512px aligned", 512, false } }) {
+        GM::CollisionMask mask = Ring(c.size);
+        std::vector<Pair> pairs = MakePairs(mask, c.transformed, c.size);
+        int iterations = c.size >= 512 ? 20 : 200;
+
+        // The reference is slow on wide masks, so those are spot-checked
+        size_t check_step = c.size >= 512 ? 25 : 1;
+        std::vector<bool> reference(pairs.size());
+        for (size_t i = 0; i < pairs.size(); i += check_step) reference[i] = ReferenceOverlap(pairs[i]);
+
+        size_t bbox_hits = 0;
+        double bbox = TimeOp(iterations, [&] {
+            bbox_hits = 0;
+            for (const Pair& p : pairs) bbox_hits += GM::BoxOverlaps(p.a.GetBounds(), p.b.GetBounds());
+        });
+
+        std::vector<double> times;
+        std::vector<size_t> hits;
+        for (auto level : levels) {
+            GM::SetSimdLevel(level);
+            size_t count = 0;
+            times.push_back(TimeOp(iterations, [&] {
+                count = 0;
+                for (const Pair& p : pairs) count += GM::MasksOverlap(p.a, p.b);
+            }));
+            hits.push_back(count);
+            for (size_t i = 0; i < pairs.size(); i += check_step) {
+                if (GM::MasksOverlap(pairs[i].a, pairs[i].b) != reference[i]) exact = false;
+            }
+        }
+        for (size_t h : hits) {
+            if (h != hits[0]) consistent = false;
+        }
+
+        std::cout << std::left << std::setw(24) << c.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(9) << bbox * 1e9 / pairs.size() << " ns";
+        for (double t : times) std::cout << std::setw(9) << t * 1e9 / pairs.size() << " ns";
+        std::cout << std::setw(6) << hits[0] << "/" << bbox_hits << std::endl;
+    }
+
+    GM::SetSimdLevel(GM::GetDetectedSimdLevel());
+    if (!consistent || !exact) {
+        std::cout << std::endl << (consistent ? "FAILURE: masks disagree with the per-pixel reference"
+                                              : "FAILURE: SIMD levels disagree") << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: all SIMD levels agree with the per-pixel reference" << std::endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/InstanceStore.h"
+#include "../include/Random.h"
+#include "../include/SimdDispatch.h"
+
+// Times the builtin motion pass (friction, gravity, position) over a room
+// full of bullets at every SIMD level, against the old per-step trig loop.
+
+using GM::Bench::TimeOp;
+
+// Bullets with mixed gravity and friction; every tenth one is deactivated
+static void Populate(GM::InstanceStore& store, size_t count) {
+    GM::RandomGenerator rng(1234);
+    store.Reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t row = store.Allocate(nullptr);
+        store.x[row] = rng.Range(0, 4096);
+        store.y[row] = rng.Range(0, 4096);
+        store.hspeed[row] = rng.Range(-8, 8);
+        store.vspeed[row] = rng.Range(-8, 8);
+        if (i % 3 == 0) {
+            store.gravity[row] = rng.Range(0, 0.5);
+            store.SetGravityDirection(row, (double)rng.IRange(0, 359));
+        }
+        if (i % 4 == 0) store.friction[row] = rng.Range(0, 0.2);
+        store.SetFlag(row, GM::InstanceStore::FLAG_ACTIVE, i % 10 != 0);
+    }
+}
+
+// The pre-SoA integrator: sin/cos of the gravity direction on every step
+static void LegacyMotion(GM::InstanceStore& s) {
+    for (size_t i = 0; i < s.Size(); i++) {
+        if (!s.HasFlag((uint32_t)i, GM::InstanceStore::FLAG_ACTIVE)) continue;
+        if (s.friction[i] > 0) {
+            double speed_mag = std::sqrt(s.hspeed[i] * s.hspeed[i] + s.vspeed[i] * s.vspeed[i]);
+            double factor = speed_mag > s.friction[i] ? 1.0 - s.friction[i] / speed_mag : 0.0;
+            s.hspeed[i] *= factor;
+            s.vspeed[i] *= factor;
+        }
+        if (s.gravity[i] != 0) {
+            double angle_rad = s.gravity_direction[i] * 3.14159265359 / 180.0;
+            s.vspeed[i] -= s.gravity[i] * std::sin(angle_rad);
+            s.hspeed[i] += s.gravity[i] * std::cos(angle_rad);
+        }
+        s.x[i] += s.hspeed[i];
+        s.y[i] += s.vspeed[i];
+    }
+}
+
+int main() {
+    std::vector<GM::SimdLevel> levels = { GM::SimdLevel::Scalar };
+    if ((int)GM::GetDetectedSimdLevel() >= (int)GM::SimdLevel::SSE2) levels.push_back(GM::SimdLevel::SSE2);
+    if ((int)GM::GetDetectedSimdLevel() >= (int)GM::SimdLevel::AVX2) levels.push_back(GM::SimdLevel::AVX2);
+
+    std::cout << "Detected SIMD level: " << GM::SimdLevelName(GM::GetDetectedSimdLevel()) << std::endl;
+    std::cout << std::endl << std::left << std::setw(12) << "instances" << std::right << std::setw(14) << "legacy";
+    for (auto level : levels) std::cout << std::right << std::setw(14) << GM::SimdLevelName(level);
+    std::cout << std::endl;
+
+    bool consistent = true;
+    for (size_t count : { 1000u, 10000u, 100000u }) {
+        int iterations = (int)(2000000 / count);
+
+        GM::InstanceStore legacy;
+        Populate(legacy, count);
+        double legacy_time = TimeOp(iterations, [&] { LegacyMotion(legacy); });
+
+        std::vector<double> times;
+        std::vector<std::vector<double>> results;
+        for (auto level : levels) {
+            GM::SetSimdLevel(level);
+            GM::InstanceStore store;
+            Populate(store, count);
+            times.push_back(TimeOp(iterations, [&] { store.ApplyMotion(); }));
+
+            // Same start state and step count must land every level on the same bits
+            GM::InstanceStore check;
+            Populate(check, count);
+            for (int step = 0; step < 60; step++) check.ApplyMotion();
+            std::vector<double> state;
+            for (auto* column : { &check.x, &check.y, &check.hspeed, &check.vspeed, &check.xprevious }) {
+                state.insert(state.end(), column->begin(), column->end());
+            }
+            results.push_back(state);
+        }
+        for (auto& r : results) {
+            if (r != results[0]) consistent = false;
+        }
+
+        std::cout << std::left << std::setw(12) << count << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(11) << legacy_time * 1e6 << " us";
+        for (double t : times) std::cout << std::setw(11) << t * 1e6 << " us";
+        std::cout << std::endl;
+    }
+
+    // Friction applies before gravity, and x moves by the updated speed:
+    // 2 - 0.5 friction + 1 gravity = 2.5, for every level and the scalar tail
+    for (auto level : levels) {
+        GM::SetSimdLevel(level);
+        GM::InstanceStore order;
+        for (int i = 0; i < 5; i++) {
+            uint32_t row = order.Allocate(nullptr);
+            order.hspeed[row] = 2;
+            order.friction[row] = 0.5;
+            order.gravity[row] = 1;
+            order.SetGravityDirection(row, 0);
+            order.SetFlag(row, GM::InstanceStore::FLAG_ACTIVE, true);
+        }
+        order.ApplyMotion();
+        for (int i = 0; i < 5; i++) {
+            if (order.x[i] != 2.5 || order.hspeed[i] != 2.5) consistent = false;
+        }
+    }
+
+    GM::SetSimdLevel(GM::GetDetectedSimdLevel());
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: SIMD levels disagree or apply motion out of order" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: all SIMD levels agree" << std::endl;
+    return 0;
+}
@@ -1,42 +1,110 @@
 #include "Object.h"
+#include "Managers.h"
 #include <algorithm>
 
 namespace GM {
 
+uint32_t Object::event_generation = 1;
+uint32_t Object::hierarchy_generation = 1;
+
 Object::Object(uint32_t id, const std::string& name)
     : id(id), name(name) {
 }
 
 Object::~Object() {
-    instances.clear();
+    if (parent) {
+        auto& siblings = parent->children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+    }
+    // Ancestors' cached descendant sets and dispatch tables may still list this object
+    event_generation++;
+    hierarchy_generation++;
+
+    // Leave surviving instances with consistent (empty) links
+    for (Instance* inst = first_instance; inst;) {
+        Instance* next = inst->object_next;
+        inst->object_prev = inst->object_next = nullptr;
+        inst = next;
+    }
+}
+
+void Object::AddInstance(Instance* inst) {
+    // Append so walking the list visits instances in creation order
+    inst->object_prev = last_instance;
+    inst->object_next = nullptr;
+    if (last_instance) last_instance->object_next = inst;
+    else first_instance = inst;
+    last_instance = inst;
+    instance_count++;
 }
 
-void Object::AddInstance(std::shared_ptr<Instance> inst) {
-    auto it = std::find(instances.begin(), instances.end(), inst);
-    if (it == instances.end()) {
-        instances.push_back(inst);
+void Object::RemoveInstance(Instance* inst) {
+    if (inst->object_prev) inst->object_prev->object_next = inst->object_next;
+    else first_instance = inst->object_next;
+    if (inst->object_next) inst->object_next->object_prev = inst->object_prev;
+    else last_instance = inst->object_prev;
+    inst->object_prev = inst->object_next = nullptr;
+    instance_count--;
+}
+
+void Object::SetParent(std::shared_ptr<Object> p) {
+    if (parent) {
+        auto& siblings = parent->children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), this));
     }
+    parent = std::move(p);
+    if (parent) parent->children.push_back(this);
+    event_generation++;
+    hierarchy_generation++;
 }
 
-void Object::RemoveInstance(std::shared_ptr<Instance> inst) {
-    auto it = std::find(instances.begin(), instances.end(), inst);
-    if (it != instances.end()) {
-        instances.erase(it);
+const std::vector<Object*>& Object::GetDescendants() {
+    if (descendants_generation != hierarchy_generation) {
+        // Breadth first, so parents come before their children
+        descendants.assign(1, this);
+        for (size_t i = 0; i < descendants.size(); i++) {
+            const auto& next = descendants[i]->children;
+            descendants.insert(descendants.end(), next.begin(), next.end());
+        }
+        descendants_generation = hierarchy_generation;
     }
+    return descendants;
 }
 
-void Object::SetEventCallback(EventType type, int subType, EventCallback callback) {
-    event_callbacks[(int)type][subType] = callback;
+void Object::SetEventCallback(EventType type, int subType, EventCallback callback, bool self_only) {
+    event_callbacks[(int)type][subType] = { std::move(callback), self_only };
+    event_generation++;
 }
 
-void Object::TriggerEvent(Instance* inst, EventType type, int subType) {
-    auto type_it = event_callbacks.find((int)type);
-    if (type_it != event_callbacks.end()) {
-        auto subtype_it = type_it->second.find(subType);
-        if (subtype_it != type_it->second.end()) {
-            subtype_it->second(inst);
+void Object::BuildDispatchTable() {
+    // Start from the parent's resolved table, then lay our own handlers over it
+    if (parent) {
+        if (parent->dispatch_generation != event_generation) parent->BuildDispatchTable();
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) dispatch[t] = parent->dispatch[t];
+        handled_events = parent->handled_events;
+        collision_targets = parent->collision_targets;
+    } else {
+        for (auto& row : dispatch) row.clear();
+        handled_events = 0;
+        collision_targets.clear();
+    }
+
+    for (const auto& [type, handlers] : event_callbacks) {
+        if (type < 0 || type >= EVENT_TYPE_COUNT) continue;
+        auto& row = dispatch[type];
+        for (const auto& [subType, handler] : handlers) {
+            if (subType < 0 || !handler.callback) continue;
+            if ((size_t)subType >= row.size()) row.resize(subType + 1, nullptr);
+            row[subType] = &handler;
+            handled_events |= 1u << type;
+
+            if (type == (int)EventType::Collision &&
+                std::find(collision_targets.begin(), collision_targets.end(), subType) == collision_targets.end()) {
+                collision_targets.push_back(subType);
+            }
         }
     }
+    dispatch_generation = event_generation;
 }
 
 Variant Object::GetVariable(const std::string& name) const {
@@ -51,10 +119,8 @@ void Object::SetVariable(const std::string& name, const Variant& value) {
     variables[name] = value;
 }
 
-std::shared_ptr<Instance> Object::CreateInstance(double x, double y, uint32_t id) {
-    auto inst = std::make_shared<Instance>(x, y, id, shared_from_this());
-    AddInstance(inst);
-    return inst;
+InstanceHandle Object::CreateInstance(double x, double y, uint32_t id) {
+    return GameGlobals::Get().GetInstanceManager().Create(x, y, id, this);
 }
 
 } // namespace GM
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include "../include/GameEngine.h"
+#include "../include/Object.h"
+#include "../include/Sprite.h"
+#include "../include/Random.h"
+#include "../include/Bench.h"
+
+// Going from a small title room to a large level built from asset data.
+// The level is entered once cold, building it on the spot, and once after
+// PrefetchRoom built it in the background while the title room kept
+// stepping. Both must come out the same.
+
+using GM::Bench::Clock;
+using GM::Bench::Seconds;
+
+static std::vector<double> drawn;  // Draw events in the order they ran
+
+// What a level looks like once entered: every instance's placement,
+// object and bbox in room order, the event list sizes, what a few
+// broadphase queries find and the draw order
+static std::vector<double> Describe(GM::Room& room, GM::InstanceManager& manager) {
+    std::vector<double> state;
+    for (GM::InstanceHandle handle : room.GetInstances()) {
+        if (GM::Instance* inst = manager.Get(handle)) {
+            const GM::Rect& box = inst->GetBBox();
+            state.insert(state.end(), { inst->GetX(), inst->GetY(), (double)inst->GetObjectIndex(),
+                                        (double)inst->GetAlarm(0), box.x1, box.y1, box.x2, box.y2 });
+        }
+    }
+    for (int list = 0; list < (int)GM::Room::EventList::Count; list++) {
+        state.push_back((double)room.GetSubscribers((GM::Room::EventList)list).size());
+    }
+    for (int i = 0; i < 64; i++) {
+        double x = i * 251.0, y = i * 127.0;
+        size_t hits = 0;
+        room.QueryCollision({ x, y, x + 512, y + 512 }, [&](GM::InstanceHandle, const GM::Rect&) {
+            hits++;
+            return true;
+        });
+        state.push_back((double)hits);
+    }
+    drawn.clear();
+    room.Draw();
+    state.insert(state.end(), drawn.begin(), drawn.end());
+    return state;
+}
+
+int main() {
+    constexpr double WORLD_SIZE = 16384;
+    constexpr uint32_t OBJECTS = 16;
+
+    GM::GameEngine engine(nullptr);
+    auto& globals = engine.GetGlobals();
+    auto& manager = globals.GetInstanceManager();
+
+    for (uint32_t i = 1; i <= 4; i++) {
+        auto sprite = std::make_shared<GM::Sprite>(i, "spr_" + std::to_string(i));
+        sprite->SetBBox({ 0, 0, 16.0 * i, 16.0 * i });
+        globals.GetSpriteManager().AddSprite(sprite);
+    }
+    for (uint32_t i = 1; i <= OBJECTS; i++) {
+        auto obj = std::make_shared<GM::Object>(i, "obj_" + std::to_string(i));
+        obj->SetSpriteIndex(i % 5);
+        obj->SetDepth((double)(i % 3) * 100);
+        if (i % 2) obj->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep, [](GM::Instance*) {});
+        obj->SetEventCallback(GM::EventType::Create, 0, [](GM::Instance* inst) {
+            inst->SetAlarm(0, 30 + (int)inst->GetX() % 60);
+        });
+        obj->SetEventCallback(GM::EventType::Draw, 0, [](GM::Instance* inst) { drawn.push_back(inst->GetX()); });
+        globals.GetObjectManager().AddObject(obj);
+    }
+
+    auto title = std::make_shared<GM::Room>(0, "rm_title");
+    globals.GetRoomManager().AddRoom(title);
+    for (uint32_t i = 0; i < 100; i++) {
+        title->AddPlacement({ 1 + i, 1 + i % OBJECTS, (double)(i % 10) * 64, (double)(i / 10) * 64 });
+    }
+    engine.SwitchRoom(0, true);
+
+    std::cout << std::left << std::setw(12) << "instances" << std::right << std::setw(14) << "cold enter"
+              << std::setw(14) << "prefetch" << std::setw(10) << "frames" << std::setw(16) << "warm enter"
+              << std::endl;
+
+    bool consistent = true;
+    uint32_t next_room = 1;
+    for (size_t count : { 20000u, 100000u }) {
+        // The same level twice: one entered cold, one prefetched
+        std::shared_ptr<GM::Room> levels[2];
+        for (auto& level : levels) {
+            level = std::make_shared<GM::Room>(next_room, "rm_level" + std::to_string(next_room));
+            next_room++;
+            level->SetWidth((uint32_t)WORLD_SIZE);
+            level->SetHeight((uint32_t)WORLD_SIZE);
+            GM::RandomGenerator rng(11);
+            for (size_t i = 0; i < count; i++) {
+                level->AddPlacement({ 1000 + (uint32_t)i, (uint32_t)rng.IRange(1, OBJECTS),
+                                      rng.Range(0, WORLD_SIZE), rng.Range(0, WORLD_SIZE) });
+            }
+            globals.GetRoomManager().AddRoom(level);
+        }
+
+        auto start = Clock::now();
+        engine.SwitchRoom(levels[0]->GetID());
+        double cold_time = Seconds(start);
+        std::vector<double> cold_state = Describe(*levels[0], manager);
+        engine.SwitchRoom(title->GetID());
+
+        // The title room keeps stepping while the level builds
+        start = Clock::now();
+        engine.PrefetchRoom(levels[1]->GetID());
+        int frames = 0;
+        while (!engine.IsRoomPrefetched(levels[1]->GetID())) {
+            engine.Update();
+            frames++;
+        }
+        double prefetch_time = Seconds(start);
+
+        start = Clock::now();
+        engine.SwitchRoom(levels[1]->GetID());
+        double warm_time = Seconds(start);
+        if (Describe(*levels[1], manager) != cold_state) consistent = false;
+        engine.SwitchRoom(title->GetID());
+
+        std::cout << std::left << std::setw(12) << count << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(11) << cold_time * 1e3 << " ms" << std::setw(11) << prefetch_time * 1e3
+                  << " ms" << std::setw(10) << frames << std::setw(13) << warm_time * 1e3 << " ms" << std::endl;
+
+        for (auto& level : levels) {
+            level->Clear();
+            globals.GetRoomManager().RemoveRoom(level->GetID());
+        }
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: a prefetched room differs from one built on entry" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: prefetched rooms match rooms built on entry" << std::endl;
+    return 0;
+}
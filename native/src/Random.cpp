@@ -0,0 +1,150 @@
+#include "../include/Random.h"
+#include "../include/Buffer.h"
+#include "../include/VM_Executor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace GM {
+
+void RandomGenerator::Seed(uint64_t seed) {
+    state.seed = seed;
+    uint64_t x = seed;
+    for (uint64_t& word : state.s) {
+        // splitmix64; never yields an all-zero xoshiro state
+        x += 0x9E3779B97F4A7C15ull;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        word = z ^ (z >> 31);
+    }
+}
+
+uint64_t RandomGenerator::MaskFor(uint64_t span) {
+    uint64_t mask = span;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    mask |= mask >> 32;
+    return mask;
+}
+
+int64_t RandomGenerator::IRange(int64_t lo, int64_t hi) {
+    if (lo > hi) std::swap(lo, hi);
+    uint64_t span = (uint64_t)hi - (uint64_t)lo;
+    if (span == 0) return lo;
+    return (int64_t)((uint64_t)lo + Bounded(span, MaskFor(span)));
+}
+
+void RandomGenerator::Fill(double* out, size_t count, double lo, double hi) {
+    // Work on a local copy so the state stays in registers across the loop
+    RandomGenerator local = *this;
+    double scale = hi - lo;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = lo + scale * local.NextDouble();
+    }
+    state = local.state;
+}
+
+void RandomGenerator::Fill(float* out, size_t count, float lo, float hi) {
+    RandomGenerator local = *this;
+    float scale = hi - lo;
+    for (size_t i = 0; i < count; i++) {
+        // 24 bits is a float's full mantissa
+        out[i] = lo + scale * ((float)(local.NextU64() >> 40) * (1.0f / 16777216.0f));
+    }
+    state = local.state;
+}
+
+void RandomGenerator::FillInt(int32_t* out, size_t count, int64_t lo, int64_t hi) {
+    if (lo > hi) std::swap(lo, hi);
+    uint64_t span = (uint64_t)hi - (uint64_t)lo;
+    RandomGenerator local = *this;
+    if (span == 0) {
+        for (size_t i = 0; i < count; i++) out[i] = (int32_t)lo;
+        return;
+    }
+    uint64_t mask = MaskFor(span);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (int32_t)((uint64_t)lo + local.Bounded(span, mask));
+    }
+    state = local.state;
+}
+
+bool RandomGenerator::Save(Buffer& buffer) const {
+    if (buffer.Write(state.seed) != BufferResult::Ok) return false;
+    for (uint64_t word : state.s) {
+        if (buffer.Write(word) != BufferResult::Ok) return false;
+    }
+    return true;
+}
+
+bool RandomGenerator::Load(Buffer& buffer) {
+    RandomState loaded;
+    if (!buffer.Read(loaded.seed)) return false;
+    for (uint64_t& word : loaded.s) {
+        if (!buffer.Read(word)) return false;
+    }
+    state = loaded;
+    return true;
+}
+
+// ============================================================================
+// GML built-ins
+// ============================================================================
+
+namespace {
+
+using Args = std::vector<Value>;
+
+double ArgReal(const Args& args, size_t i) {
+    return i < args.size() ? args[i].AsReal() : 0.0;
+}
+
+// GML rounds irandom bounds to the nearest integer
+int64_t ArgRounded(const Args& args, size_t i) {
+    double v = std::round(ArgReal(args, i));
+    if (std::isnan(v)) return 0;
+    return (int64_t)std::max(-9.0e18, std::min(9.0e18, v));
+}
+
+} // namespace
+
+void RegisterRandomBuiltins(VirtualMachine& vm, RandomGenerator& rng) {
+    vm.RegisterBuiltIn("random", [&rng](const Args& args) {
+        return Value(rng.Range(0.0, ArgReal(args, 0)));
+    });
+    vm.RegisterBuiltIn("random_range", [&rng](const Args& args) {
+        return Value(rng.Range(ArgReal(args, 0), ArgReal(args, 1)));
+    });
+    vm.RegisterBuiltIn("irandom", [&rng](const Args& args) {
+        return Value((double)rng.IRange(0, ArgRounded(args, 0)));
+    });
+    vm.RegisterBuiltIn("irandom_range", [&rng](const Args& args) {
+        return Value((double)rng.IRange(ArgRounded(args, 0), ArgRounded(args, 1)));
+    });
+    vm.RegisterBuiltIn("choose", [&rng](const Args& args) {
+        if (args.empty()) return Value();
+        return args[(size_t)rng.IRange(0, (int64_t)args.size() - 1)];
+    });
+    vm.RegisterBuiltIn("random_set_seed", [&rng](const Args& args) {
+        rng.Seed((uint64_t)ArgRounded(args, 0));
+        return Value();
+    });
+    vm.RegisterBuiltIn("random_get_seed", [&rng](const Args&) {
+        return Value((double)(int64_t)rng.GetSeed());
+    });
+    vm.RegisterBuiltIn("randomize", [&rng](const Args&) {
+        // 32-bit seeds survive the round trip through a GML real
+        std::random_device device;
+        uint64_t entropy = (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+        uint32_t seed = (uint32_t)(device() ^ entropy ^ (entropy >> 32));
+        rng.Seed(seed);
+        return Value((double)seed);
+    });
+}
+
+} // namespace GM
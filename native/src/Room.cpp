@@ -1,59 +1,604 @@
 #include "Room.h"
+#include "IRenderer.h"
+#include "Managers.h"
+#include "Tilemap.h"
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 namespace GM {
 
 Room::Room(uint32_t id, const std::string& name)
-    : id(id), name(name) {
+    : id(id), name(name), cold_grid(width, height), grid(width, height) {
 }
 
 Room::~Room() {
-    Clear();
+    // The instances belong to InstanceManager and may outlive the room,
+    // so move them out of this room's stores rather than destroying them
+    if (queued_joins > 0) GameGlobals::Get().GetInstanceManager().DropJoins(this, false);
+    for (InstanceStore* from : { &store, &cold_store }) {
+        while (from->Size() > 0) {
+            Instance* inst = from->GetOwner((uint32_t)from->Size() - 1);
+            inst->StopAlarms();
+            inst->room = nullptr;
+            inst->collision_proxy = NULL_PROXY;
+            inst->collision_queued = false;
+            inst->room_object_prev = inst->room_object_next = nullptr;
+            inst->event_lists = 0;
+            inst->lists_queued = false;
+            inst->draw_listed = false;
+            inst->draw_queued = false;
+            inst->MoveToStore(InstanceStore::Detached());
+        }
+    }
+}
+
+void Room::AddInstance(InstanceHandle handle) {
+    Instance* inst = GameGlobals::Get().GetInstanceManager().Get(handle);
+    if (!inst || inst->room == this) return;
+    if (inst->room) {
+        inst->room->Unlink(inst);
+    }
+    inst->room = this;
+    inst->room_sequence = next_sequence++;
+    if (inst->GetActive()) {
+        inst->MoveToStore(store);
+        JoinHotSets(inst);
+        inst->StartAlarms();
+    } else {
+        inst->MoveToStore(cold_store);
+        inst->collision_proxy = cold_grid.Insert(inst->GetBBox(), handle);
+    }
+}
+
+void Room::Place(Instance* inst, InstanceHandle handle) {
+    inst->handle = handle;
+    inst->room = this;
+    inst->room_sequence = next_sequence++;
+    JoinHotSets(inst);
+}
+
+void Room::QueueInstance(InstanceHandle handle) {
+    queued_joins++;
+    GameGlobals::Get().GetInstanceManager().QueueJoin(handle, this);
+}
+
+void Room::RemoveInstance(InstanceHandle handle) {
+    Instance* inst = GameGlobals::Get().GetInstanceManager().Get(handle);
+    if (inst && inst->room == this) {
+        Unlink(inst);
+        inst->MoveToStore(InstanceStore::Detached());
+    }
+}
+
+void Room::Unlink(Instance* inst) {
+    inst->StopAlarms();
+    if (IsCold(inst)) {
+        cold_grid.Remove(inst->collision_proxy);
+        inst->collision_proxy = NULL_PROXY;
+        inst->collision_queued = false;
+    } else {
+        LeaveHotSets(inst);
+    }
+    inst->room = nullptr;
+}
+
+void Room::JoinHotSets(Instance* inst) {
+    inst->room_index = (uint32_t)instances.size();
+    instances.push_back(inst->GetHandle());
+    inst->collision_proxy = InsertProxy(inst);
+    RefreshEventLists(inst);
+    LinkObjectList(inst);
+}
+
+void Room::LeaveHotSets(Instance* inst) {
+    instances[inst->room_index] = INVALID_INSTANCE;
+    holes++;
+    UnlinkObjectList(inst);
+
+    RemoveProxy(inst);
+    inst->collision_queued = false;
+    for (int list = 0; list < (int)EventList::Count; list++) {
+        if (inst->event_lists & (1u << list)) Unsubscribe(inst, (EventList)list);
+    }
+    inst->lists_queued = false;  // Orphans its queue entries
+    inst->draw_queued = false;
+}
+
+void Room::LinkObjectList(Instance* inst) {
+    if (!inst->GetObject()) return;
+    ObjectInstances& list = object_instances[inst->GetObject()];
+    inst->room_object_prev = list.last;
+    inst->room_object_next = nullptr;
+    if (list.last) list.last->room_object_next = inst;
+    else list.first = inst;
+    list.last = inst;
+    list.count++;
 }
 
-void Room::AddInstance(std::shared_ptr<Instance> inst) {
-    auto it = std::find(instances.begin(), instances.end(), inst);
-    if (it == instances.end()) {
-        instances.push_back(inst);
+void Room::UnlinkObjectList(Instance* inst) {
+    if (!inst->GetObject()) return;
+    ObjectInstances& list = object_instances[inst->GetObject()];
+    if (inst->room_object_prev) inst->room_object_prev->room_object_next = inst->room_object_next;
+    else list.first = inst->room_object_next;
+    if (inst->room_object_next) inst->room_object_next->room_object_prev = inst->room_object_prev;
+    else list.last = inst->room_object_prev;
+    inst->room_object_prev = inst->room_object_next = nullptr;
+    list.count--;
+}
+
+void Room::ChangeObject(Instance* inst, Object* obj) {
+    if (IsCold(inst)) {
+        inst->SetObject(obj);
+        return;
     }
+    UnlinkObjectList(inst);
+    inst->SetObject(obj);
+    LinkObjectList(inst);
+    RefreshEventLists(inst);  // Joining lists are merged in by sequence
 }
 
-void Room::RemoveInstance(std::shared_ptr<Instance> inst) {
-    auto it = std::find(instances.begin(), instances.end(), inst);
-    if (it != instances.end()) {
-        instances.erase(it);
+void Room::ApplyActive(Instance* inst) {
+    if (inst->GetActive() && IsCold(inst)) {
+        cold_grid.Remove(inst->collision_proxy);
+        inst->MoveToStore(store);
+        JoinHotSets(inst);
+        // A destroy queued while it was inactive was put off until now
+        if (inst->IsMarked()) GameGlobals::Get().GetInstanceManager().QueueDestroy(inst->GetHandle());
+    } else if (!inst->GetActive() && !IsCold(inst)) {
+        LeaveHotSets(inst);
+        inst->MoveToStore(cold_store);
+        inst->collision_proxy = cold_grid.Insert(inst->GetBBox(), inst->GetHandle());
     }
 }
 
-std::shared_ptr<Instance> Room::FindInstance(uint32_t id) {
-    for (auto& inst : instances) {
-        if (inst->GetID() == id) {
-            return inst;
+// Collects the owners whose box touches area, or lies entirely outside it,
+// through query(rect, fn) over one of the broadphases. Outside is covered
+// by four unbounded strips around area, so it is a spatial query too;
+// boxes found there that still touch area are left out.
+template <typename Query>
+static void SelectRegion(const Rect& area, bool inside, Query&& query, std::vector<InstanceHandle>& out) {
+    out.clear();
+    if (inside) {
+        query(area, [&](InstanceHandle owner, const Rect&) { out.push_back(owner); return true; });
+        return;
+    }
+    const double inf = std::numeric_limits<double>::infinity();
+    const Rect strips[] = {
+        Rect(-inf, -inf, area.x1, inf), Rect(area.x2, -inf, inf, inf),
+        Rect(area.x1, -inf, area.x2, area.y1), Rect(area.x1, area.y2, area.x2, inf),
+    };
+    for (const Rect& strip : strips) {
+        query(strip, [&](InstanceHandle owner, const Rect& box) {
+            if (!BoxTouches(box, area)) out.push_back(owner);
+            return true;
+        });
+    }
+    // A box in a corner touches two strips
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void Room::SelectActive(const Rect& area, bool inside) {
+    SelectRegion(area, inside, [this](const Rect& r, auto&& fn) { QueryCollision(r, fn); }, region_hits);
+}
+
+void Room::SelectInactive(const Rect& area, bool inside) {
+    SyncCollision();
+    SelectRegion(area, inside, [this](const Rect& r, auto&& fn) { cold_grid.Query(r, fn); }, region_hits);
+}
+
+void Room::DeactivateRegion(const Rect& area, bool inside, InstanceHandle notme) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    SelectActive(area, inside);
+    for (InstanceHandle handle : region_hits) {
+        Instance* inst = manager.Get(handle);
+        if (inst && handle != notme) inst->SetActive(false);
+    }
+}
+
+void Room::ActivateRegion(const Rect& area, bool inside) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    SelectInactive(area, inside);
+    for (InstanceHandle handle : region_hits) {
+        if (Instance* inst = manager.Get(handle)) inst->SetActive(true);
+    }
+}
+
+void Room::SetCameraActivation(bool enabled, double activate, double deactivate) {
+    camera_activation = enabled;
+    activate_margin = activate;
+    deactivate_margin = std::max(activate, deactivate);
+}
+
+void Room::UpdateCameraActivation() {
+    if (!camera_activation || !active_camera) return;
+    const Camera& cam = *active_camera;
+    auto around = [&](double margin) {
+        return Rect(cam.GetX() - margin, cam.GetY() - margin,
+                    cam.GetX() + cam.GetWidth() + margin, cam.GetY() + cam.GetHeight() + margin);
+    };
+
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    SelectActive(around(deactivate_margin), false);
+    for (InstanceHandle handle : region_hits) {
+        Instance* inst = manager.Get(handle);
+        if (inst && !(inst->GetObject() && inst->GetObject()->GetKeepActive())) inst->SetActive(false);
+    }
+    ActivateRegion(around(activate_margin), true);
+}
+
+bool Room::WantsEventList(Instance* inst, EventList list) {
+    Object* obj = inst->GetObject();
+    switch (list) {
+    case EventList::BeginStep:
+        return obj && obj->GetHandler(EventType::Step, (int)StepEventType::BeginStep);
+    case EventList::Step:
+        return obj && obj->GetHandler(EventType::Step, (int)StepEventType::NormalStep);
+    case EventList::EndStep:
+        return obj && obj->GetHandler(EventType::Step, (int)StepEventType::EndStep);
+    case EventList::Collision:
+        return obj && !obj->GetCollisionTargets().empty();
+    case EventList::Draw:
+        return inst->GetSpriteIndex() != 0 || (obj && obj->HasEvent(EventType::Draw));
+    default:
+        return false;
+    }
+}
+
+const std::vector<Room::Subscriber>& Room::GetSubscribers(EventList list) {
+    if (subscribers_generation != Object::GetEventGeneration()) RebuildEventLists();
+    MergeSubscribeQueue();
+    return subscribers[(int)list].entries;
+}
+
+void Room::RefreshEventLists(Instance* inst) {
+    // Cold instances rejoin on activation; queued ones are looked at again
+    // when the queue is merged
+    if (IsCold(inst) || inst->lists_queued) return;
+    for (int list = 0; list < (int)EventList::Count; list++) {
+        uint32_t bit = 1u << list;
+        bool wanted = WantsEventList(inst, (EventList)list);
+        if (!wanted && (inst->event_lists & bit)) {
+            Unsubscribe(inst, (EventList)list);
+        } else if (wanted && !(inst->event_lists & bit)) {
+            // New instances append; anything else waits for the merge,
+            // including one whose own hole is still at the end
+            auto& entries = subscribers[list].entries;
+            if (!entries.empty() && entries.back().sequence >= inst->room_sequence) {
+                inst->lists_queued = true;
+                subscribe_queue.push_back(inst->GetHandle());
+                return;
+            }
+            entries.push_back({ inst->room_sequence, inst->GetHandle() });
+            inst->event_lists |= bit;
+            if (list == (int)EventList::Draw) AddToDrawOrder(inst);
         }
     }
-    return nullptr;
 }
 
-std::vector<std::shared_ptr<Instance>> Room::FindInstancesByObject(std::shared_ptr<Object> obj) {
-    std::vector<std::shared_ptr<Instance>> result;
-    for (auto& inst : instances) {
-        if (inst->GetObject() == obj) {
-            result.push_back(inst);
+void Room::MergeSubscribeQueue() {
+    if (subscribe_queue.empty()) return;
+
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (auto& joining : subscribe_new) joining.clear();
+    for (InstanceHandle handle : subscribe_queue) {
+        // Entries go stale when the instance leaves the room or its hot sets
+        Instance* inst = manager.Get(handle);
+        if (!inst || inst->room != this || !inst->lists_queued) continue;
+        inst->lists_queued = false;
+        for (int list = 0; list < (int)EventList::Count; list++) {
+            uint32_t bit = 1u << list;
+            bool wanted = WantsEventList(inst, (EventList)list);
+            if (!wanted && (inst->event_lists & bit)) {
+                Unsubscribe(inst, (EventList)list);
+            } else if (wanted && !(inst->event_lists & bit)) {
+                subscribe_new[list].push_back({ inst->room_sequence, handle });
+                inst->event_lists |= bit;
+                if (list == (int)EventList::Draw) AddToDrawOrder(inst);
+            }
         }
     }
+    subscribe_queue.clear();
+
+    // Sort the joining entries and merge them in while closing the holes
+    auto before = [](const Subscriber& a, const Subscriber& b) { return a.sequence < b.sequence; };
+    for (int list = 0; list < (int)EventList::Count; list++) {
+        auto& joining = subscribe_new[list];
+        if (joining.empty()) continue;
+        std::sort(joining.begin(), joining.end(), before);
+        SubscriberList& subs = subscribers[list];
+        subscribe_merged.clear();
+        auto next = joining.begin();
+        for (const Subscriber& entry : subs.entries) {
+            if (entry.handle == INVALID_INSTANCE) continue;
+            while (next != joining.end() && before(*next, entry)) subscribe_merged.push_back(*next++);
+            subscribe_merged.push_back(entry);
+        }
+        subscribe_merged.insert(subscribe_merged.end(), next, joining.end());
+        subs.entries.swap(subscribe_merged);
+        subs.holes = 0;
+    }
+}
+
+void Room::Unsubscribe(Instance* inst, EventList list) {
+    SubscriberList& subs = subscribers[(int)list];
+    auto it = std::lower_bound(subs.entries.begin(), subs.entries.end(), inst->room_sequence,
+        [](const Subscriber& s, uint64_t seq) { return s.sequence < seq; });
+    if (it != subs.entries.end() && it->sequence == inst->room_sequence) {
+        it->handle = INVALID_INSTANCE;
+        subs.holes++;
+    }
+    inst->event_lists &= ~(1u << (int)list);
+    if (list == EventList::Draw) RemoveFromDrawOrder(inst);
+}
+
+void Room::RebuildEventLists() {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (SubscriberList& subs : subscribers) {
+        subs.entries.clear();
+        subs.holes = 0;
+    }
+    subscribe_queue.clear();
+    for (InstanceHandle handle : instances) {
+        if (Instance* inst = manager.Get(handle)) inst->lists_queued = false;
+    }
+    for (InstanceHandle handle : instances) {
+        if (Instance* inst = manager.Get(handle)) {
+            inst->event_lists = 0;
+            RefreshEventLists(inst);
+            if (!(inst->event_lists & (1u << (int)EventList::Draw))) RemoveFromDrawOrder(inst);
+        }
+    }
+    subscribers_generation = Object::GetEventGeneration();
+}
+
+// Heap order for due_alarms: the alarm to fire next on top
+static bool FiresAfter(const AlarmWheel::Entry& a, const AlarmWheel::Entry& b) {
+    return a.order != b.order ? a.order > b.order : a.index > b.index;
+}
+
+uint64_t Room::GetAlarmStep(const Instance* inst, uint32_t index) const {
+    uint64_t step = alarms.GetStep();
+    if (alarms_running) {
+        AlarmWheel::Entry at = {};
+        at.order = inst->room_sequence;
+        at.index = index;
+        if (FiresAfter(at, alarm_cursor)) step--;
+    }
+    return step;
+}
+
+void Room::ScheduleAlarm(Instance* inst, uint32_t index, int steps) {
+    AlarmWheel::Entry entry = { GetAlarmStep(inst, index) + (uint64_t)steps, inst->room_sequence,
+                                inst->GetHandle(), inst->alarm_token[index], index };
+    inst->alarm_due[index] = entry.due;
+    if (steps <= 0) return;  // Zero just runs out
+    if (entry.due > alarms.GetStep()) {
+        RunOrDefer([this, entry] { alarms.Schedule(entry); });
+    } else {
+        due_alarms.push_back(entry);
+        std::push_heap(due_alarms.begin(), due_alarms.end(), FiresAfter);
+    }
+}
+
+void Room::RunAlarms() {
+    due_alarms.clear();
+    alarms.Advance(due_alarms);
+    if (due_alarms.empty()) return;
+
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    std::make_heap(due_alarms.begin(), due_alarms.end(), FiresAfter);
+    alarms_running = true;
+    while (!due_alarms.empty()) {
+        std::pop_heap(due_alarms.begin(), due_alarms.end(), FiresAfter);
+        alarm_cursor = due_alarms.back();
+        due_alarms.pop_back();
+
+        // Stale if the alarm was set again, or the instance was destroyed,
+        // deactivated or moved since the entry was scheduled
+        Instance* inst = manager.Get(alarm_cursor.handle);
+        uint32_t index = alarm_cursor.index;
+        if (!inst || inst->room != this || inst->alarm_token[index] != alarm_cursor.token) continue;
+        inst->alarm_due[index] = Instance::NOT_COUNTING;
+        inst->alarm[index] = -1;
+        inst->TriggerEvent(EventType::Alarm, (int)index);
+    }
+    alarms_running = false;
+}
+
+ProxyId Room::InsertProxy(Instance* inst) {
+    if (broadphase == BroadphaseType::Tree) return tree.Insert(inst->GetBBox(), inst->GetHandle());
+    return grid.Insert(inst->GetBBox(), inst->GetHandle());
+}
+
+void Room::UpdateProxy(Instance* inst) {
+    if (inst->collision_proxy == NULL_PROXY) return;
+    if (broadphase == BroadphaseType::Tree) tree.Update(inst->collision_proxy, inst->GetBBox());
+    else grid.Update(inst->collision_proxy, inst->GetBBox());
+}
+
+void Room::RemoveProxy(Instance* inst) {
+    if (inst->collision_proxy == NULL_PROXY) return;
+    if (broadphase == BroadphaseType::Tree) tree.Remove(inst->collision_proxy);
+    else grid.Remove(inst->collision_proxy);
+    inst->collision_proxy = NULL_PROXY;
+}
+
+void Room::SetBroadphase(BroadphaseType type) {
+    if (type == broadphase) return;
+
+    // Move every proxy over; the queue is flushed by the rebuild
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (InstanceHandle handle : instances) {
+        if (Instance* inst = manager.Get(handle)) RemoveProxy(inst);
+    }
+    broadphase = type;
+    for (InstanceHandle handle : instances) {
+        if (Instance* inst = manager.Get(handle)) {
+            inst->collision_queued = false;
+            inst->collision_proxy = InsertProxy(inst);
+        }
+    }
+    collision_queue.clear();
+}
+
+void Room::SyncCollision() {
+    if (broadphase == BroadphaseType::Grid && (grid.GetWidth() != width || grid.GetHeight() != height)) {
+        grid.Resize(width, height);
+    }
+    if (cold_grid.GetWidth() != width || cold_grid.GetHeight() != height) {
+        cold_grid.Resize(width, height);
+    }
+    if (collision_queue.empty()) return;
+
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (InstanceHandle handle : collision_queue) {
+        // Entries go stale when the instance is destroyed or changes room
+        Instance* inst = manager.Get(handle);
+        if (!inst || inst->room != this || !inst->collision_queued) continue;
+        inst->collision_queued = false;
+        if (IsCold(inst)) cold_grid.Update(inst->collision_proxy, inst->GetBBox());
+        else UpdateProxy(inst);
+    }
+    collision_queue.clear();
+}
+
+void Room::MarkMoved() {
+    for (uint32_t row = 0; row < store.Size(); row++) {
+        if (store.x[row] != store.xprevious[row] || store.y[row] != store.yprevious[row]) {
+            store.GetOwner(row)->MarkBBoxDirty();
+        }
+    }
+}
+
+InstanceHandle Room::FindInstance(uint32_t id) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    InstanceHandle handle = manager.FindByID(id);
+    Instance* inst = manager.Get(handle);
+    return inst && inst->room == this ? handle : INVALID_INSTANCE;
+}
+
+void Room::CollectInstances(Object* obj, std::vector<InstanceHandle>& out) {
+    if (!obj) {
+        for (InstanceHandle handle : instances) {
+            if (handle != INVALID_INSTANCE) out.push_back(handle);
+        }
+        return;
+    }
+    for (Object* match : obj->GetDescendants()) {
+        auto it = object_instances.find(match);
+        if (it == object_instances.end()) continue;
+        for (Instance* inst = it->second.first; inst; inst = inst->room_object_next) {
+            out.push_back(inst->GetHandle());
+        }
+    }
+}
+
+Instance* Room::ResolveActive(InstanceHandle handle) {
+    Instance* inst = GameGlobals::Get().GetInstanceManager().Get(handle);
+    return inst && inst->room == this && !IsCold(inst) ? inst : nullptr;
+}
+
+size_t Room::CountInstances(Object* obj) {
+    if (!obj) return GetInstanceCount();
+    size_t count = 0;
+    for (Object* match : obj->GetDescendants()) {
+        auto it = object_instances.find(match);
+        if (it != object_instances.end()) count += it->second.count;
+    }
+    return count;
+}
+
+Instance* Room::FindInstanceOf(Object* obj, size_t n) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    if (!obj) {
+        for (InstanceHandle handle : instances) {
+            Instance* inst = manager.Get(handle);
+            if (inst && n-- == 0) return inst;
+        }
+        return nullptr;
+    }
+    for (Object* match : obj->GetDescendants()) {
+        auto it = object_instances.find(match);
+        if (it == object_instances.end()) continue;
+        if (n >= it->second.count) {
+            n -= it->second.count;
+            continue;
+        }
+        Instance* inst = it->second.first;
+        while (n-- > 0) inst = inst->room_object_next;
+        return inst;
+    }
+    return nullptr;
+}
+
+std::vector<InstanceHandle> Room::FindInstancesByObject(Object* obj) {
+    std::vector<InstanceHandle> result;
+    CollectInstances(obj, result);
     return result;
 }
 
 void Room::Init() {
-    for (auto& inst : instances) {
-        inst->CreateEvent();
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (size_t i = 0; i < instances.size(); i++) {
+        if (Instance* inst = manager.Get(instances[i])) {
+            inst->CreateEvent();
+        }
     }
     initialized = true;
 }
 
+void Room::Freeze() {
+    // Close every hole. The queues (collision, draw order, subscribers)
+    // hold handles that are checked when they are applied, so they can
+    // wait for the room to run again.
+    Compact();
+
+    // Scratch buffers are rebuilt on demand once the room runs again
+    auto release = [](auto& v) { std::decay_t<decltype(v)>().swap(v); };
+    release(draw_moved);
+    release(draw_merged);
+    for (auto& joining : subscribe_new) release(joining);
+    release(subscribe_merged);
+    release(region_hits);
+    release(draw_tiles);
+    release(due_alarms);
+    if (with_depth == 0) release(with_buffers);
+
+    instances.shrink_to_fit();
+    for (SubscriberList& subs : subscribers) subs.entries.shrink_to_fit();
+    draw_order.shrink_to_fit();
+    store.ShrinkToFit();
+    cold_store.ShrinkToFit();
+    frozen = true;
+}
+
 void Room::Clear() {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (InstanceHandle handle : instances) {
+        manager.Destroy(handle);
+    }
+    if (queued_joins > 0) manager.DropJoins(this, true);
+    queued_joins = 0;
+    while (cold_store.Size() > 0) {
+        manager.Destroy(cold_store.GetOwner((uint32_t)cold_store.Size() - 1)->GetHandle());
+    }
     instances.clear();
-    instances_to_add.clear();
+    holes = 0;
+    for (SubscriberList& subs : subscribers) {
+        subs.entries.clear();
+        subs.holes = 0;
+    }
+    object_instances.clear();
+    subscribe_queue.clear();
+    draw_order.clear();
+    draw_holes = 0;
+    draw_queue.clear();
+    collision_queue.clear();
+    alarms.Clear();
+    built = false;
 }
 
 void Room::RoomStartEvent() {
@@ -65,50 +610,187 @@ void Room::RoomEndEvent() {
 }
 
 void Room::Update() {
-    // Add any pending instances
-    for (auto& inst : instances_to_add) {
-        instances.push_back(inst);
+    GameGlobals::Get().GetInstanceManager().ApplyPending();
+
+    bool sparse = holes > 0 && holes * COMPACT_FRACTION >= instances.size();
+    for (const SubscriberList& subs : subscribers) {
+        sparse = sparse || (subs.holes > 0 && subs.holes * COMPACT_FRACTION >= subs.entries.size());
     }
-    instances_to_add.clear();
+    if (sparse) Compact();
+}
+
+void Room::Draw() {
+    // The Draw list is looked up first so an event generation change
+    // rebuilds it (and queues draw order entries) before sorting
+    GetSubscribers(EventList::Draw);
+    SortDrawOrder();
 
-    // Update all instances
-    for (auto& inst : instances) {
-        if (inst->GetActive()) {
-            inst->Update();
+    // Indexed, and only over the entries sorted this frame: instances
+    // created by a draw event are drawn from the next frame
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    size_t count = draw_order.size();
+
+    // Visible tile layers go in between, each before the instances at its
+    // depth or deeper
+    draw_tiles.clear();
+    for (const auto& layer : layers) {
+        if (layer->GetVisible() && layer->GetTilemap()) draw_tiles.push_back(layer.get());
+    }
+    std::stable_sort(draw_tiles.begin(), draw_tiles.end(),
+                     [](const Layer* a, const Layer* b) { return a->GetDepth() < b->GetDepth(); });
+    IRenderer* renderer = GameGlobals::Get().GetRenderer();
+    Rect view(0, 0, width, height);
+    if (views_enabled && active_camera) {
+        const Camera& cam = *active_camera;
+        view = Rect(cam.GetX(), cam.GetY(), cam.GetX() + cam.GetWidth(), cam.GetY() + cam.GetHeight());
+    }
+    size_t next_tiles = 0;
+    auto draw_tiles_to = [&](double depth) {
+        for (; next_tiles < draw_tiles.size() && draw_tiles[next_tiles]->GetDepth() <= depth; next_tiles++) {
+            draw_tiles[next_tiles]->GetTilemap()->Draw(renderer, view);
+        }
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        Instance* inst = manager.Get(draw_order[i].handle);
+        if (inst && inst->room == this && inst->GetVisible()) {
+            draw_tiles_to(draw_order[i].depth);
+            inst->DrawEvent();
         }
     }
+    draw_tiles_to(std::numeric_limits<double>::infinity());
+}
 
-    RemoveMarked();
+// Lower depth is drawn first; equal depths keep step order
+static bool DrawsBefore(double depth_a, uint64_t seq_a, double depth_b, uint64_t seq_b) {
+    return depth_a != depth_b ? depth_a < depth_b : seq_a < seq_b;
 }
 
-void Room::Draw() {
-    // Sort instances by depth (lower depth = drawn first)
-    std::sort(instances.begin(), instances.end(),
-        [](const std::shared_ptr<Instance>& a, const std::shared_ptr<Instance>& b) {
-            return a->GetDepth() < b->GetDepth();
+void Room::AddToDrawOrder(Instance* inst) {
+    if (inst->draw_listed) return;
+    inst->draw_listed = true;
+    inst->draw_depth = std::numeric_limits<double>::quiet_NaN();  // No entry yet
+    QueueDepthChange(inst);
+}
+
+void Room::QueueDepthChange(Instance* inst) {
+    if (!inst->draw_listed || inst->draw_queued) return;
+    inst->draw_queued = true;
+    InstanceHandle handle = inst->GetHandle();
+    RunOrDefer([this, handle] { draw_queue.push_back(handle); });
+}
+
+void Room::RemoveFromDrawOrder(Instance* inst) {
+    if (!inst->draw_listed) return;
+    inst->draw_listed = false;
+    if (std::isnan(inst->draw_depth)) return;  // Never placed
+
+    auto it = std::lower_bound(draw_order.begin(), draw_order.end(), inst,
+        [](const DrawEntry& e, const Instance* i) {
+            return DrawsBefore(e.depth, e.sequence, i->draw_depth, i->room_sequence);
         });
+    if (it != draw_order.end() && it->sequence == inst->room_sequence) {
+        it->handle = INVALID_INSTANCE;
+        draw_holes++;
+    }
+}
 
-    for (auto& inst : instances) {
-        if (inst->GetVisible()) {
-            inst->DrawEvent();
-        }
+void Room::PlaceDrawOrder() {
+    // Every listed instance is still queued, and the queue's handles may
+    // not resolve yet, so collect them through the store instead
+    if (!draw_order.empty()) return;
+    for (uint32_t row = 0; row < store.Size(); row++) {
+        Instance* inst = store.GetOwner(row);
+        if (!inst->draw_queued) continue;
+        inst->draw_queued = false;
+        if (!inst->draw_listed) continue;
+        inst->draw_depth = inst->GetDepth();
+        draw_order.push_back({ inst->draw_depth, inst->room_sequence, inst->GetHandle() });
+    }
+    draw_queue.clear();
+    std::sort(draw_order.begin(), draw_order.end(), [](const DrawEntry& a, const DrawEntry& b) {
+        return DrawsBefore(a.depth, a.sequence, b.depth, b.sequence);
+    });
+}
+
+void Room::SortDrawOrder() {
+    if (draw_queue.empty() && draw_holes == 0) return;
+
+    // Take the queued instances whose depth really changed out of the
+    // order, leaving holes; what stays is still sorted
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    draw_moved.clear();
+    for (InstanceHandle handle : draw_queue) {
+        // Entries go stale when the instance is destroyed or changes room
+        Instance* inst = manager.Get(handle);
+        if (!inst || inst->room != this || !inst->draw_queued) continue;
+        inst->draw_queued = false;
+        if (!inst->draw_listed || inst->GetDepth() == inst->draw_depth) continue;
+        RemoveFromDrawOrder(inst);
+        inst->draw_listed = true;
+        inst->draw_depth = inst->GetDepth();
+        draw_moved.push_back({ inst->draw_depth, inst->room_sequence, handle });
+    }
+    draw_queue.clear();
+
+    if (draw_moved.empty()) {
+        draw_order.erase(std::remove_if(draw_order.begin(), draw_order.end(),
+            [](const DrawEntry& e) { return e.handle == INVALID_INSTANCE; }), draw_order.end());
+        draw_holes = 0;
+        return;
+    }
+
+    // Sort the few that moved and merge them back in while closing the
+    // holes, which costs the same however far they moved. Sequences are
+    // unique, so the result is as stable as a stable sort.
+    auto before = [](const DrawEntry& a, const DrawEntry& b) {
+        return DrawsBefore(a.depth, a.sequence, b.depth, b.sequence);
+    };
+    std::sort(draw_moved.begin(), draw_moved.end(), before);
+    draw_merged.clear();
+    auto moved = draw_moved.begin();
+    for (const DrawEntry& entry : draw_order) {
+        if (entry.handle == INVALID_INSTANCE) continue;
+        while (moved != draw_moved.end() && before(*moved, entry)) draw_merged.push_back(*moved++);
+        draw_merged.push_back(entry);
     }
+    draw_merged.insert(draw_merged.end(), moved, draw_moved.end());
+    draw_order.swap(draw_merged);
+    draw_holes = 0;
 }
 
-void Room::RemoveMarked() {
-    instances.erase(
-        std::remove_if(instances.begin(), instances.end(),
-            [](const std::shared_ptr<Instance>& inst) {
-                return inst->IsMarked();
-            }),
-        instances.end()
-    );
+void Room::Compact() {
+    for (SubscriberList& subs : subscribers) {
+        if (subs.holes == 0) continue;
+        subs.entries.erase(std::remove_if(subs.entries.begin(), subs.entries.end(),
+            [](const Subscriber& s) { return s.handle == INVALID_INSTANCE; }), subs.entries.end());
+        subs.holes = 0;
+    }
+
+    if (holes == 0) return;
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    size_t kept = 0;
+    for (InstanceHandle handle : instances) {
+        if (Instance* inst = manager.Get(handle)) {
+            inst->room_index = (uint32_t)kept;
+            instances[kept++] = handle;
+        }
+    }
+    instances.resize(kept);
+    holes = 0;
 }
 
 void Room::UpdateBBoxes() {
-    for (auto& inst : instances) {
-        inst->UpdateBBox();
+    // Only needed when something the instances don't track changes, such as
+    // a sprite's own bbox
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    for (InstanceHandle handle : instances) {
+        if (Instance* inst = manager.Get(handle)) inst->MarkBBoxDirty();
+    }
+    for (uint32_t row = 0; row < cold_store.Size(); row++) {
+        cold_store.GetOwner(row)->MarkBBoxDirty();
     }
+    SyncCollision();
 }
 
 void Room::AddLayer(std::shared_ptr<Layer> layer) {
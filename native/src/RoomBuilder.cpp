@@ -0,0 +1,75 @@
+#include "RoomBuilder.h"
+#include "Managers.h"
+#include "Object.h"
+
+namespace GM {
+
+RoomBuilder::RoomBuilder(std::shared_ptr<Room> room)
+    : room(std::move(room)) {
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    const auto& placements = this->room->GetPlacements();
+    handles.reserve(placements.size());
+    for (size_t i = 0; i < placements.size(); i++) {
+        handles.push_back(manager.Reserve());
+    }
+}
+
+RoomBuilder::~RoomBuilder() {
+    Finish();
+}
+
+void RoomBuilder::Start() {
+    if (thread.joinable() || ready) return;
+
+    // Stale dispatch tables would be rebuilt by the first lookup, which
+    // must not happen off the main thread
+    GameGlobals::Get().GetObjectManager().BuildDispatchTables();
+    thread = std::thread([this] { Run(); });
+}
+
+void RoomBuilder::Finish() {
+    if (finished) return;
+    if (thread.joinable()) thread.join();
+    else if (!ready) Run();
+
+    auto& manager = GameGlobals::Get().GetInstanceManager();
+    manager.Adopt(pool, built);
+    for (InstanceHandle handle : unused) manager.Unreserve(handle);
+    room->built = true;
+    finished = true;
+}
+
+void RoomBuilder::Run() {
+    Room& target = *room;
+    auto& objects = GameGlobals::Get().GetObjectManager();
+    const auto& placements = target.GetPlacements();
+
+    target.SyncCollision();  // Sizes the broadphase to the room
+    target.store.Reserve(target.store.Size() + placements.size());
+    target.instances.reserve(target.instances.size() + placements.size());
+    built.reserve(placements.size());
+
+    // Placements tend to come in runs of one object
+    uint32_t object_id = 0;
+    Object* object = nullptr;
+    for (size_t i = 0; i < placements.size(); i++) {
+        const Room::Placement& placement = placements[i];
+        if (handles[i] == INVALID_INSTANCE) continue;
+        if (!object || placement.object_id != object_id) {
+            object_id = placement.object_id;
+            object = objects.GetObject(object_id).get();
+        }
+        if (!object) {
+            unused.push_back(handles[i]);
+            continue;
+        }
+
+        Instance* inst = pool.Create(placement.x, placement.y, placement.id, object, target.store);
+        target.Place(inst, handles[i]);
+        built.push_back(inst);
+    }
+    target.PlaceDrawOrder();
+    ready = true;
+}
+
+} // namespace GM
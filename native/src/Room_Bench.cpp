@@ -0,0 +1,145 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "../include/Bench.h"
+#include "../include/GameEngine.h"
+#include "../include/Object.h"
+#include "../include/Random.h"
+
+// Walking in and out of a house in a large overworld. The overworld is
+// entered and left repeatedly, first as an ordinary room (destroy events
+// on the way out, rebuilt from its placements with create events on the
+// way in) and then as a persistent one, which is frozen while the player
+// is inside. An ordinary overworld must come back exactly as placed, and
+// a persistent one exactly as it was left, without rerunning create events.
+
+using GM::Bench::Clock;
+using GM::Bench::Seconds;
+
+static size_t StoreBytes(const GM::InstanceStore& s) {
+    size_t rows = s.x.capacity() + s.y.capacity() + s.xprevious.capacity() + s.yprevious.capacity() +
+                  s.hspeed.capacity() + s.vspeed.capacity() + s.gravity.capacity() +
+                  s.gravity_direction.capacity() + s.gravity_dx.capacity() + s.gravity_dy.capacity() +
+                  s.friction.capacity() + s.image_index.capacity() + s.image_speed.capacity() +
+                  s.depth.capacity();
+    return rows * sizeof(double) + s.sprite_index.capacity() * sizeof(uint32_t) + s.flags.capacity();
+}
+
+struct Snapshot {
+    std::vector<double> state;
+    void Take(GM::Room& room, GM::InstanceManager& manager) {
+        state.clear();
+        for (GM::InstanceHandle handle : room.GetInstances()) {
+            if (GM::Instance* inst = manager.Get(handle)) {
+                state.push_back(inst->GetX());
+                state.push_back(inst->GetY());
+                state.push_back(inst->GetAlarm(0));
+                state.push_back(inst->GetImageIndex());
+            }
+        }
+    }
+};
+
+int main() {
+    constexpr double WORLD_SIZE = 16384;
+    constexpr int TRIPS = 5;
+
+    GM::GameEngine engine(nullptr);
+    auto& globals = engine.GetGlobals();
+    auto& manager = globals.GetInstanceManager();
+
+    // Scenery picks a frame when created; villagers wander and count down
+    size_t create_events = 0;
+    auto scenery = std::make_shared<GM::Object>(1, "obj_tree");
+    scenery->SetEventCallback(GM::EventType::Create, 0, [&](GM::Instance* inst) {
+        create_events++;
+        inst->SetImageIndex(std::fmod(inst->GetX() * 7 + inst->GetY() * 13, 4));
+    });
+    auto villager = std::make_shared<GM::Object>(2, "obj_villager");
+    villager->SetEventCallback(GM::EventType::Create, 0, [&](GM::Instance* inst) {
+        create_events++;
+        inst->SetAlarm(0, 600 + (int)(inst->GetID() % 120));
+    });
+    globals.GetObjectManager().AddObject(scenery);
+    globals.GetObjectManager().AddObject(villager);
+    villager->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep, [](GM::Instance* inst) {
+        double dir = std::sin(inst->GetX() * 0.01) + std::cos(inst->GetY() * 0.01);
+        inst->SetHSpeed(std::cos(dir));
+        inst->SetVSpeed(std::sin(dir));
+    });
+
+    std::cout << std::left << std::setw(12) << "instances" << std::setw(12) << "overworld" << std::right
+              << std::setw(12) << "leave" << std::setw(12) << "enter" << std::setw(16) << "create events"
+              << std::setw(14) << "store MB" << std::endl;
+
+    bool consistent = true;
+    for (size_t count : { 50000u, 200000u }) {
+        for (bool persistent : { false, true }) {
+            auto overworld = std::make_shared<GM::Room>(0, "rm_overworld");
+            overworld->SetWidth((uint32_t)WORLD_SIZE);
+            overworld->SetHeight((uint32_t)WORLD_SIZE);
+            overworld->SetPersistent(persistent);
+            auto house = std::make_shared<GM::Room>(1, "rm_house");
+            GM::RandomGenerator rng(5);
+            for (size_t i = 0; i < count; i++) {
+                uint32_t object_id = i % 4 == 0 ? villager->GetID() : scenery->GetID();
+                overworld->AddPlacement({ 1000 + (uint32_t)i, object_id, rng.Range(0, WORLD_SIZE),
+                                          rng.Range(0, WORLD_SIZE) });
+            }
+            for (uint32_t i = 0; i < 500; i++) {
+                house->AddPlacement({ 900000 + i, scenery->GetID(), i % 25 * 16.0, i / 25 * 16.0 });
+            }
+
+            engine.LoadRoom(overworld);
+            size_t first_creates = create_events;
+            Snapshot placed;
+            placed.Take(*overworld, manager);
+            double leave_time = 0, enter_time = 0;
+            size_t bytes_before = 0, bytes_frozen = 0;
+            Snapshot left, back;
+            for (int trip = 0; trip < TRIPS; trip++) {
+                for (int s = 0; s < 10; s++) engine.Update();
+                left.Take(*overworld, manager);
+                if (trip == 0) bytes_before = StoreBytes(overworld->GetInstanceStore());
+
+                auto start = Clock::now();
+                engine.LoadRoom(house);
+                leave_time += Seconds(start);
+                bytes_frozen = StoreBytes(overworld->GetInstanceStore());
+
+                for (int s = 0; s < 10; s++) engine.Update();
+
+                start = Clock::now();
+                engine.LoadRoom(overworld);
+                enter_time += Seconds(start);
+
+                // Frozen, the overworld neither moved nor counted down;
+                // otherwise it was built again from scratch
+                back.Take(*overworld, manager);
+                if (back.state != (persistent ? left.state : placed.state)) consistent = false;
+            }
+            size_t reruns = create_events - first_creates;
+            if (reruns != TRIPS * (persistent ? 500 : 500 + count)) consistent = false;
+
+            std::cout << std::left << std::setw(12) << count << std::setw(12)
+                      << (persistent ? "persistent" : "plain") << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(9) << leave_time / TRIPS * 1e3 << " ms"
+                      << std::setw(9) << enter_time / TRIPS * 1e3 << " ms" << std::setw(16) << reruns
+                      << std::setprecision(1) << std::setw(7) << bytes_before / 1048576.0 << " > "
+                      << std::setw(4) << bytes_frozen / 1048576.0 << std::endl;
+
+            engine.LoadRoom(nullptr);
+            overworld->Clear();
+            house->Clear();
+        }
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: a room came back changed" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: rooms come back as placed, persistent ones as they were left" << std::endl;
+    return 0;
+}
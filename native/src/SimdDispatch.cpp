@@ -0,0 +1,72 @@
+#include "SimdDispatch.h"
+
+#if GM_SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace GM {
+
+static SimdLevel DetectSimdLevel() {
+#if GM_SIMD_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+
+    bool avx2 = false;
+    if (max_leaf >= 7 && osxsave && avx && fma) {
+        // The OS must save YMM state for AVX to be usable
+        bool ymm_enabled = (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        avx2 = ymm_enabled && (info[1] & (1 << 5)) != 0;
+    }
+
+    if (avx2) return SimdLevel::AVX2;
+    if (sse2) return SimdLevel::SSE2;
+    return SimdLevel::Scalar;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+    return SimdLevel::Scalar;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+static SimdLevel& ActiveLevel() {
+    static SimdLevel level = GetDetectedSimdLevel();
+    return level;
+}
+
+SimdLevel GetDetectedSimdLevel() {
+    static const SimdLevel detected = DetectSimdLevel();
+    return detected;
+}
+
+SimdLevel GetSimdLevel() {
+    return ActiveLevel();
+}
+
+void SetSimdLevel(SimdLevel level) {
+    SimdLevel detected = GetDetectedSimdLevel();
+    ActiveLevel() = (int)level > (int)detected ? detected : level;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        default: return "unknown";
+    }
+}
+
+} // namespace GM
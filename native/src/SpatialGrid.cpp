@@ -0,0 +1,121 @@
+#include "../include/SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace GM {
+
+SpatialGrid::SpatialGrid(double width, double height) {
+    Resize(width, height);
+}
+
+void SpatialGrid::Resize(double new_width, double new_height) {
+    width = std::max(1.0, std::isfinite(new_width) ? new_width : 1.0);
+    height = std::max(1.0, std::isfinite(new_height) ? new_height : 1.0);
+
+    cell_size = MIN_CELL_SIZE;
+    double area_cells = (width / cell_size) * (height / cell_size);
+    if (area_cells > (double)MAX_CELLS) {
+        cell_size *= std::sqrt(area_cells / (double)MAX_CELLS);
+    }
+    columns = std::max(1u, (uint32_t)std::ceil(width / cell_size));
+    rows = std::max(1u, (uint32_t)std::ceil(height / cell_size));
+
+    cells.clear();
+    cells.resize((size_t)columns * rows);
+    for (ProxyId id = 0; id < proxies.size(); id++) {
+        if (proxies[id].owner == INVALID_INSTANCE) continue;
+        proxies[id].range = CellsFor(proxies[id].box);
+        Link(id);
+    }
+}
+
+uint32_t SpatialGrid::CellCoord(double v, uint32_t count) const {
+    double c = std::floor(v / cell_size);
+    if (!(c > 0)) return 0;  // Also catches NaN
+    if (c >= count - 1) return count - 1;
+    return (uint32_t)c;
+}
+
+double SpatialGrid::BoundaryFraction(double origin, double delta, uint32_t cell, uint32_t count) const {
+    if (delta > 0 && cell + 1 < count) return ((cell + 1) * cell_size - origin) / delta;
+    if (delta < 0 && cell > 0) return (cell * cell_size - origin) / delta;
+    return std::numeric_limits<double>::infinity();
+}
+
+SpatialGrid::CellRange SpatialGrid::CellsFor(const Rect& box) const {
+    return { CellCoord(box.x1, columns), CellCoord(box.y1, rows),
+             CellCoord(box.x2, columns), CellCoord(box.y2, rows) };
+}
+
+void SpatialGrid::Link(ProxyId id) {
+    const CellRange& r = proxies[id].range;
+    for (uint32_t cy = r.y0; cy <= r.y1; cy++) {
+        for (uint32_t cx = r.x0; cx <= r.x1; cx++) {
+            cells[cy * columns + cx].push_back(id);
+        }
+    }
+}
+
+void SpatialGrid::Unlink(ProxyId id) {
+    const CellRange& r = proxies[id].range;
+    for (uint32_t cy = r.y0; cy <= r.y1; cy++) {
+        for (uint32_t cx = r.x0; cx <= r.x1; cx++) {
+            auto& cell = cells[cy * columns + cx];
+            auto it = std::find(cell.begin(), cell.end(), id);
+            if (it != cell.end()) {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+ProxyId SpatialGrid::Insert(const Rect& box, InstanceHandle owner) {
+    ProxyId id;
+    if (free_proxy != NULL_PROXY) {
+        id = free_proxy;
+        free_proxy = proxies[id].next_free;
+    } else {
+        id = (ProxyId)proxies.size();
+        proxies.emplace_back();
+    }
+    Proxy& proxy = proxies[id];
+    proxy.box = box;
+    proxy.owner = owner;
+    proxy.range = CellsFor(box);
+    proxy.next_free = NULL_PROXY;
+    Link(id);
+    proxy_count++;
+    return id;
+}
+
+void SpatialGrid::Update(ProxyId id, const Rect& box) {
+    Proxy& proxy = proxies[id];
+    proxy.box = box;
+    CellRange range = CellsFor(box);
+    if (range == proxy.range) return;
+    Unlink(id);
+    proxy.range = range;
+    Link(id);
+}
+
+void SpatialGrid::Remove(ProxyId id) {
+    Unlink(id);
+    Proxy& proxy = proxies[id];
+    proxy.owner = INVALID_INSTANCE;
+    proxy.next_free = free_proxy;
+    free_proxy = id;
+    proxy_count--;
+}
+
+uint32_t SpatialGrid::NextStamp() {
+    if (++query_stamp == 0) {
+        // Wrapped: clear old stamps so none can match by accident
+        for (Proxy& proxy : proxies) proxy.stamp = 0;
+        query_stamp = 1;
+    }
+    return query_stamp;
+}
+
+} // namespace GM
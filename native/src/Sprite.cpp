@@ -1,5 +1,6 @@
 #include "Sprite.h"
 #include "Graphics.h"
+#include <algorithm>
 
 namespace GM {
 
@@ -37,8 +38,62 @@ const SpriteFrame* Sprite::GetFrame(uint32_t index) const {
     return nullptr;
 }
 
+void Sprite::GenerateMasks(uint8_t tolerance) {
+    masks.clear();
+    masks.reserve(frames.size());
+    for (const SpriteFrame& frame : frames) {
+        const Texture* tex = frame.GetTexture().get();
+        if (!tex || !tex->GetPixelData()) {
+            masks.emplace_back(frame.GetWidth(), frame.GetHeight());
+            continue;
+        }
+        uint32_t w = std::min(frame.GetWidth(), tex->GetWidth());
+        uint32_t h = std::min(frame.GetHeight(), tex->GetHeight());
+        masks.push_back(CollisionMask::FromRGBA(tex->GetPixelData(), w, h, tex->GetWidth() * 4, tolerance));
+    }
+}
+
+void Sprite::SetMask(uint32_t frame_index, CollisionMask mask) {
+    if (frame_index >= masks.size()) {
+        masks.resize(frame_index + 1);
+    }
+    masks[frame_index] = std::move(mask);
+}
+
+const CollisionMask* Sprite::GetMask(uint32_t frame_index) const {
+    if (masks.empty()) return nullptr;
+    return &masks[frame_index % masks.size()];
+}
+
+void Sprite::ComputeBBox(uint8_t tolerance) {
+    if (bbox_mode == 2) return;
+
+    Rect box = { 1e300, 1e300, -1e300, -1e300 };
+    for (size_t i = 0; i < frames.size(); i++) {
+        const SpriteFrame& frame = frames[i];
+        Rect frame_box = { 0, 0, (double)frame.GetWidth(), (double)frame.GetHeight() };
+        if (bbox_mode == 0) {
+            const Texture* tex = frame.GetTexture().get();
+            if (i < masks.size()) {
+                frame_box = masks[i].GetBounds();
+            } else if (tex && tex->GetPixelData()) {
+                uint32_t w = std::min(frame.GetWidth(), tex->GetWidth());
+                uint32_t h = std::min(frame.GetHeight(), tex->GetHeight());
+                frame_box = CollisionMask::FromRGBA(tex->GetPixelData(), w, h, tex->GetWidth() * 4, tolerance).GetBounds();
+            }
+        }
+        if (frame_box.x2 <= frame_box.x1 || frame_box.y2 <= frame_box.y1) continue;
+        box.x1 = std::min(box.x1, frame_box.x1);
+        box.y1 = std::min(box.y1, frame_box.y1);
+        box.x2 = std::max(box.x2, frame_box.x2);
+        box.y2 = std::max(box.y2, frame_box.y2);
+    }
+    bbox = box.x2 > box.x1 ? box : Rect();
+}
+
 void Sprite::Clear() {
     frames.clear();
+    masks.clear();
 }
 
 } // namespace GM
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../include/GameEngine.h"
+#include "../include/Object.h"
+#include "../include/Random.h"
+
+// Full engine steps over a large simulation room at different step thread
+// counts. Most instances are agents whose step event only touches self
+// (steering with some trig, depth from y, an occasional self alarm); a few
+// controllers per thousand read other instances and split the self-only
+// runs. Every thread count must end in exactly the same state.
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct Result {
+    double step_time;
+    double checksum;
+};
+
+static Result Run(GM::GameEngine& engine, size_t threads, size_t count, int steps) {
+    auto& globals = engine.GetGlobals();
+    auto& manager = globals.GetInstanceManager();
+    engine.SetStepThreads(threads);
+
+    auto agent = std::make_shared<GM::Object>(1, "obj_agent");
+    agent->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep, [](GM::Instance* inst) {
+        double dx = 2048 - inst->GetX(), dy = 2048 - inst->GetY();
+        double dir = std::atan2(dy, dx) + 0.3 * std::sin(inst->GetX() * 0.01);
+        double speed = 1.0 + std::fmod(std::sqrt(dx * dx + dy * dy), 3.0);
+        inst->SetHSpeed(std::cos(dir) * speed);
+        inst->SetVSpeed(std::sin(dir) * speed);
+        inst->SetDepth(-std::floor(inst->GetY()));
+        if (inst->GetAlarm(0) < 0) inst->SetAlarm(0, 30 + (int)(inst->GetID() % 30));
+    }, true);
+    agent->SetEventCallback(GM::EventType::Alarm, 0, [](GM::Instance* inst) {
+        inst->SetX(inst->GetX() + 1);
+    });
+
+    // Controllers pull the previous instance in step order toward them
+    GM::Room* room_ptr = nullptr;
+    auto controller = std::make_shared<GM::Object>(2, "obj_controller");
+    controller->SetEventCallback(GM::EventType::Step, (int)GM::StepEventType::NormalStep, [&](GM::Instance* inst) {
+        auto& instances = room_ptr->GetInstances();
+        for (size_t i = inst->GetID() - 1000; i-- > 0;) {
+            if (GM::Instance* other = manager.Get(instances[i])) {
+                other->SetX((other->GetX() + inst->GetX()) / 2);
+                break;
+            }
+        }
+    });
+
+    auto room = std::make_shared<GM::Room>(0, "rm_bench");
+    room_ptr = room.get();
+    room->SetWidth(4096);
+    room->SetHeight(4096);
+    GM::RandomGenerator rng(11);
+    for (size_t i = 0; i < count; i++) {
+        auto& obj = i % 1000 == 999 ? controller : agent;
+        room->AddInstance(obj->CreateInstance(rng.Range(0, 4096), rng.Range(0, 4096), 1000 + (uint32_t)i));
+    }
+    globals.GetRoomManager().SetCurrentRoom(room);
+
+    engine.Update();  // Warm up
+    auto start = Clock::now();
+    for (int s = 0; s < steps; s++) engine.Update();
+    double step_time = std::chrono::duration<double>(Clock::now() - start).count() / steps;
+
+    double checksum = 0;
+    for (GM::InstanceHandle handle : room->GetInstances()) {
+        if (GM::Instance* inst = manager.Get(handle)) {
+            checksum += inst->GetX() * 3 + inst->GetY() * 7 + inst->GetDepth() + inst->GetAlarm(0);
+        }
+    }
+    globals.GetRoomManager().SetCurrentRoom(nullptr);
+    room->Clear();
+    return { step_time, checksum };
+}
+
+int main() {
+    GM::GameEngine engine(nullptr);
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Hardware threads: " << hardware << std::endl << std::endl;
+    std::cout << std::left << std::setw(12) << "instances" << std::right << std::setw(10) << "threads"
+              << std::setw(14) << "step" << std::setw(10) << "speedup" << std::endl;
+
+    bool consistent = true;
+    for (size_t count : { 20000u, 100000u }) {
+        double base = 0, checksum = 0;
+        std::vector<size_t> thread_counts = { 1, 2, 4 };
+        if (hardware > 4) thread_counts.push_back(hardware);
+        for (size_t threads : thread_counts) {
+            // An untimed round first, so the first thread count timed doesn't
+            // also pay for page faults, pool growth and starting the workers
+            Run(engine, threads, count, 2);
+            Result r = Run(engine, threads, count, 20);
+            if (threads == 1) {
+                base = r.step_time;
+                checksum = r.checksum;
+            } else if (r.checksum != checksum) {
+                consistent = false;
+            }
+            std::cout << std::left << std::setw(12) << count << std::right << std::setw(10) << threads
+                      << std::fixed << std::setprecision(3) << std::setw(11) << r.step_time * 1e3 << " ms"
+                      << std::setw(9) << std::setprecision(2) << base / r.step_time << "x" << std::endl;
+        }
+    }
+
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: thread counts disagree" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: every thread count ends in the same state" << std::endl;
+    return 0;
+}
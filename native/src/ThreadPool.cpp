@@ -0,0 +1,111 @@
+#include "../include/ThreadPool.h"
+#include <algorithm>
+
+namespace GM {
+
+ThreadPool::ThreadPool(size_t threads)
+    : thread_count(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      queues(new Queue[thread_count]) {
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void ThreadPool::StartWorkers() {
+    // Thread 0 is whoever calls ParallelFor
+    for (size_t i = 1; i < thread_count; i++) {
+        workers.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t chunk_size, const ChunkFn& fn) {
+    size_t chunks = ChunkCount(count, chunk_size);
+    if (chunks <= 1 || thread_count == 1) {
+        for (size_t c = 0; c < chunks; c++) fn(c, c * chunk_size, std::min(count, (c + 1) * chunk_size));
+        return;
+    }
+    if (workers.empty()) StartWorkers();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &fn;
+        current_count = count;
+        current_chunk_size = chunk_size;
+        remaining = chunks;
+    }
+    // Contiguous blocks, so neighbouring chunks tend to share a thread
+    for (size_t t = 0; t < thread_count; t++) {
+        std::lock_guard<std::mutex> lock(queues[t].mutex);
+        for (size_t c = chunks * t / thread_count; c < chunks * (t + 1) / thread_count; c++) {
+            queues[t].chunks.push_back(c);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job++;
+    }
+    wake.notify_all();
+
+    while (RunChunk(0)) {}
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return remaining == 0 && active == 0; });
+    current = nullptr;
+}
+
+bool ThreadPool::RunChunk(size_t index) {
+    size_t chunk = 0;
+    bool found = false;
+    {
+        Queue& own = queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.chunks.empty()) {
+            chunk = own.chunks.front();
+            own.chunks.pop_front();
+            found = true;
+        }
+    }
+    for (size_t i = 1; !found && i < thread_count; i++) {
+        Queue& victim = queues[(index + i) % thread_count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.back();
+            victim.chunks.pop_back();
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    // Dealing the chunk (under the queue lock) happened after the call was
+    // published, so these reads see it
+    size_t begin = chunk * current_chunk_size;
+    (*current)(chunk, begin, std::min(current_count, begin + current_chunk_size));
+    if (remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || job != seen; });
+        if (stopping) return;
+        seen = job;
+        active++;
+        lock.unlock();
+        while (RunChunk(index)) {}
+        lock.lock();
+        if (--active == 0) done.notify_all();
+    }
+}
+
+} // namespace GM
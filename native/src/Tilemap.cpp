@@ -0,0 +1,331 @@
+#include "../include/Tilemap.h"
+#include "../include/IRenderer.h"
+#include "../include/Layer.h"
+#include "../include/Managers.h"
+#include "../include/Room.h"
+#include "../include/VM_Executor.h"
+#include <algorithm>
+#include <cmath>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace GM {
+
+namespace {
+
+inline uint32_t CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+// Bits lo..hi of a bitmap row
+inline uint32_t RowMask(uint32_t lo, uint32_t hi) {
+    uint64_t bits = ((uint64_t)1 << (hi + 1)) - ((uint64_t)1 << lo);
+    return (uint32_t)bits;
+}
+
+// The renderer has no textures yet, so tiles get a color per index
+Color TileColor(uint32_t tile) {
+    uint32_t index = tile & Tilemap::TILE_INDEX_MASK;
+    return 0xFF000000 | ((index * 35 + 60) & 0xFF) << 16 | ((index * 15 + 90) & 0xFF) << 8 |
+           ((index * 25 + 30) & 0xFF);
+}
+
+} // namespace
+
+static_assert(Tilemap::CHUNK_SIZE == 32, "bitmap rows are 32-bit words");
+
+Tilemap::Tilemap(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height,
+                 CellFormat format)
+    : width(width), height(height), tile_width(std::max(tile_width, 1u)),
+      tile_height(std::max(tile_height, 1u)), inverse_tile_width(1.0 / this->tile_width),
+      inverse_tile_height(1.0 / this->tile_height),
+      exact_x((this->tile_width & (this->tile_width - 1)) == 0),
+      exact_y((this->tile_height & (this->tile_height - 1)) == 0), format(format),
+      chunks_x((width + CHUNK_SIZE - 1) / CHUNK_SIZE), chunks_y((height + CHUNK_SIZE - 1) / CHUNK_SIZE),
+      chunks((size_t)chunks_x * chunks_y), cells(chunks.size(), nullptr) {
+}
+
+Tilemap::~Tilemap() {
+}
+
+bool Tilemap::Fits16(uint32_t data) {
+    return (data & TILE_INDEX_MASK) <= NARROW_INDEX_MASK;
+}
+
+uint16_t Tilemap::Pack16(uint32_t data) {
+    return (uint16_t)((data & NARROW_INDEX_MASK) | (data & (TILE_MIRROR | TILE_FLIP | TILE_ROTATE)) >> NARROW_FLAG_SHIFT);
+}
+
+void Tilemap::SetPosition(double new_x, double new_y) {
+    if (new_x == x && new_y == y) return;
+    x = new_x;
+    y = new_y;
+    for (auto& chunk : chunks) {
+        if (chunk) chunk->dirty_rows = ALL_ROWS;
+    }
+}
+
+bool Tilemap::Set(int64_t cell_x, int64_t cell_y, uint32_t data) {
+    if ((uint64_t)cell_x >= width || (uint64_t)cell_y >= height) return false;
+    data &= TILE_DATA_MASK;
+    uint32_t ux = (uint32_t)cell_x, uy = (uint32_t)cell_y;
+    size_t slot_index = (size_t)(uy >> CHUNK_SHIFT) * chunks_x + (ux >> CHUNK_SHIFT);
+    auto& slot = chunks[slot_index];
+    if (!slot) {
+        if (data == 0) return true;
+        slot = std::make_unique<Chunk>();
+        if (format == CellFormat::Bits16) {
+            slot->narrow.assign(CHUNK_SIZE * CHUNK_SIZE, 0);
+            cells[slot_index] = slot->narrow.data();
+        } else {
+            slot->wide.assign(CHUNK_SIZE * CHUNK_SIZE, 0);
+            cells[slot_index] = slot->wide.data();
+        }
+        chunk_count++;
+    }
+    if (format == CellFormat::Bits16 && !Fits16(data)) Widen();
+
+    Chunk& chunk = *slot;
+    uint32_t lx = ux & CHUNK_MASK, ly = uy & CHUNK_MASK;
+    uint32_t index = ly << CHUNK_SHIFT | lx;
+    uint32_t old = ReadCell(chunk, index);
+    if (old == data) return true;
+    if (format == CellFormat::Bits16) chunk.narrow[index] = Pack16(data);
+    else chunk.wide[index] = data;
+    chunk.dirty_rows |= 1u << ly;
+
+    if (old == 0) {
+        chunk.rows[ly] |= 1u << lx;
+        chunk.count++;
+        tile_count++;
+    } else if (data == 0) {
+        chunk.rows[ly] &= ~(1u << lx);
+        chunk.count--;
+        tile_count--;
+        if (chunk.count == 0) {
+            slot.reset();
+            cells[slot_index] = nullptr;
+            chunk_count--;
+        }
+    }
+    return true;
+}
+
+void Tilemap::Clear() {
+    for (auto& chunk : chunks) chunk.reset();
+    std::fill(cells.begin(), cells.end(), nullptr);
+    chunk_count = 0;
+    tile_count = 0;
+}
+
+void Tilemap::Widen() {
+    for (size_t i = 0; i < chunks.size(); i++) {
+        Chunk* chunk = chunks[i].get();
+        if (!chunk) continue;
+        chunk->wide.resize(CHUNK_SIZE * CHUNK_SIZE);
+        for (uint32_t j = 0; j < CHUNK_SIZE * CHUNK_SIZE; j++) chunk->wide[j] = Unpack16(chunk->narrow[j]);
+        std::vector<uint16_t>().swap(chunk->narrow);
+        cells[i] = chunk->wide.data();
+    }
+    format = CellFormat::Bits32;
+}
+
+bool Tilemap::Overlaps(const Rect& area) const {
+    // Cells whose closed bounds touch the area: one on an edge counts
+    double x0 = std::ceil((area.x1 - x) / tile_width) - 1, x1 = std::floor((area.x2 - x) / tile_width);
+    double y0 = std::ceil((area.y1 - y) / tile_height) - 1, y1 = std::floor((area.y2 - y) / tile_height);
+    x0 = std::max(x0, 0.0);
+    y0 = std::max(y0, 0.0);
+    x1 = std::min(x1, (double)width - 1);
+    y1 = std::min(y1, (double)height - 1);
+    if (x0 > x1 || y0 > y1) return false;
+
+    uint32_t cx0 = (uint32_t)x0, cy0 = (uint32_t)y0, cx1 = (uint32_t)x1, cy1 = (uint32_t)y1;
+    for (uint32_t chunk_y = cy0 / CHUNK_SIZE; chunk_y <= cy1 / CHUNK_SIZE; chunk_y++) {
+        uint32_t row0 = std::max(cy0, chunk_y * CHUNK_SIZE) - chunk_y * CHUNK_SIZE;
+        uint32_t row1 = std::min(cy1, chunk_y * CHUNK_SIZE + CHUNK_SIZE - 1) - chunk_y * CHUNK_SIZE;
+        for (uint32_t chunk_x = cx0 / CHUNK_SIZE; chunk_x <= cx1 / CHUNK_SIZE; chunk_x++) {
+            const Chunk* chunk = chunks[(size_t)chunk_y * chunks_x + chunk_x].get();
+            if (!chunk) continue;
+            uint32_t mask = RowMask(std::max(cx0, chunk_x * CHUNK_SIZE) - chunk_x * CHUNK_SIZE,
+                                    std::min(cx1, chunk_x * CHUNK_SIZE + CHUNK_SIZE - 1) - chunk_x * CHUNK_SIZE);
+            for (uint32_t row = row0; row <= row1; row++) {
+                if (chunk->rows[row] & mask) return true;
+            }
+        }
+    }
+    return false;
+}
+
+Tilemap::ChunkRange Tilemap::ChunksFor(const Rect& view) const {
+    double chunk_w = (double)tile_width * CHUNK_SIZE, chunk_h = (double)tile_height * CHUNK_SIZE;
+    double x0 = std::floor((view.x1 - x) / chunk_w), x1 = std::floor((view.x2 - x) / chunk_w) + 1;
+    double y0 = std::floor((view.y1 - y) / chunk_h), y1 = std::floor((view.y2 - y) / chunk_h) + 1;
+    ChunkRange range;
+    range.x0 = (uint32_t)std::clamp(x0, 0.0, (double)chunks_x);
+    range.x1 = (uint32_t)std::clamp(x1, 0.0, (double)chunks_x);
+    range.y0 = (uint32_t)std::clamp(y0, 0.0, (double)chunks_y);
+    range.y1 = (uint32_t)std::clamp(y1, 0.0, (double)chunks_y);
+    return range;
+}
+
+uint32_t Tilemap::BuildRow(const Chunk& chunk, uint32_t cx, uint32_t cy, uint32_t row, Quad* out) const {
+    double left = x + (double)cx * CHUNK_SIZE * tile_width;
+    double top = y + ((double)cy * CHUNK_SIZE + row) * tile_height;
+    float y1 = (float)top, y2 = (float)(top + tile_height);
+
+    // Runs compare raw cells, so only a run's first cell is unpacked
+    uint32_t count = 0;
+    auto append_runs = [&](const auto* line, auto unpack) {
+        uint32_t bits = chunk.rows[row];
+        while (bits) {
+            uint32_t start = CountTrailingZeros(bits);
+            uint32_t end = start + 1;
+            while (end < CHUNK_SIZE && line[end] == line[start]) end++;  // Empty cells end a run
+            bits &= ~RowMask(start, end - 1);
+            out[count++] = { (float)(left + (double)start * tile_width), y1, (float)(left + (double)end * tile_width),
+                             y2, unpack(line[start]), end - start };
+        }
+    };
+    if (format == CellFormat::Bits16) append_runs(chunk.narrow.data() + row * CHUNK_SIZE, Unpack16);
+    else append_runs(chunk.wide.data() + row * CHUNK_SIZE, [](uint32_t cell) { return cell; });
+    return count;
+}
+
+void Tilemap::BuildBatch(Chunk& chunk, uint32_t cx, uint32_t cy) {
+    // A row has at most CHUNK_SIZE runs
+    Quad runs[CHUNK_SIZE];
+    if (chunk.dirty_rows == ALL_ROWS) {
+        chunk.batch.clear();
+        for (uint32_t row = 0; row < CHUNK_SIZE; row++) {
+            uint32_t count = BuildRow(chunk, cx, cy, row, runs);
+            chunk.batch.insert(chunk.batch.end(), runs, runs + count);
+            chunk.row_quads[row] = (uint8_t)count;
+        }
+        row_rebuilds += CHUNK_SIZE;
+    } else {
+        // Only the edited rows: each one's new runs replace its old ones
+        // in place, and the rows after it shift over
+        size_t offset = 0;
+        uint32_t row = 0;
+        for (uint32_t dirty = chunk.dirty_rows; dirty; dirty &= dirty - 1) {
+            uint32_t edited = CountTrailingZeros(dirty);
+            for (; row < edited; row++) offset += chunk.row_quads[row];
+
+            uint32_t count = BuildRow(chunk, cx, cy, edited, runs);
+            uint32_t old_count = chunk.row_quads[edited];
+            auto at = chunk.batch.begin() + offset;
+            std::copy(runs, runs + std::min(count, old_count), at);
+            if (count > old_count) chunk.batch.insert(at + old_count, runs + old_count, runs + count);
+            else chunk.batch.erase(at + count, at + old_count);
+
+            chunk.row_quads[edited] = (uint8_t)count;
+            offset += count;
+            row = edited + 1;
+            row_rebuilds++;
+        }
+    }
+
+    chunk.dirty_rows = 0;
+    rebuilds++;
+}
+
+void Tilemap::Draw(IRenderer* renderer, const Rect& view) {
+    ForEachQuad(view, [renderer](const Quad& q) {
+        if (renderer) renderer->DrawQuad(q.x1, q.y1, q.x2, q.y1, q.x2, q.y2, q.x1, q.y2, TileColor(q.tile));
+    });
+}
+
+size_t Tilemap::GetMemoryUsage() const {
+    size_t bytes = chunks.capacity() * sizeof(chunks[0]) + cells.capacity() * sizeof(cells[0]);
+    for (const auto& chunk : chunks) {
+        if (!chunk) continue;
+        bytes += sizeof(Chunk) + chunk->narrow.capacity() * sizeof(uint16_t) +
+                 chunk->wide.capacity() * sizeof(uint32_t) + chunk->batch.capacity() * sizeof(Quad);
+    }
+    return bytes;
+}
+
+void RegisterTilemapBuiltins(VirtualMachine& vm, RoomManager& rooms) {
+    using Args = std::vector<Value>;
+    auto arg = [](const Args& args, size_t i) { return i < args.size() ? args[i].AsReal() : 0.0; };
+
+    // The tilemap on the current room's layer with this id, or null
+    auto tilemap_arg = [&rooms](double id) -> Tilemap* {
+        auto room = rooms.GetCurrentRoom();
+        if (!room || !(id >= 0 && id <= 4294967295.0)) return nullptr;
+        auto layer = room->GetLayer((uint32_t)id);
+        return layer ? layer->GetTilemap().get() : nullptr;
+    };
+    auto in_map = [](Tilemap* map, int64_t cell_x, int64_t cell_y) {
+        return cell_x >= 0 && cell_y >= 0 && cell_x < map->GetWidth() && cell_y < map->GetHeight();
+    };
+    // Cell coordinates are floored; NaN and anything past 32 bits become -1
+    // rather than going through an undefined cast
+    auto cell_arg = [arg](const Args& args, size_t i) -> int64_t {
+        double cell = std::floor(arg(args, i));
+        return cell >= 0 && cell < 4294967296.0 ? (int64_t)cell : -1;
+    };
+    // Tile data is a 32-bit value; negative, NaN or larger data is rejected
+    auto data_arg = [arg](const Args& args, size_t i, uint32_t& data) {
+        double v = arg(args, i);
+        if (!(v >= 0 && v <= 4294967295.0)) return false;
+        data = (uint32_t)v;
+        return true;
+    };
+
+    vm.RegisterBuiltIn("layer_tilemap_get_id", [tilemap_arg, arg](const Args& args) {
+        double id = arg(args, 0);
+        return Value(tilemap_arg(id) ? id : -1.0);
+    });
+    vm.RegisterBuiltIn("tilemap_get", [tilemap_arg, arg, in_map, cell_arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        int64_t cell_x = cell_arg(args, 1), cell_y = cell_arg(args, 2);
+        if (!map || !in_map(map, cell_x, cell_y)) return Value(-1.0);
+        return Value((double)map->Get(cell_x, cell_y));
+    });
+    vm.RegisterBuiltIn("tilemap_set", [tilemap_arg, arg, cell_arg, data_arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        uint32_t data;
+        if (!map || !data_arg(args, 1, data)) return Value(false);
+        return Value(map->Set(cell_arg(args, 2), cell_arg(args, 3), data));
+    });
+    vm.RegisterBuiltIn("tilemap_get_at_pixel", [tilemap_arg, arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        if (!map) return Value(-1.0);
+        int64_t cell_x = map->GetCellX(arg(args, 1)), cell_y = map->GetCellY(arg(args, 2));
+        if (cell_x < 0 || cell_y < 0) return Value(-1.0);
+        return Value((double)map->Get(cell_x, cell_y));
+    });
+    vm.RegisterBuiltIn("tilemap_set_at_pixel", [tilemap_arg, arg, data_arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        uint32_t data;
+        if (!map || !data_arg(args, 1, data)) return Value(false);
+        return Value(map->Set(map->GetCellX(arg(args, 2)), map->GetCellY(arg(args, 3)), data));
+    });
+    vm.RegisterBuiltIn("tilemap_get_cell_x_at_pixel", [tilemap_arg, arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        return Value(map ? (double)map->GetCellX(arg(args, 1)) : -1.0);
+    });
+    vm.RegisterBuiltIn("tilemap_get_cell_y_at_pixel", [tilemap_arg, arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        return Value(map ? (double)map->GetCellY(arg(args, 2)) : -1.0);
+    });
+    vm.RegisterBuiltIn("tilemap_get_width", [tilemap_arg, arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        return Value(map ? (double)map->GetWidth() : -1.0);
+    });
+    vm.RegisterBuiltIn("tilemap_get_height", [tilemap_arg, arg](const Args& args) {
+        Tilemap* map = tilemap_arg(arg(args, 0));
+        return Value(map ? (double)map->GetHeight() : -1.0);
+    });
+}
+
+} // namespace GM
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "../include/Tilemap.h"
+#include "../include/IRenderer.h"
+#include "../include/Random.h"
+#include "../include/Bench.h"
+
+// A 2048x2048 tile world seen through a 1280x720 view panning across it,
+// with a few tiles changing every frame. Chunked drawing from cached
+// batches is compared with walking the visible cells of a dense grid, area
+// queries with a per-cell test and point lookups with dense indexing. All
+// must agree with the dense grid.
+
+using GM::Bench::Clock;
+using GM::Bench::Seconds;
+
+// Counts quads; the checksum keeps the drawing from being optimized out
+class CountingRenderer : public IRenderer {
+public:
+    bool Init(int, int) override { return true; }
+    void Present() override {}
+    void Clear(unsigned int) override {}
+    void DrawRect(int, int, int, int, unsigned int, bool) override { quads++; }
+    void DrawQuad(float x1, float y1, float, float, float x3, float y3, float, float, unsigned int color) override {
+        quads++;
+        checksum += x1 + y1 + x3 + y3 + color;
+    }
+    void SetClearColor(unsigned int) override {}
+    void BeginFrame() override {}
+    void EndFrame() override {}
+
+    size_t quads = 0;
+    double checksum = 0;
+};
+
+int main() {
+    constexpr uint32_t CELLS = 2048;
+    constexpr uint32_t TILE = 16;
+    constexpr double VIEW_W = 1280, VIEW_H = 720;
+    constexpr int FRAMES = 600;
+    constexpr int SETS_PER_FRAME = 16;
+
+    // Terrain: open sky, solid ground in bands of tiles with the odd
+    // variant, and empty caves cut out of it
+    GM::RandomGenerator rng(7);
+    std::vector<uint32_t> dense((size_t)CELLS * CELLS, 0);
+    for (uint32_t cy = 0; cy < CELLS; cy++) {
+        for (uint32_t cx = 0; cx < CELLS; cx++) {
+            uint32_t ground = 256 + (cx / 64 % 7) * 24;
+            if (cy < ground) continue;
+            if ((cx / 48 + cy / 40) % 5 == 0 && cy > ground + 8) continue;
+            uint32_t tile = 1 + (cy - ground) / 6 % 4;
+            if (rng.IRange(0, 31) == 0) tile = 5 + (uint32_t)rng.IRange(0, 7);
+            if (rng.IRange(0, 63) == 0) tile |= GM::Tilemap::TILE_MIRROR;
+            dense[(size_t)cy * CELLS + cx] = tile;
+        }
+    }
+
+    GM::Tilemap narrow(CELLS, CELLS, TILE, TILE, GM::Tilemap::CellFormat::Bits16);
+    GM::Tilemap wide(CELLS, CELLS, TILE, TILE, GM::Tilemap::CellFormat::Bits32);
+    for (uint32_t cy = 0; cy < CELLS; cy++) {
+        for (uint32_t cx = 0; cx < CELLS; cx++) {
+            uint32_t tile = dense[(size_t)cy * CELLS + cx];
+            if (!tile) continue;
+            narrow.Set(cx, cy, tile);
+            wide.Set(cx, cy, tile);
+        }
+    }
+    GM::Tilemap& map = narrow;
+
+    std::cout << "Cells: " << CELLS << "x" << CELLS << ", tiles set: " << map.GetTileCount()
+              << ", chunks allocated: " << map.GetChunkCount() << " of "
+              << ((CELLS + 31) / 32) * ((CELLS + 31) / 32) << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Memory: dense 32-bit " << dense.size() * sizeof(uint32_t) / 1048576.0 << " MB, chunked 32-bit "
+              << wide.GetMemoryUsage() / 1048576.0 << " MB, chunked 16-bit " << narrow.GetMemoryUsage() / 1048576.0
+              << " MB" << std::endl << std::endl;
+
+    bool consistent = true;
+
+    // Drawing: the view pans diagonally, and each frame a few tiles near
+    // it change in both the tilemap and the dense grid
+    GM::RandomGenerator churn(3);
+    auto frame_view = [&](int frame) {
+        double vx = (double)frame / FRAMES * (CELLS * TILE - VIEW_W);
+        double vy = 3000 + (double)frame / FRAMES * (CELLS * TILE - VIEW_H - 3000);
+        return GM::Rect(vx, vy, vx + VIEW_W, vy + VIEW_H);
+    };
+    auto churn_frame = [&](int frame, bool chunked) {
+        const GM::Rect view = frame_view(frame);
+        for (int i = 0; i < SETS_PER_FRAME; i++) {
+            int64_t cx = (int64_t)(churn.Range(view.x1, view.x2) / TILE);
+            int64_t cy = (int64_t)(churn.Range(view.y1, view.y2) / TILE);
+            uint32_t tile = (uint32_t)churn.IRange(0, 8);
+            if (chunked) map.Set(cx, cy, tile);
+            else dense[(size_t)cy * CELLS + cx] = tile;
+        }
+    };
+
+    // Both go through the renderer interface, as a real renderer would
+    CountingRenderer naive_renderer;
+    IRenderer* volatile naive_target = &naive_renderer;
+    GM::RandomGenerator saved = churn;
+    auto start = Clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        churn_frame(frame, false);
+        IRenderer* renderer = naive_target;
+        const GM::Rect view = frame_view(frame);
+        int64_t x0 = (int64_t)(view.x1 / TILE), x1 = std::min<int64_t>((int64_t)(view.x2 / TILE), CELLS - 1);
+        int64_t y0 = (int64_t)(view.y1 / TILE), y1 = std::min<int64_t>((int64_t)(view.y2 / TILE), CELLS - 1);
+        for (int64_t cy = y0; cy <= y1; cy++) {
+            for (int64_t cx = x0; cx <= x1; cx++) {
+                uint32_t tile = dense[(size_t)cy * CELLS + cx];
+                if (!tile) continue;
+                float px = (float)(cx * TILE), py = (float)(cy * TILE);
+                renderer->DrawQuad(px, py, px + TILE, py, px + TILE, py + TILE, px, py + TILE, tile);
+            }
+        }
+    }
+    double naive_time = Seconds(start);
+
+    churn = saved;
+    CountingRenderer chunk_renderer;
+    size_t rebuilds_before = map.GetRebuildCount(), row_rebuilds_before = map.GetRowRebuildCount();
+    start = Clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        churn_frame(frame, true);
+        map.Draw(&chunk_renderer, frame_view(frame));
+    }
+    double chunk_time = Seconds(start);
+    size_t rebuilds = map.GetRebuildCount() - rebuilds_before;
+    size_t row_rebuilds = map.GetRowRebuildCount() - row_rebuilds_before;
+
+    // The same pan again with nothing changing: every batch comes from
+    // the cache
+    CountingRenderer cached_renderer;
+    start = Clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) map.Draw(&cached_renderer, frame_view(frame));
+    double cached_time = Seconds(start);
+    size_t cached_rebuilds = map.GetRebuildCount() - rebuilds_before - rebuilds;
+
+    std::cout << "draw (" << FRAMES << " frames, " << SETS_PER_FRAME << " tilemap_set per frame)" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "dense per-cell" << std::right << std::setw(10)
+              << naive_time / FRAMES * 1e6 << " us/frame" << std::setw(12) << naive_renderer.quads / FRAMES
+              << " quads/frame" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "chunked batches" << std::right << std::setw(10)
+              << chunk_time / FRAMES * 1e6 << " us/frame" << std::setw(12) << chunk_renderer.quads / FRAMES
+              << " quads/frame" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "chunked, no edits" << std::right << std::setw(10)
+              << cached_time / FRAMES * 1e6 << " us/frame" << std::setw(12) << cached_renderer.quads / FRAMES
+              << " quads/frame" << std::endl;
+    std::cout << "  chunk rebuilds: " << (double)rebuilds / FRAMES << " per frame with edits ("
+              << (double)row_rebuilds / FRAMES << " rows), " << cached_rebuilds << " without" << std::endl
+              << std::endl;
+
+    // The churned tilemap must still match the churned grid
+    for (uint32_t cy = 0; cy < CELLS && consistent; cy++) {
+        for (uint32_t cx = 0; cx < CELLS; cx++) {
+            if (map.Get(cx, cy) != dense[(size_t)cy * CELLS + cx]) {
+                consistent = false;
+                break;
+            }
+        }
+    }
+
+    // Every non-empty cell is covered by exactly one quad of its own tile
+    std::vector<uint8_t> covered(dense.size(), 0);
+    size_t covered_count = 0;
+    map.ForEachQuad({ 0, 0, (double)CELLS * TILE, (double)CELLS * TILE }, [&](const GM::Tilemap::Quad& q) {
+        int64_t cy = (int64_t)(q.y1 / TILE), cx0 = (int64_t)(q.x1 / TILE);
+        for (int64_t cx = cx0; cx < cx0 + q.run; cx++) {
+            size_t index = (size_t)cy * CELLS + cx;
+            if (covered[index]++ || dense[index] != q.tile) consistent = false;
+            covered_count++;
+        }
+    });
+    if (covered_count != map.GetTileCount()) consistent = false;
+
+    // Area queries, as tile collisions would make them
+    constexpr int QUERIES = 200000;
+    std::vector<GM::Rect> areas;
+    GM::RandomGenerator query_rng(5);
+    for (int i = 0; i < QUERIES; i++) {
+        double x = query_rng.Range(0, CELLS * TILE), y = query_rng.Range(0, CELLS * TILE);
+        double size = query_rng.Range(8, 128);
+        areas.emplace_back(x, y, x + size, y + size);
+    }
+    auto dense_overlaps = [&](const GM::Rect& area) {
+        int64_t x0 = std::max<int64_t>((int64_t)std::ceil(area.x1 / TILE) - 1, 0);
+        int64_t y0 = std::max<int64_t>((int64_t)std::ceil(area.y1 / TILE) - 1, 0);
+        int64_t x1 = std::min<int64_t>((int64_t)std::floor(area.x2 / TILE), CELLS - 1);
+        int64_t y1 = std::min<int64_t>((int64_t)std::floor(area.y2 / TILE), CELLS - 1);
+        for (int64_t cy = y0; cy <= y1; cy++) {
+            for (int64_t cx = x0; cx <= x1; cx++) {
+                if (dense[(size_t)cy * CELLS + cx]) return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<uint8_t> naive_hits(QUERIES), chunk_hits(QUERIES);
+    start = Clock::now();
+    for (int i = 0; i < QUERIES; i++) naive_hits[i] = dense_overlaps(areas[i]);
+    double naive_query = Seconds(start);
+    start = Clock::now();
+    for (int i = 0; i < QUERIES; i++) chunk_hits[i] = map.Overlaps(areas[i]);
+    double chunk_query = Seconds(start);
+    if (naive_hits != chunk_hits) consistent = false;
+
+    // Point lookups, each run once untimed so neither pays for warming
+    // the caches the other left behind
+    double lookup_sum = 0;
+    auto tilemap_lookups = [&] {
+        for (int i = 0; i < QUERIES; i++) lookup_sum += map.GetAtPixel(areas[i].x1, areas[i].y1);
+    };
+    auto dense_lookups = [&] {
+        for (int i = 0; i < QUERIES; i++) {
+            lookup_sum += dense[(size_t)(areas[i].y1 / TILE) * CELLS + (size_t)(areas[i].x1 / TILE)];
+        }
+    };
+    tilemap_lookups();
+    start = Clock::now();
+    tilemap_lookups();
+    double lookup_time = Seconds(start);
+    dense_lookups();
+    start = Clock::now();
+    dense_lookups();
+    double dense_lookup_time = Seconds(start);
+    for (int i = 0; i < QUERIES; i++) {
+        uint32_t expected = dense[(size_t)(areas[i].y1 / TILE) * CELLS + (size_t)(areas[i].x1 / TILE)];
+        if (map.GetAtPixel(areas[i].x1, areas[i].y1) != expected) consistent = false;
+    }
+
+    std::cout << "area queries (" << QUERIES << ")" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "dense per-cell" << std::right << std::setw(10)
+              << naive_query * 1e3 << " ms" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "chunk row bitmaps" << std::right << std::setw(10)
+              << chunk_query * 1e3 << " ms" << std::endl;
+    std::cout << "point lookups (" << QUERIES << ")" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "dense grid" << std::right << std::setw(10)
+              << dense_lookup_time * 1e9 / QUERIES << " ns/lookup" << std::endl;
+    std::cout << "  " << std::left << std::setw(22) << "tilemap_get_at_pixel" << std::right << std::setw(10)
+              << lookup_time * 1e9 / QUERIES << " ns/lookup" << std::endl;
+
+    // A tile index past 16 bits widens the map and keeps every cell
+    GM::Tilemap widened(64, 64, TILE, TILE, GM::Tilemap::CellFormat::Bits16);
+    widened.Set(3, 4, 7 | GM::Tilemap::TILE_FLIP);
+    widened.Set(40, 50, 9000 | GM::Tilemap::TILE_ROTATE);
+    if (widened.GetCellFormat() != GM::Tilemap::CellFormat::Bits32 ||
+        widened.Get(3, 4) != (7 | GM::Tilemap::TILE_FLIP) || widened.Get(40, 50) != (9000 | GM::Tilemap::TILE_ROTATE)) {
+        consistent = false;
+    }
+
+    // Emptied chunks are given back
+    GM::Tilemap emptied(64, 64, TILE, TILE);
+    emptied.Set(1, 1, 1);
+    emptied.Set(1, 1, 0);
+    if (emptied.GetChunkCount() != 0 || emptied.GetTileCount() != 0) consistent = false;
+
+    if (cached_renderer.quads == 0 || chunk_renderer.checksum == 0 || lookup_sum < 0) consistent = false;
+    if (!consistent) {
+        std::cout << std::endl << "FAILURE: tilemap disagrees with the dense grid" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "SUCCESS: chunked tilemap matches the dense grid" << std::endl;
+    return 0;
+}
@@ -18,6 +18,14 @@ void VirtualMachine::LoadCodeBlocks(const std::vector<CodeBlock>& blocks) {
     }
 }
 
+void VirtualMachine::RegisterBuiltIn(const std::string& name, BuiltInFunction fn) {
+    builtIns_[name] = std::move(fn);
+}
+
+bool VirtualMachine::HasBuiltIn(const std::string& name) const {
+    return builtIns_.find(name) != builtIns_.end();
+}
+
 Value VirtualMachine::ExecuteFunction(const std::string& functionName) {
     auto it = codeBlocks_.find(functionName);
     if (it == codeBlocks_.end()) {
@@ -275,8 +283,17 @@ Value VirtualMachine::ExecuteInstruction(const Instruction& instr) {
 
         case OpCode::CALL: {
             // Simple function call by name
-            if (!instr.operandStr.empty()) {
+            if (instr.operandStr.empty()) break;
+            if (codeBlocks_.find(instr.operandStr) != codeBlocks_.end()) {
                 ExecuteFunction(instr.operandStr);
+            } else {
+                // Built-in: operand1 holds the argument count, arguments are pushed in order
+                size_t argc = (size_t)std::max(0.0, instr.operand1.AsReal());
+                std::vector<Value> args(argc);
+                for (size_t i = argc; i > 0; --i) {
+                    args[i - 1] = PopStack();
+                }
+                PushStack(CallBuiltIn(instr.operandStr, args));
             }
             break;
         }
@@ -326,6 +343,11 @@ Value VirtualMachine::PeekStack() const {
 }
 
 Value VirtualMachine::CallBuiltIn(const std::string& name, const std::vector<Value>& args) {
+    auto it = builtIns_.find(name);
+    if (it != builtIns_.end()) {
+        return it->second(args);
+    }
+
     // Basic built-in functions
     if (name == "print" && !args.empty()) {
         std::cout << args[0].AsString() << std::endl;
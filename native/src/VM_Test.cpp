@@ -1,5 +1,32 @@
 #include <iostream>
+#include <cmath>
 #include "../include/VM_Executor.h"
+#include "../include/DataStructures.h"
+#include "../include/Buffer.h"
+#include "../include/JsonCodec.h"
+#include "../include/Random.h"
+#include "../include/Managers.h"
+#include "../include/Object.h"
+#include "../include/Collision.h"
+#include "../include/Room.h"
+#include "../include/Sprite.h"
+#include "../include/Tilemap.h"
+
+// Runs name(args...) as its own code block, the way compiled GML calls a
+// built-in with constant arguments
+static GM::Value CallBuiltIn(GM::VirtualMachine& vm, const std::string& name, const std::vector<double>& args) {
+    static int next_id = 100;
+    GM::CodeBlock call;
+    call.name = "Call" + std::to_string(next_id);
+    call.id = next_id++;
+    for (double arg : args) {
+        call.instructions.push_back({ GM::OpCode::PUSHI, GM::Value(arg), GM::Value(), "" });
+    }
+    call.instructions.push_back({ GM::OpCode::CALL, GM::Value((double)args.size()), GM::Value(), name });
+    call.instructions.push_back({ GM::OpCode::RET, GM::Value(), GM::Value(), "" });
+    vm.AddCodeBlock(call);
+    return vm.ExecuteFunction(call.name);
+}
 
 int main() {
     GM::VirtualMachine vm;
@@ -17,16 +44,425 @@ int main() {
     };
 
     vm.AddCodeBlock(testAdd);
-    
+
     // Execute and check result
     GM::Value result = vm.ExecuteFunction("TestAdd");
     std::cout << "Result of 5 + 3 = " << result.AsReal() << std::endl;
-    
+
     if (result.AsReal() == 8.0) {
         std::cout << "SUCCESS: VM arithmetic test passed!" << std::endl;
-        return 0;
     } else {
         std::cout << "FAILURE: Expected 8.0, got " << result.AsReal() << std::endl;
         return 1;
     }
+
+    // Built-in test: map = ds_map_create(); ds_map_set(map, "hp", 42); return ds_map_find_value(map, "hp")
+    GM::DataStructureManager ds;
+    GM::RegisterDataStructureBuiltins(vm, ds);
+
+    GM::CodeBlock testMap;
+    testMap.name = "TestMap";
+    testMap.id = 2;
+    testMap.instructions = {
+        { GM::OpCode::CALL, GM::Value(0.0), GM::Value(), "ds_map_create" },
+        { GM::OpCode::DUP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::DUP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHS, GM::Value(), GM::Value(), "hp" },
+        { GM::OpCode::PUSHI, GM::Value(42.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(3.0), GM::Value(), "ds_map_set" },
+        { GM::OpCode::DROP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHS, GM::Value(), GM::Value(), "hp" },
+        { GM::OpCode::CALL, GM::Value(2.0), GM::Value(), "ds_map_find_value" },
+        { GM::OpCode::RET, GM::Value(), GM::Value(), "" }
+    };
+
+    vm.AddCodeBlock(testMap);
+
+    result = vm.ExecuteFunction("TestMap");
+    std::cout << "ds_map_find_value(map, \"hp\") = " << result.AsReal() << std::endl;
+
+    if (result.AsReal() == 42.0 && ds.GetMaps().Count() == 1) {
+        std::cout << "SUCCESS: VM ds_map built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: Expected 42.0, got " << result.AsReal() << std::endl;
+        return 1;
+    }
+
+    // ds_* arguments saturate instead of overflowing the integer cast, and grid sizes
+    // past 32 bits or DSGrid::MAX_CELLS are rejected rather than truncated
+    auto ds_call = [&](const char* name, const std::vector<double>& args) { return CallBuiltIn(vm, name, args); };
+    double grid = ds_call("ds_grid_create", { 3, 2 }).AsReal();
+    bool grid_sizes = grid >= 0 && ds_call("ds_grid_create", { 4294967296.0, 1 }).AsReal() == -1 &&
+                      ds_call("ds_grid_create", { 1, NAN }).AsReal() == -1 &&
+                      ds_call("ds_grid_create", { 1e300, 1 }).AsReal() == -1 &&
+                      ds_call("ds_grid_create", { 65536, 65536 }).AsReal() == -1;
+    ds_call("ds_grid_resize", { grid, 4294967296.0, 1 });
+    grid_sizes = grid_sizes && ds_call("ds_grid_width", { grid }).AsReal() == 3;
+    ds_call("ds_grid_set", { grid, 2, 1, 5 });
+    double list = ds_call("ds_list_create", {}).AsReal();
+    ds_call("ds_list_add", { list, 9 });
+    bool saturated = ds_call("ds_grid_get", { grid, 2, 1 }).AsReal() == 5 &&
+                     ds_call("ds_grid_get", { grid, 1e300, 1 }).IsUndefined() &&
+                     ds_call("ds_grid_get", { grid, -1e300, NAN }).IsUndefined() &&
+                     ds_call("ds_list_find_value", { list, 1e300 }).IsUndefined() &&
+                     ds_call("ds_list_find_value", { list, NAN }).AsReal() == 9;
+    std::cout << "ds_grid sizes / saturated arguments = " << grid_sizes << saturated << std::endl;
+
+    if (grid_sizes && saturated) {
+        std::cout << "SUCCESS: VM ds argument test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: a ds_* built-in mishandled an out-of-range argument" << std::endl;
+        return 1;
+    }
+
+    // Disks with non-finite or far-off arguments touch nothing; a huge radius covers the grid
+    const double INF = INFINITY;
+    for (auto disk : std::vector<std::vector<double>>{ { NAN, 1, 5 }, { INF, 1, 5 }, { 0, 0, INF }, { 1e300, 0, 1 },
+                                                       { -1e300, -1e300, 1e10 }, { 1, -INF, 1 } }) {
+        ds_call("ds_grid_set_disk", { grid, disk[0], disk[1], disk[2], 7 });
+    }
+    bool disks = ds_call("ds_grid_get_disk_sum", { grid, 1, 1, 10 }).AsReal() == 5 &&
+                 ds_call("ds_grid_get_disk_sum", { grid, 1, 1, 1e200 }).AsReal() == 5 &&
+                 ds_call("ds_grid_get_disk_max", { grid, NAN, 1, 10 }).AsReal() == 0;
+    std::cout << "ds_grid disks with non-finite arguments = " << disks << std::endl;
+
+    if (disks) {
+        std::cout << "SUCCESS: VM ds_grid disk test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: a ds_grid disk built-in changed cells outside the disk" << std::endl;
+        return 1;
+    }
+
+    // Buffer test: buffer_create(1, buffer_grow, 4); write u8 7 and s32 -5; seek to start; return u8 + s32
+    // (the first handle issued is 0)
+    GM::BufferManager buffers;
+    GM::RegisterBufferBuiltins(vm, buffers);
+
+    GM::CodeBlock testBuffer;
+    testBuffer.name = "TestBuffer";
+    testBuffer.id = 3;
+    testBuffer.instructions = {
+        { GM::OpCode::PUSHI, GM::Value(1.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(1.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(4.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(3.0), GM::Value(), "buffer_create" },
+        { GM::OpCode::DUP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(1.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(7.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(3.0), GM::Value(), "buffer_write" },
+        { GM::OpCode::DROP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::DUP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(6.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(-5.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(3.0), GM::Value(), "buffer_write" },
+        { GM::OpCode::DROP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(0.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(0.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(3.0), GM::Value(), "buffer_seek" },
+        { GM::OpCode::DROP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(0.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(1.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(2.0), GM::Value(), "buffer_read" },
+        { GM::OpCode::PUSHI, GM::Value(0.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(6.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(2.0), GM::Value(), "buffer_read" },
+        { GM::OpCode::ADD, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::RET, GM::Value(), GM::Value(), "" }
+    };
+
+    vm.AddCodeBlock(testBuffer);
+
+    result = vm.ExecuteFunction("TestBuffer");
+    std::cout << "buffer u8 7 + s32 -5 = " << result.AsReal() << std::endl;
+
+    // The s32 lands on the 4-byte boundary, so the grow buffer ends up 8 bytes long
+    GM::Buffer* buffer = buffers.GetBuffers().Get(0);
+    if (result.AsReal() == 2.0 && buffer && buffer->GetSize() == 8) {
+        std::cout << "SUCCESS: VM buffer built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: Expected 2.0, got " << result.AsReal() << std::endl;
+        return 1;
+    }
+
+    // Sizes past the arena limit fail with a status instead of reaching the allocator,
+    // and copies into an empty fixed buffer are out of bounds rather than growing it
+    auto buffer_call = [&](const char* name, const std::vector<double>& args) { return CallBuiltIn(vm, name, args).AsReal(); };
+    const double HUGE_SIZE = 1e12, INT64_LIMIT = 9223372036854775807.0;
+    double wrap = buffer_call("buffer_create", { 8, 2, 1 });
+    double grow = buffer_call("buffer_create", { 0, 1, 1 });
+    double empty = buffer_call("buffer_create", { 0, 0, 1 });
+    bool created = buffer_call("buffer_create", { HUGE_SIZE, 1, 1 }) == -1 && wrap >= 0 && grow >= 0 && empty >= 0;
+    bool copied = buffer_call("buffer_copy", { wrap, 0, INT64_LIMIT, grow, INT64_LIMIT }) == -2 &&
+                  buffer_call("buffer_get_size", { grow }) == 0 &&
+                  buffer_call("buffer_copy", { wrap, 0, 100, grow, 0 }) == 0 && buffer_call("buffer_get_size", { grow }) == 8 &&
+                  buffer_call("buffer_copy", { wrap, 0, 4, empty, 0 }) == -3 && buffer_call("buffer_get_size", { empty }) == 0;
+    bool sized = buffer_call("buffer_resize", { grow, HUGE_SIZE }) == -2 && buffer_call("buffer_get_size", { grow }) == 8 &&
+                 buffer_call("buffer_fill", { grow, 4, 1, 1, INT64_LIMIT }) == -2 &&
+                 buffer_call("buffer_fill", { wrap, INT64_LIMIT, 1, 1, INT64_LIMIT }) == 0;
+    std::cout << "buffer create/copy/resize limits = " << created << copied << sized << std::endl;
+
+    if (created && copied && sized) {
+        std::cout << "SUCCESS: VM buffer limit test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: an oversized buffer request was not rejected" << std::endl;
+        return 1;
+    }
+
+    // JSON test: return json_stringify(json_parse(text)) - escapes and nesting must survive the round trip
+    GM::RegisterJsonBuiltins(vm);
+
+    const std::string json = "{\"name\":\"Hero \\\"Bob\\\"\",\"pos\":[1.5,-2,{\"ok\":true,\"tag\":null}]}";
+    GM::CodeBlock testJson;
+    testJson.name = "TestJson";
+    testJson.id = 4;
+    testJson.instructions = {
+        { GM::OpCode::PUSHS, GM::Value(), GM::Value(), json },
+        { GM::OpCode::CALL, GM::Value(1.0), GM::Value(), "json_parse" },
+        { GM::OpCode::CALL, GM::Value(1.0), GM::Value(), "json_stringify" },
+        { GM::OpCode::RET, GM::Value(), GM::Value(), "" }
+    };
+
+    vm.AddCodeBlock(testJson);
+
+    result = vm.ExecuteFunction("TestJson");
+    std::cout << "json_stringify(json_parse(text)) = " << result.AsString() << std::endl;
+
+    if (result.IsString() && result.GetStringRef() == json) {
+        std::cout << "SUCCESS: VM json built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: Expected " << json << std::endl;
+        return 1;
+    }
+
+    // Random test: random_set_seed(7); return irandom_range(1, 1000) - must match a fresh generator seeded with 7
+    GM::RandomGenerator rng;
+    GM::RegisterRandomBuiltins(vm, rng);
+
+    GM::CodeBlock testRandom;
+    testRandom.name = "TestRandom";
+    testRandom.id = 5;
+    testRandom.instructions = {
+        { GM::OpCode::PUSHI, GM::Value(7.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(1.0), GM::Value(), "random_set_seed" },
+        { GM::OpCode::DROP, GM::Value(), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(1.0), GM::Value(), "" },
+        { GM::OpCode::PUSHI, GM::Value(1000.0), GM::Value(), "" },
+        { GM::OpCode::CALL, GM::Value(2.0), GM::Value(), "irandom_range" },
+        { GM::OpCode::RET, GM::Value(), GM::Value(), "" }
+    };
+
+    vm.AddCodeBlock(testRandom);
+
+    result = vm.ExecuteFunction("TestRandom");
+    double expected = (double)GM::RandomGenerator(7).IRange(1, 1000);
+    std::cout << "irandom_range(1, 1000) with seed 7 = " << result.AsReal() << std::endl;
+
+    if (result.AsReal() == expected && rng.GetSeed() == 7) {
+        std::cout << "SUCCESS: VM random built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: Expected " << expected << ", got " << result.AsReal() << std::endl;
+        return 1;
+    }
+
+    // Instance test: instance_destroy only marks the instance, so it still exists until the
+    // step ends (ApplyPending). After that its handle is dead, and stays dead once a new
+    // instance reuses the slot under the next generation.
+    GM::GameGlobals& globals = GM::GameGlobals::Get();
+    GM::InstanceManager& instances = globals.GetInstanceManager();
+    GM::RegisterInstanceBuiltins(vm, instances);
+
+    auto enemy = std::make_shared<GM::Object>(1, "obj_enemy");
+    globals.GetObjectManager().AddObject(enemy);
+    GM::InstanceHandle doomed = instances.Create(0, 0, 100001, enemy.get());
+    GM::InstanceHandle survivor = instances.Create(0, 0, 100002, enemy.get());
+
+    bool live = CallBuiltIn(vm, "instance_exists", { (double)doomed }).AsReal() == 1.0;
+    CallBuiltIn(vm, "instance_destroy", { (double)doomed });
+    bool deferred = CallBuiltIn(vm, "instance_exists", { (double)doomed }).AsReal() == 1.0 &&
+                    CallBuiltIn(vm, "instance_count", {}).AsReal() == 2.0;
+    instances.ApplyPending();
+    bool destroyed = CallBuiltIn(vm, "instance_exists", { (double)doomed }).AsReal() == 0.0 &&
+                     CallBuiltIn(vm, "instance_exists", { (double)survivor }).AsReal() == 1.0 &&
+                     CallBuiltIn(vm, "instance_count", {}).AsReal() == 1.0;
+
+    GM::InstanceHandle reused = instances.Create(0, 0, 100003, enemy.get());
+    const auto slot_mask = GM::InstanceManager::InstanceTable::INDEX_MASK;
+    bool same_slot = (reused & slot_mask) == (doomed & slot_mask) && reused != doomed;
+    bool stale = CallBuiltIn(vm, "instance_exists", { (double)doomed }).AsReal() == 0.0 &&
+                 CallBuiltIn(vm, "instance_exists", { (double)reused }).AsReal() == 1.0 &&
+                 CallBuiltIn(vm, "instance_exists", { GM::Collision::NOONE }).AsReal() == 0.0;
+    std::cout << "instance_exists live/deferred/destroyed/stale = " << live << deferred << destroyed << stale << std::endl;
+
+    if (live && deferred && destroyed && same_slot && stale) {
+        std::cout << "SUCCESS: VM instance built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: instance_exists disagreed with the instance's lifetime" << std::endl;
+        return 1;
+    }
+
+    // Collision test: a wall at (100, 100), a child of the wall at (300, 100) and a blob at
+    // (500, 100), all 32x32. Only the blob's left half is solid, and its sprite is precise.
+    GM::RegisterCollisionBuiltins(vm, globals.GetRoomManager());
+    const double ALL = GM::Collision::OBJECT_ALL, NOONE = GM::Collision::NOONE;
+
+    auto block = std::make_shared<GM::Sprite>(1, "spr_block");
+    block->SetBBoxMode(2);
+    block->SetBBox(GM::Rect(0, 0, 32, 32));
+    auto blob = std::make_shared<GM::Sprite>(2, "spr_blob");
+    blob->SetBBoxMode(2);
+    blob->SetBBox(GM::Rect(0, 0, 32, 32));
+    blob->SetCollisionType(GM::SpriteCollisionType::Precise);
+    GM::CollisionMask blob_mask(32, 32);
+    for (uint32_t y = 0; y < 32; y++) {
+        for (uint32_t x = 0; x < 16; x++) blob_mask.Set(x, y, true);
+    }
+    blob_mask.UpdateBounds();
+    blob->SetMask(0, blob_mask);
+    globals.GetSpriteManager().AddSprite(block);
+    globals.GetSpriteManager().AddSprite(blob);
+
+    auto wall = std::make_shared<GM::Object>(2, "obj_wall");
+    auto crate = std::make_shared<GM::Object>(3, "obj_crate");
+    auto slime = std::make_shared<GM::Object>(4, "obj_slime");
+    crate->SetParent(wall);
+    wall->SetSpriteIndex(1);
+    crate->SetSpriteIndex(1);
+    slime->SetSpriteIndex(2);
+    for (auto& obj : { wall, crate, slime }) globals.GetObjectManager().AddObject(obj);
+
+    auto room = std::make_shared<GM::Room>(1, "rm_test");
+    globals.GetRoomManager().AddRoom(room);
+    globals.GetRoomManager().SetCurrentRoom(room);
+    GM::InstanceHandle wall_inst = wall->CreateInstance(100, 100, 100010);
+    GM::InstanceHandle crate_inst = crate->CreateInstance(300, 100, 100011);
+    GM::InstanceHandle slime_inst = slime->CreateInstance(500, 100, 100012);
+    for (GM::InstanceHandle handle : { wall_inst, crate_inst, slime_inst }) room->AddInstance(handle);
+
+    auto hits = [&](const char* name, const std::vector<double>& args, GM::InstanceHandle want) {
+        double got = CallBuiltIn(vm, name, args).AsReal();
+        return got == (want == GM::INVALID_INSTANCE ? NOONE : (double)want);
+    };
+    // The wall's object matches the crate, but not the other way round; precise
+    // queries miss the empty half of the blob
+    bool point = hits("collision_point", { 110, 110, 2, 0 }, wall_inst) &&
+                 hits("collision_point", { 310, 110, 2, 0 }, crate_inst) &&
+                 hits("collision_point", { 110, 110, 3, 0 }, GM::INVALID_INSTANCE) &&
+                 hits("collision_point", { 520, 110, ALL, 0 }, slime_inst) &&
+                 hits("collision_point", { 520, 110, ALL, 1 }, GM::INVALID_INSTANCE) &&
+                 hits("collision_point", { 505, 110, 4, 1 }, slime_inst) &&
+                 hits("collision_point", { 200, 110, ALL, 0 }, GM::INVALID_INSTANCE);
+    bool rectangle = hits("collision_rectangle", { 290, 90, 340, 140, 2, 0 }, crate_inst) &&
+                     hits("collision_rectangle", { 520, 90, 540, 140, 4, 0 }, slime_inst) &&
+                     hits("collision_rectangle", { 520, 90, 540, 140, 4, 1 }, GM::INVALID_INSTANCE) &&
+                     hits("collision_rectangle", { 540, 140, 510, 90, 4, 1 }, slime_inst) &&
+                     hits("collision_rectangle", { 140, 90, 280, 140, ALL, 0 }, GM::INVALID_INSTANCE);
+    bool circle = hits("collision_circle", { 90, 90, 15, 2 }, wall_inst) &&
+                  hits("collision_circle", { 90, 90, 13, 2 }, GM::INVALID_INSTANCE) &&
+                  hits("collision_circle", { 316, 150, 20, ALL }, crate_inst) &&
+                  hits("collision_circle", { 316, 150, 20, 4 }, GM::INVALID_INSTANCE);
+    // Lines report the hit nearest their start
+    bool line = hits("collision_line", { 0, 116, 1000, 116, ALL }, wall_inst) &&
+                hits("collision_line", { 1000, 116, 0, 116, ALL }, slime_inst) &&
+                hits("collision_line", { 1000, 116, 0, 116, 2 }, crate_inst) &&
+                hits("collision_line", { 0, 50, 1000, 50, ALL }, GM::INVALID_INSTANCE);
+    // Object arguments that are NaN or outside int32 name nothing
+    bool bad_object = true;
+    for (double object : { (double)NAN, 1e300, -1e300, 4294967298.0 }) {
+        bad_object = bad_object && hits("collision_point", { 110, 110, object, 0 }, GM::INVALID_INSTANCE) &&
+                     hits("collision_rectangle", { 90, 90, 140, 140, object, 0 }, GM::INVALID_INSTANCE) &&
+                     hits("collision_circle", { 116, 116, 20, object }, GM::INVALID_INSTANCE) &&
+                     hits("collision_line", { 0, 116, 1000, 116, object }, GM::INVALID_INSTANCE);
+    }
+    std::cout << "collision point/rectangle/circle/line/bad object = " << point << rectangle << circle << line
+              << bad_object << std::endl;
+
+    if (point && rectangle && circle && line && bad_object) {
+        std::cout << "SUCCESS: VM collision built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: a collision built-in returned the wrong instance" << std::endl;
+        return 1;
+    }
+
+    // Object test: two barrels whose parent is the crate make a wall -> crate -> barrel chain.
+    // instance_find walks parents before children, then each object's instances in creation order.
+    GM::RegisterObjectBuiltins(vm, globals.GetObjectManager(), globals.GetRoomManager());
+
+    auto barrel = std::make_shared<GM::Object>(5, "obj_barrel");
+    barrel->SetParent(crate);
+    barrel->SetSpriteIndex(1);
+    globals.GetObjectManager().AddObject(barrel);
+    GM::InstanceHandle barrel_first = barrel->CreateInstance(700, 100, 100013);
+    GM::InstanceHandle barrel_second = barrel->CreateInstance(800, 100, 100014);
+    room->AddInstance(barrel_first);
+    room->AddInstance(barrel_second);
+
+    auto number = [&](double obj) { return CallBuiltIn(vm, "instance_number", { obj }).AsReal(); };
+    auto find = [&](double obj, double n, GM::InstanceHandle want) {
+        double got = CallBuiltIn(vm, "instance_find", { obj, n }).AsReal();
+        return got == (want == GM::INVALID_INSTANCE ? NOONE : (double)want);
+    };
+    bool counted = number(2) == 4 && number(3) == 3 && number(5) == 2 && number(ALL) == 5 && number(99) == 0;
+    bool found = find(2, 0, wall_inst) && find(2, 1, crate_inst) && find(2, 2, barrel_first) &&
+                 find(2, 3, barrel_second) && find(2, 4, GM::INVALID_INSTANCE) &&
+                 find(5, 1, barrel_second) && find(ALL, 2, slime_inst) && find(ALL, 5, GM::INVALID_INSTANCE) &&
+                 find(2, -1, GM::INVALID_INSTANCE) && number(NAN) == 0 && number(1e300) == 0 &&
+                 find(NAN, 0, GM::INVALID_INSTANCE) && find(-1e300, 0, GM::INVALID_INSTANCE);
+
+    // A child object going away must drop out of its ancestors' cached descendants
+    {
+        auto ghost = std::make_shared<GM::Object>(6, "obj_ghost");
+        ghost->SetParent(barrel);
+        counted = counted && wall->GetDescendants().size() == 4;
+    }
+    counted = counted && wall->GetDescendants().size() == 3 && number(2) == 4;
+    std::cout << "instance_number/instance_find = " << counted << found << std::endl;
+
+    if (counted && found) {
+        std::cout << "SUCCESS: VM object built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: instance_number or instance_find missed the parent chain" << std::endl;
+        return 1;
+    }
+
+    // Tilemap test: a 10x10 map of 16x16 cells on layer 10 of the current room,
+    // next to an instance layer that has no tilemap
+    GM::RegisterTilemapBuiltins(vm, globals.GetRoomManager());
+    auto tiles = std::make_shared<GM::Layer>(10, "Tiles", GM::LayerType::Tiles);
+    tiles->SetTilemap(std::make_shared<GM::Tilemap>(10, 10, 16, 16));
+    room->AddLayer(tiles);
+    room->AddLayer(std::make_shared<GM::Layer>(11, "Instances", GM::LayerType::Instances));
+
+    auto tile = [&](const char* name, const std::vector<double>& args) { return CallBuiltIn(vm, name, args).AsReal(); };
+    bool ids = tile("layer_tilemap_get_id", { 10 }) == 10 && tile("layer_tilemap_get_id", { 11 }) == -1 &&
+               tile("layer_tilemap_get_id", { 99 }) == -1;
+    bool cells = tile("tilemap_set", { 10, 7, 3, 4 }) == 1 && tile("tilemap_get", { 10, 3, 4 }) == 7 &&
+                 tile("tilemap_get", { 10, 5, 5 }) == 0 && tile("tilemap_get", { 10, 30, 4 }) == -1 &&
+                 tile("tilemap_get", { 10, -1, 0 }) == -1 && tile("tilemap_set", { 10, 7, 10, 0 }) == 0 &&
+                 tile("tilemap_set", { 10, 7, 0, -1 }) == 0;
+    // Data that is negative, NaN or wider than 32 bits is refused and the cell kept
+    bool data = tile("tilemap_set", { 10, -5, 3, 4 }) == 0 && tile("tilemap_set", { 10, NAN, 3, 4 }) == 0 &&
+                tile("tilemap_set", { 10, 1e12, 3, 4 }) == 0 && tile("tilemap_get", { 10, 3, 4 }) == 7;
+    bool pixels = tile("tilemap_get_at_pixel", { 10, 3 * 16 + 5, 4 * 16 + 1 }) == 7 &&
+                  tile("tilemap_get_at_pixel", { 10, 160, 16 }) == -1 &&
+                  tile("tilemap_get_at_pixel", { 10, -1, 16 }) == -1 &&
+                  tile("tilemap_set_at_pixel", { 10, 9, 20, 31 }) == 1 && tile("tilemap_get", { 10, 1, 1 }) == 9 &&
+                  tile("tilemap_set_at_pixel", { 10, -9, 20, 31 }) == 0 &&
+                  tile("tilemap_set_at_pixel", { 10, 9, 20, 200 }) == 0 && tile("tilemap_get", { 10, 1, 1 }) == 9 &&
+                  tile("tilemap_get_cell_x_at_pixel", { 10, 47, 0 }) == 2 &&
+                  tile("tilemap_get_cell_y_at_pixel", { 10, 0, 160 }) == -1;
+    bool missing = true;
+    for (double id : { 99.0, 11.0, -1.0, (double)NAN }) {
+        missing = missing && tile("tilemap_get", { id, 3, 4 }) == -1 && tile("tilemap_set", { id, 1, 3, 4 }) == 0 &&
+                  tile("tilemap_get_at_pixel", { id, 50, 65 }) == -1 && tile("tilemap_get_width", { id }) == -1;
+    }
+    std::cout << "tilemap ids/cells/data/pixels/missing = " << ids << cells << data << pixels << missing << std::endl;
+
+    if (ids && cells && data && pixels && missing) {
+        std::cout << "SUCCESS: VM tilemap built-in test passed!" << std::endl;
+    } else {
+        std::cout << "FAILURE: a tilemap built-in accepted a bad argument or lost a cell" << std::endl;
+        return 1;
+    }
+
+    return 0;
 }
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <limits>
 
 namespace GM {
 
@@ -9,8 +10,58 @@ namespace GM {
 Value::Value() : type_(Type::UNDEFINED), data_(0.0) {}
 Value::Value(double real) : type_(Type::REAL), data_(real) {}
 Value::Value(const std::string& str) : type_(Type::STRING), data_(str) {}
+Value::Value(std::string&& str) : type_(Type::STRING), data_(std::move(str)) {}
 Value::Value(bool b) : type_(Type::BOOL), data_(b) {}
 Value::Value(const char* str) : type_(Type::STRING), data_(std::string(str)) {}
+Value::Value(std::shared_ptr<Array> arr) : type_(Type::ARRAY), data_(std::move(arr)) {}
+Value::Value(std::shared_ptr<Struct> obj) : type_(Type::STRUCT), data_(std::move(obj)) {}
+
+Value Value::MakeArray() {
+    return Value(std::make_shared<Array>());
+}
+
+Value Value::MakeStruct() {
+    return Value(std::make_shared<Struct>());
+}
+
+// Nested arrays/structs print like GameMaker's string(); the depth cap stops self-references
+static void AppendDisplay(std::string& out, const Value& val, int depth) {
+    if (depth > 32) {
+        out += "...";
+    } else if (Array* arr = val.GetArray()) {
+        if (arr->empty()) {
+            out += "[ ]";
+            return;
+        }
+        out += "[ ";
+        for (size_t i = 0; i < arr->size(); i++) {
+            if (i > 0) out += ",";
+            AppendDisplay(out, (*arr)[i], depth + 1);
+        }
+        out += " ]";
+    } else if (Struct* obj = val.GetStruct()) {
+        if (obj->Size() == 0) {
+            out += "{ }";
+            return;
+        }
+        out += "{ ";
+        bool first = true;
+        for (const auto& member : obj->GetMembers()) {
+            if (!first) out += ", ";
+            first = false;
+            out += member.first;
+            out += " : ";
+            AppendDisplay(out, member.second, depth + 1);
+        }
+        out += " }";
+    } else if (depth > 0 && val.IsString()) {
+        out += '"';
+        out += val.GetStringRef();
+        out += '"';
+    } else {
+        out += val.AsString();
+    }
+}
 
 // Conversions
 double Value::AsReal() const {
@@ -55,6 +106,12 @@ std::string Value::AsString() const {
             return std::get<bool>(data_) ? "true" : "false";
         case Type::UNDEFINED:
             return "undefined";
+        case Type::ARRAY:
+        case Type::STRUCT: {
+            std::string str;
+            AppendDisplay(str, *this, 0);
+            return str;
+        }
         default:
             return "";
     }
@@ -75,6 +132,13 @@ bool Value::AsBool() const {
     }
 }
 
+int64_t ToInt64(double v) {
+    if (std::isnan(v)) return 0;
+    if (v >= 9223372036854775807.0) return std::numeric_limits<int64_t>::max();
+    if (v <= -9223372036854775808.0) return std::numeric_limits<int64_t>::min();
+    return (int64_t)v;
+}
+
 // Arithmetic operators
 Value Value::operator+(const Value& other) const {
     return Value(AsReal() + other.AsReal());
@@ -106,6 +170,10 @@ Value Value::operator-() const {
 
 // Comparison operators
 bool Value::operator==(const Value& other) const {
+    // Arrays and structs compare by reference
+    if (IsArray() || IsStruct() || other.IsArray() || other.IsStruct()) {
+        return type_ == other.type_ && data_ == other.data_;
+    }
     // String comparison
     if (IsString() && other.IsString()) {
         return std::get<std::string>(data_) == std::get<std::string>(other.data_);
@@ -170,8 +238,65 @@ Value Value::operator!() const {
 // String representation
 std::string Value::ToString() const {
     std::ostringstream oss;
-    oss << "Value(" << (IsReal() ? "real" : IsString() ? "string" : IsBool() ? "bool" : "undefined") << ": " << AsString() << ")";
+    oss << "Value(" << (IsReal() ? "real" : IsString() ? "string" : IsBool() ? "bool" :
+                        IsArray() ? "array" : IsStruct() ? "struct" : "undefined") << ": " << AsString() << ")";
     return oss.str();
 }
 
+// Struct implementation
+int64_t Struct::IndexOf(const std::string& name) const {
+    if (!index.empty()) {
+        auto it = index.find(name);
+        return it != index.end() ? (int64_t)it->second : -1;
+    }
+    for (size_t i = 0; i < members.size(); i++) {
+        if (members[i].first == name) return (int64_t)i;
+    }
+    return -1;
+}
+
+Value* Struct::Find(const std::string& name) {
+    int64_t i = IndexOf(name);
+    return i >= 0 ? &members[(size_t)i].second : nullptr;
+}
+
+const Value* Struct::Find(const std::string& name) const {
+    int64_t i = IndexOf(name);
+    return i >= 0 ? &members[(size_t)i].second : nullptr;
+}
+
+void Struct::Set(std::string name, Value val) {
+    int64_t i = IndexOf(name);
+    if (i >= 0) {
+        members[(size_t)i].second = std::move(val);
+        return;
+    }
+    members.emplace_back(std::move(name), std::move(val));
+    if (!index.empty()) {
+        index.emplace(members.back().first, members.size() - 1);
+    } else if (members.size() > INDEX_THRESHOLD) {
+        RebuildIndex();
+    }
+}
+
+bool Struct::Remove(const std::string& name) {
+    int64_t i = IndexOf(name);
+    if (i < 0) return false;
+    members.erase(members.begin() + i);
+    if (members.size() > INDEX_THRESHOLD) {
+        RebuildIndex();
+    } else {
+        index.clear();
+    }
+    return true;
+}
+
+void Struct::RebuildIndex() {
+    index.clear();
+    index.reserve(members.size());
+    for (size_t i = 0; i < members.size(); i++) {
+        index.emplace(members[i].first, i);
+    }
+}
+
 } // namespace GM
@@ -68,6 +68,11 @@ int main() {
 			return 1;
 		}
 		printf("[Main] Undertale loaded successfully!\n");
+
+		// Enter the starting room the loader picked, building its instances
+		if (auto start = engine.GetCurrentRoom()) {
+			engine.SwitchRoom(start->GetID(), true);
+		}
 	}
 
 	printf("[Main] Entering main loop...\n");